@@ -1,8 +1,10 @@
 #ifndef VARA_CONFIGURATION_CONFIGURATION_H
 #define VARA_CONFIGURATION_CONFIGURATION_H
 
+#include <llvm/ADT/Hashing.h>
 #include <llvm/ADT/StringMap.h>
 #include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/raw_ostream.h>
 
 #include <map>
 #include <memory>
@@ -13,6 +15,8 @@
 
 namespace vara::feature {
 
+class FeatureModel;
+
 /// \brief This class represents a simple configuration option.
 ///
 /// Note that this class is not linked to real features from the feature model
@@ -104,6 +108,23 @@ public:
     return std::holds_alternative<int64_t>(Value);
   }
 
+  /// Two options are equal if they have the same name and hold the same typed
+  /// value.
+  bool operator==(const ConfigurationOption &Other) const {
+    return Name == Other.Name && Value == Other.Value;
+  }
+  bool operator!=(const ConfigurationOption &Other) const {
+    return !operator==(Other);
+  }
+
+  /// This method returns a structural hash of name and typed value.
+  /// \returns the hash of this configuration option
+  [[nodiscard]] llvm::hash_code hash() const {
+    return llvm::hash_combine(
+        Name, Value.index(),
+        std::visit([](const auto &V) { return llvm::hash_value(V); }, Value));
+  }
+
 private:
   /// This method parses the given string and tries to convert it.
   /// \returns a variant of the most specific type (int64_t, bool, or StringRef)
@@ -114,7 +135,7 @@ private:
       return ValueToConvert == "true";
     }
     int64_t IntegerValue;
-    if (!ValueToConvert.getAsInteger(0, IntegerValue)) {
+    if (!ValueToConvert.getAsInteger(10, IntegerValue)) {
       return IntegerValue;
     }
     return ValueToConvert.str();
@@ -143,7 +164,7 @@ public:
   [[nodiscard]] llvm::StringMapConstIterator<
       std::unique_ptr<ConfigurationOption>>
   begin() const {
-    return OptionMappings.end();
+    return OptionMappings.begin();
   }
 
   [[nodiscard]] llvm::StringMapIterator<std::unique_ptr<ConfigurationOption>>
@@ -160,6 +181,19 @@ public:
   [[nodiscard]] static std::unique_ptr<Configuration>
   createConfigurationFromString(llvm::StringRef ConfigurationString);
 
+  /// This method creates a configuration from the provided json string in a
+  /// single pass without building a json document first. Every option has to
+  /// name a feature of the given model and hold a value matching the kind of
+  /// the feature.
+  ///
+  /// \param ConfigurationString json object mapping names to string values
+  /// \param FM feature model the configuration belongs to
+  ///
+  /// \returns the configuration or \c nullptr if the string is invalid
+  [[nodiscard]] static std::unique_ptr<Configuration>
+  createConfigurationFromString(llvm::StringRef ConfigurationString,
+                                const FeatureModel &FM);
+
   /// This method adds a configuration option to the current configuration.
   void addConfigurationOption(std::unique_ptr<ConfigurationOption> Option);
 
@@ -170,11 +204,32 @@ public:
   /// This method returns the value of the configuration option.
   /// \returns the value of the configuration option as a string
   [[nodiscard]] std::optional<std::string>
-  configurationOptionValue(llvm::StringRef Name);
+  configurationOptionValue(llvm::StringRef Name) const;
 
   /// This method dumps the current configuration to a json string.
   /// \returns the current configuration as a json-formatted string
-  [[nodiscard]] std::string dumpToString();
+  [[nodiscard]] std::string dumpToString() const;
+
+  /// This method streams the current configuration as json object into the
+  /// given stream. Options are ordered by name, so the output is identical to
+  /// dumpToString().
+  void writeJson(llvm::raw_ostream &OS) const;
+
+  /// This method returns the number of configuration options.
+  [[nodiscard]] unsigned int size() const { return OptionMappings.size(); }
+
+  /// Two configurations are equal if they contain equal options, independent
+  /// of insertion order.
+  bool operator==(const Configuration &Other) const;
+  bool operator!=(const Configuration &Other) const {
+    return !operator==(Other);
+  }
+
+  /// This method returns a structural hash of the configuration. The hash does
+  /// not depend on the order in which options were added, so equal
+  /// configurations always have equal hashes.
+  /// \returns the hash of this configuration
+  [[nodiscard]] llvm::hash_code hash() const;
 
 private:
   /// This represents a mapping from the name of the option to the option
@@ -0,0 +1,124 @@
+#ifndef VARA_CONFIGURATION_CONFIGURATIONSET_H
+#define VARA_CONFIGURATION_CONFIGURATIONSET_H
+
+#include "vara/Configuration/Configuration.h"
+#include "vara/Utils/UniqueIterator.h"
+
+#include "llvm/ADT/iterator_range.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vara::feature {
+
+/// \brief This class represents a set of structurally distinct configurations.
+///
+/// Configurations are kept in insertion order in a dense vector while an open
+/// addressing index over their cached hashes detects duplicates. Hence,
+/// inserting, looking up, and the set operations only hash each configuration
+/// once and compare options only on hash collisions.
+class ConfigurationSet {
+public:
+  using ConfigurationContainerTy = std::vector<std::unique_ptr<Configuration>>;
+  using iterator = UniqueIterator<ConfigurationContainerTy>;
+  using const_iterator = UniqueIterator<const ConfigurationContainerTy>;
+
+  ConfigurationSet() = default;
+  ConfigurationSet(const ConfigurationSet &) = delete;
+  ConfigurationSet &operator=(const ConfigurationSet &) = delete;
+  ConfigurationSet(ConfigurationSet &&) = default;
+  ConfigurationSet &operator=(ConfigurationSet &&) = default;
+  ~ConfigurationSet() = default;
+
+  /// This method creates a set from the given configurations and drops all
+  /// duplicates, keeping the first occurrence.
+  explicit ConfigurationSet(
+      std::vector<std::unique_ptr<Configuration>> Configurations);
+
+  /// This method inserts the given configuration if no equal configuration is
+  /// part of the set.
+  ///
+  /// \returns \c true if the configuration was inserted, \c false if it was a
+  /// duplicate
+  bool insert(std::unique_ptr<Configuration> Config);
+
+  /// This method returns the stored configuration equal to the given one.
+  ///
+  /// \returns the stored configuration or \c nullptr
+  [[nodiscard]] Configuration *find(const Configuration &Config) const;
+
+  /// This method returns \c true if an equal configuration is part of the set.
+  [[nodiscard]] bool contains(const Configuration &Config) const {
+    return find(Config) != nullptr;
+  }
+
+  /// This method moves all configurations of \p Other that are not yet part
+  /// of this set into it (union).
+  void merge(ConfigurationSet &&Other);
+
+  /// This method removes all configurations that are not part of \p Other
+  /// (intersection).
+  void intersect(const ConfigurationSet &Other);
+
+  /// This method removes all configurations that are part of \p Other
+  /// (difference).
+  void subtract(const ConfigurationSet &Other);
+
+  /// This method reserves space for the given number of configurations.
+  void reserve(size_t N);
+
+  void clear() {
+    Configurations.clear();
+    Hashes.clear();
+    Index.clear();
+  }
+
+  /// This method moves all configurations out of the set.
+  ///
+  /// \returns the configurations in insertion order
+  [[nodiscard]] std::vector<std::unique_ptr<Configuration>> release();
+
+  [[nodiscard]] size_t size() const { return Configurations.size(); }
+
+  [[nodiscard]] bool empty() const { return Configurations.empty(); }
+
+  iterator begin() { return iterator(Configurations.begin()); }
+  [[nodiscard]] const_iterator begin() const {
+    return const_iterator(Configurations.begin());
+  }
+
+  iterator end() { return iterator(Configurations.end()); }
+  [[nodiscard]] const_iterator end() const {
+    return const_iterator(Configurations.end());
+  }
+
+  [[nodiscard]] llvm::iterator_range<const_iterator> configurations() const {
+    return llvm::make_range(begin(), end());
+  }
+
+private:
+  static constexpr uint32_t EmptySlot = UINT32_MAX;
+
+  /// Searches the slot of the given configuration or the empty slot where it
+  /// would be inserted.
+  [[nodiscard]] size_t lookupSlot(const Configuration &Config,
+                                  size_t Hash) const;
+
+  /// Rebuilds the index for at least the given number of configurations.
+  void rehash(size_t MinSize);
+
+  /// Removes all configurations for which \p Keep returns false.
+  template <typename PredTy>
+  void retain(PredTy Keep);
+
+  ConfigurationContainerTy Configurations;
+  /// Cached hash of each configuration, parallel to Configurations.
+  std::vector<size_t> Hashes;
+  /// Open addressing table (power of two size) of indices into Configurations.
+  std::vector<uint32_t> Index;
+};
+
+} // namespace vara::feature
+
+#endif // VARA_CONFIGURATION_CONFIGURATIONSET_H
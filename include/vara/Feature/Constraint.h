@@ -594,12 +594,14 @@ private:
 };
 
 class Feature;
+class FeatureModel;
 
 namespace detail {
 class FeatureModelModification;
 } // namespace detail
 
 class PrimaryFeatureConstraint : public PrimaryConstraint {
+  friend class FeatureModel;
   friend detail::FeatureModelModification;
 
 public:
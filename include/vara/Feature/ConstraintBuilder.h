@@ -2,6 +2,7 @@
 #define VARA_FEATURE_CONSTRAINTBUILDER_H
 
 #include "vara/Feature/Constraint.h"
+#include "vara/Feature/Error.h"
 #include "vara/Feature/Feature.h"
 
 namespace vara::feature {
@@ -88,7 +89,7 @@ private:
   template <class ConstraintTy>
   ConstraintBuilder &unary() {
     if (!Head || *Head) {
-      llvm::errs() << "Syntax error: Unrecognized unary constraint.\n";
+      errorStream() << "Syntax error: Unrecognized unary constraint.\n";
       Head = nullptr;
       return *this;
     }
@@ -103,7 +104,7 @@ private:
     assert(Precedence < ConstraintBuilder::MaxPrecedence);
     assert(Precedence > ConstraintBuilder::MinPrecedence);
     if (!Head || !*Head) {
-      llvm::errs() << "Syntax error: Unrecognized binary constraint.\n";
+      errorStream() << "Syntax error: Unrecognized binary constraint.\n";
       Head = nullptr;
       return *this;
     }
@@ -129,7 +130,7 @@ public:
       Frames.pop();
     }
     if (!Head || !*Head || !Root || !Frames.empty()) {
-      llvm::errs() << "Syntax error: Incomplete constraint.\n";
+      errorStream() << "Syntax error: Incomplete constraint.\n";
       return nullptr;
     }
     return Root->build();
@@ -147,7 +148,7 @@ public:
       Frames.pop();
     }
     if (!Head || !*Head || !Frames.empty()) {
-      llvm::errs() << "Syntax error: Unrecognized parentheses.\n";
+      errorStream() << "Syntax error: Unrecognized parentheses.\n";
       Head = nullptr;
       return *this;
     }
@@ -170,7 +171,7 @@ public:
   ///     '!(!A => B)'
   ConstraintBuilder &openPar() {
     if (!Head || *Head) {
-      llvm::errs() << "Syntax error: Unrecognized opening parenthesis.\n";
+      errorStream() << "Syntax error: Unrecognized opening parenthesis.\n";
       Head = nullptr;
       return *this;
     }
@@ -185,7 +186,7 @@ public:
       Frames.pop();
     }
     if (!Head || !*Head || Frames.empty()) {
-      llvm::errs() << "Syntax error: Unrecognized closing parenthesis.\n";
+      errorStream() << "Syntax error: Unrecognized closing parenthesis.\n";
       Head = nullptr;
       return *this;
     }
@@ -204,7 +205,7 @@ public:
   ///     '42'
   ConstraintBuilder &constant(int V) {
     if (!Head || *Head) {
-      llvm::errs() << "Syntax error: Unrecognized constant constraint.\n";
+      errorStream() << "Syntax error: Unrecognized constant constraint.\n";
       Head = nullptr;
       return *this;
     }
@@ -223,7 +224,7 @@ public:
   ///     'Foo'
   ConstraintBuilder &feature(const std::string &Name) {
     if (!Head || *Head) {
-      llvm::errs() << "Syntax error: Unrecognized feature constraint.\n";
+      errorStream() << "Syntax error: Unrecognized feature constraint.\n";
       Head = nullptr;
       return *this;
     }
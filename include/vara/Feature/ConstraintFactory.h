@@ -0,0 +1,134 @@
+#ifndef VARA_FEATURE_CONSTRAINTFACTORY_H
+#define VARA_FEATURE_CONSTRAINTFACTORY_H
+
+#include "vara/Feature/Constraint.h"
+#include "vara/Feature/FlatConstraint.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vara::feature {
+
+class Feature;
+
+//===----------------------------------------------------------------------===//
+//                          ConstraintFactory Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Hash-consing factory for constraints.
+///
+/// Every structurally equal subtree is stored once and identified by the same
+/// \a NodeId, so equality of interned constraints is a comparison of ids.
+/// Feature leaves only store the name of their feature. Hence, leaves of
+/// features with the same name are equal, which also unifies the placeholder
+/// features of parsed or cloned constraints, and interned constraints may be
+/// destroyed while the factory is in use. Nodes are created operands first,
+/// hence the operands of a node always have smaller ids.
+class ConstraintFactory {
+public:
+  using NodeId = uint32_t;
+
+  struct Node {
+    Constraint::ConstraintKind Kind;
+    /// Left operand of binary operators.
+    NodeId LeftOperand = 0;
+    /// Right operand of binary and operand of unary operators.
+    NodeId Operand = 0;
+    union {
+      const llvm::StringMapEntry<NodeId> *Leaf;
+      int64_t Value;
+    };
+
+    [[nodiscard]] llvm::StringRef getFeatureName() const {
+      assert(Kind == Constraint::ConstraintKind::CK_FEATURE);
+      return Leaf->getKey();
+    }
+
+    [[nodiscard]] int64_t getValue() const {
+      assert(Kind == Constraint::ConstraintKind::CK_INTEGER);
+      return Value;
+    }
+  };
+
+  struct Statistics {
+    /// Nodes that were requested from the factory.
+    size_t NumNodes = 0;
+    /// Nodes that are actually stored.
+    size_t NumUniqueNodes = 0;
+    /// Top-level constraints that were interned.
+    size_t NumConstraints = 0;
+    /// Top-level constraints that were equal to an earlier one.
+    size_t NumDuplicateConstraints = 0;
+  };
+
+  ConstraintFactory() = default;
+
+  /// Interns the constraint tree \p C as a top-level constraint.
+  NodeId intern(Constraint &C) {
+    return intern(FlatConstraint::fromConstraint(C));
+  }
+
+  /// Interns the complete flat constraint \p C as a top-level constraint.
+  NodeId intern(const FlatConstraint &C);
+
+  NodeId makeFeature(const Feature &F);
+
+  NodeId makeFeature(llvm::StringRef Name);
+
+  NodeId makeInteger(int64_t Value);
+
+  NodeId makeUnary(Constraint::ConstraintKind Kind, NodeId Operand);
+
+  NodeId makeBinary(Constraint::ConstraintKind Kind, NodeId LeftOperand,
+                    NodeId RightOperand);
+
+  [[nodiscard]] const Node &operator[](NodeId Id) const {
+    assert(Id < Nodes.size());
+    return Nodes[Id];
+  }
+
+  /// Number of stored nodes.
+  [[nodiscard]] size_t size() const { return Nodes.size(); }
+
+  /// Expands the node \p Id into a flat constraint, shared subtrees are
+  /// repeated.
+  ///
+  /// \param FeatureOf maps the names of feature leaves to their features
+  [[nodiscard]] FlatConstraint toFlatConstraint(
+      NodeId Id,
+      llvm::function_ref<Feature *(llvm::StringRef)> FeatureOf) const;
+
+  /// Expands the node \p Id into a constraint tree.
+  ///
+  /// \param FeatureOf maps the names of feature leaves to their features
+  [[nodiscard]] std::unique_ptr<Constraint> toConstraint(
+      NodeId Id,
+      llvm::function_ref<Feature *(llvm::StringRef)> FeatureOf) const {
+    return toFlatConstraint(Id, FeatureOf).toConstraint();
+  }
+
+  [[nodiscard]] const Statistics &getStatistics() const { return Stats; }
+
+private:
+  /// Operators are keyed by kind and operands, integers by kind and the two
+  /// halves of their value.
+  using KeyTy = std::pair<unsigned, std::pair<uint32_t, uint32_t>>;
+
+  NodeId lookupOrCreate(KeyTy Key, const Node &N);
+
+  std::vector<Node> Nodes;
+  llvm::DenseMap<KeyTy, NodeId> Uniques;
+  llvm::StringMap<NodeId> FeatureLeaves;
+  /// Bit for each node whether it was interned as a top-level constraint.
+  std::vector<bool> IsConstraint;
+  Statistics Stats;
+};
+
+} // namespace vara::feature
+
+#endif // VARA_FEATURE_CONSTRAINTFACTORY_H
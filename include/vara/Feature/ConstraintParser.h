@@ -3,11 +3,15 @@
 
 #include "vara/Feature/Constraint.h"
 #include "vara/Feature/Feature.h"
+#include "vara/Feature/FeatureModel.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/ErrorHandling.h"
 
 #include <iostream>
 #include <utility>
+#include <vector>
 
 namespace vara::feature {
 
@@ -27,6 +31,8 @@ namespace legacy {
 }
 } // namespace legacy
 
+/// A token of a constraint. Values of identifiers, numbers and errors refer to
+/// the lexed input, which has to outlive the token.
 class ConstraintToken {
 public:
   using PrecedenceTy = unsigned int;
@@ -59,13 +65,12 @@ public:
   };
 
   ConstraintToken(ConstraintTokenKind Kind) : Kind(Kind) {}
-  ConstraintToken(ConstraintTokenKind Kind, const std::string &Value)
+  ConstraintToken(ConstraintTokenKind Kind, llvm::StringRef Value)
       : Kind(Kind), Value(Value) {}
-  virtual ~ConstraintToken() = default;
 
   [[nodiscard]] ConstraintTokenKind getKind() const { return Kind; };
 
-  [[nodiscard]] std::optional<const std::string> getValue() const {
+  [[nodiscard]] std::optional<llvm::StringRef> getValue() const {
     return Value;
   }
 
@@ -100,44 +105,64 @@ public:
   }
 
 private:
-  const ConstraintTokenKind Kind;
-  const std::optional<const std::string> Value{std::nullopt};
+  ConstraintTokenKind Kind;
+  std::optional<llvm::StringRef> Value{std::nullopt};
 };
 
 //===----------------------------------------------------------------------===//
-//                               ConstraintToken
+//                               ConstraintLexer
 //===----------------------------------------------------------------------===//
 
+/// Lexes a constraint token by token. Token values refer to the lexed input,
+/// which is only copied if the lexer is handed a temporary string.
 class ConstraintLexer {
 public:
-  using TokenListTy = std::deque<ConstraintToken>;
-
-  explicit ConstraintLexer(std::string Cnt) : Cnt(std::move(Cnt)) {}
-
-  TokenListTy tokenize() {
-    TokenListTy TokenList;
-
-    for (llvm::StringRef Str = Cnt; !Str.empty();) {
-      auto Result = munch(Str);
-      TokenList.push_back(Result.first);
-      if (auto Kind = Result.first.getKind();
-          Kind == ConstraintToken::ConstraintTokenKind::END_OF_FILE ||
-          Kind == ConstraintToken::ConstraintTokenKind::ERROR) {
-        break;
-      }
-      Str = Str.drop_front(Result.second);
+  using TokenListTy = std::vector<ConstraintToken>;
+
+  explicit ConstraintLexer(llvm::StringRef Cnt) : Remaining(Cnt) {}
+  explicit ConstraintLexer(const char *Cnt)
+      : ConstraintLexer(llvm::StringRef(Cnt)) {}
+  explicit ConstraintLexer(std::string &&Cnt)
+      : Storage(std::move(Cnt)), Remaining(Storage) {}
+  ConstraintLexer(const ConstraintLexer &) = delete;
+  ConstraintLexer &operator=(const ConstraintLexer &) = delete;
+  ConstraintLexer(ConstraintLexer &&) = delete;
+  ConstraintLexer &operator=(ConstraintLexer &&) = delete;
+
+  /// Lexes the next token, including whitespace. Once the input is exhausted
+  /// or an error was found, the end of file or error token is repeated.
+  ConstraintToken next() {
+    if (Remaining.empty()) {
+      return ConstraintToken(ConstraintToken::ConstraintTokenKind::END_OF_FILE);
     }
-
-    // ensure last token is always either EOF or an error
-    if (auto Kind = TokenList.back().getKind();
-        Kind != ConstraintToken::ConstraintTokenKind::END_OF_FILE &&
-        Kind != ConstraintToken::ConstraintTokenKind::ERROR) {
-      TokenList.push_back(
-          ConstraintToken(ConstraintToken::ConstraintTokenKind::END_OF_FILE));
+    auto [Token, Length] = munch(Remaining);
+    switch (Token.getKind()) {
+    case ConstraintToken::ConstraintTokenKind::END_OF_FILE:
+      Remaining = llvm::StringRef();
+      break;
+    case ConstraintToken::ConstraintTokenKind::ERROR:
+      break;
+    default:
+      Remaining = Remaining.drop_front(Length);
+      break;
     }
+    return Token;
+  }
 
+  /// Lexes the remaining input. The last token is always either end of file or
+  /// an error. As the tokens refer to the input, the lexer must not be a
+  /// temporary.
+  TokenListTy tokenize() & {
+    TokenListTy TokenList;
+    do {
+      TokenList.push_back(next());
+    } while (TokenList.back().getKind() !=
+                 ConstraintToken::ConstraintTokenKind::END_OF_FILE &&
+             TokenList.back().getKind() !=
+                 ConstraintToken::ConstraintTokenKind::ERROR);
     return TokenList;
   }
+  TokenListTy tokenize() && = delete;
 
 private:
   using ResultTy = std::pair<ConstraintToken, int>;
@@ -184,7 +209,7 @@ private:
       return munchOperator(Str);
     default:
       return {ConstraintToken(ConstraintToken::ConstraintTokenKind::ERROR,
-                              Str.take_front().str()),
+                              Str.take_front()),
               1};
     }
   }
@@ -238,7 +263,7 @@ private:
       return {ConstraintToken(ConstraintToken::ConstraintTokenKind::LESS), 1};
     default:
       return {ConstraintToken(ConstraintToken::ConstraintTokenKind::ERROR,
-                              Str.take_front().str()),
+                              Str.take_front()),
               1};
     }
   }
@@ -249,7 +274,7 @@ private:
     });
 
     return {ConstraintToken(ConstraintToken::ConstraintTokenKind::NUMBER,
-                            Munch.lower()),
+                            Munch),
             Munch.size()};
   }
 
@@ -263,11 +288,12 @@ private:
     }
 
     return {ConstraintToken(ConstraintToken::ConstraintTokenKind::IDENTIFIER,
-                            Munch.str()),
+                            Munch),
             Munch.size()};
   }
 
-  std::string Cnt;
+  std::string Storage;
+  llvm::StringRef Remaining;
 };
 
 //===----------------------------------------------------------------------===//
@@ -275,7 +301,7 @@ private:
 //===----------------------------------------------------------------------===//
 
 /// Parse 64-bit integer in decimal or scientific notation.
-static int64_t parseInteger(llvm::StringRef Str,
+inline int64_t parseInteger(llvm::StringRef Str,
                             std::optional<unsigned int> Line = std::nullopt) {
   if (Str.contains_insensitive('e')) {
     // If we encounter scientific notation we try to parse the number as double.
@@ -287,10 +313,10 @@ static int64_t parseInteger(llvm::StringRef Str,
   }
 
   if (Line.has_value()) {
-    llvm::errs() << "Failed to parse integer '" << Str << "' in line "
-                 << Line.has_value() << ".\n";
+    errorStream() << "Failed to parse integer '" << Str << "' in line "
+                  << *Line << ".\n";
   } else {
-    llvm::errs() << "Failed to parse integer '" << Str << "'.\n";
+    errorStream() << "Failed to parse integer '" << Str << "'.\n";
   }
 
   // If parsing failed, we return minimal or maximal value respectively.
@@ -300,33 +326,102 @@ static int64_t parseInteger(llvm::StringRef Str,
   return std::numeric_limits<int64_t>::max();
 }
 
+/// Parse all integers in a value list like \c "1, 2, -3" in a single pass.
+/// Every maximal run of digits, including a directly preceding minus, is an
+/// integer; any other characters are separators.
+inline std::vector<int64_t>
+parseIntegerList(llvm::StringRef Str,
+                 std::optional<unsigned int> Line = std::nullopt) {
+  std::vector<int64_t> Values;
+  for (size_t I = 0, E = Str.size(); I < E;) {
+    if (!llvm::isDigit(Str[I])) {
+      ++I;
+      continue;
+    }
+    size_t Begin = I > 0 && Str[I - 1] == '-' ? I - 1 : I;
+    while (I < E && llvm::isDigit(Str[I])) {
+      ++I;
+    }
+    Values.push_back(parseInteger(Str.slice(Begin, I), Line));
+  }
+  return Values;
+}
+
+/// Parses a constraint in a single pass over the lexed tokens, keeping only
+/// one token of lookahead.
 class ConstraintParser {
 public:
-  explicit ConstraintParser(std::string Cnt,
+  explicit ConstraintParser(llvm::StringRef Cnt,
                             std::optional<unsigned int> Line = std::nullopt)
-      : TokenList(ConstraintLexer(std::move(Cnt)).tokenize()), Line(Line) {}
+      : Lexer(Cnt), Line(Line) {}
+  explicit ConstraintParser(const char *Cnt,
+                            std::optional<unsigned int> Line = std::nullopt)
+      : Lexer(Cnt), Line(Line) {}
+  explicit ConstraintParser(std::string &&Cnt,
+                            std::optional<unsigned int> Line = std::nullopt)
+      : Lexer(std::move(Cnt)), Line(Line) {}
+
+  /// Builds the constraint with placeholder features that are resolved once
+  /// the constraint is added to a feature model.
+  std::unique_ptr<Constraint> buildConstraint() {
+    advance();
+    return parseConstraint();
+  }
 
-  std::unique_ptr<Constraint> buildConstraint() { return parseConstraint(); }
+  /// Builds the constraint and directly refers to the features returned by
+  /// \p FeatureOf for each identifier. Identifiers for which \p FeatureOf
+  /// returns \c nullptr become placeholders.
+  std::unique_ptr<Constraint>
+  buildConstraint(llvm::function_ref<Feature *(llvm::StringRef)> FeatureOf) {
+    this->FeatureOf = FeatureOf;
+    auto C = buildConstraint();
+    // The lookup is only guaranteed to live during this call.
+    this->FeatureOf = {};
+    return C;
+  }
+
+  /// Builds the constraint and directly refers to the features of \p FM.
+  /// Identifiers that do not name a feature of \p FM become placeholders.
+  std::unique_ptr<Constraint> buildConstraint(const FeatureModel &FM) {
+    return buildConstraint(
+        [&FM](llvm::StringRef Name) { return FM.getFeature(Name); });
+  }
 
 private:
-  [[nodiscard]] const ConstraintToken &peek() const {
-    return TokenList.front();
+  [[nodiscard]] const ConstraintToken &peek() const { return Current; }
+
+  /// Moves to the next token that is not whitespace.
+  void advance() {
+    do {
+      Current = Lexer.next();
+    } while (Current.getKind() ==
+             ConstraintToken::ConstraintTokenKind::WHITESPACE);
   }
 
   [[nodiscard]] ConstraintToken next() {
-    auto Token = TokenList.front();
-    TokenList.pop_front();
+    auto Token = Current;
+    advance();
     return Token;
   }
 
   bool consume(const ConstraintToken::ConstraintTokenKind Kind) {
-    if (TokenList.front().getKind() == Kind) {
-      TokenList.pop_front();
+    if (Current.getKind() == Kind) {
+      advance();
       return true;
     }
     return false;
   }
 
+  std::unique_ptr<Constraint> createFeatureConstraint(llvm::StringRef Name) {
+    if (FeatureOf) {
+      if (auto *F = FeatureOf(Name)) {
+        return std::make_unique<PrimaryFeatureConstraint>(F);
+      }
+    }
+    return std::make_unique<PrimaryFeatureConstraint>(
+        std::make_unique<Feature>(Name.str()));
+  }
+
   std::unique_ptr<Constraint>
   parseConstraint(int NestingLevel = 0,
                   ConstraintToken::PrecedenceTy Precedence =
@@ -336,17 +431,16 @@ private:
       switch (peek().getKind()) {
       case ConstraintToken::ConstraintTokenKind::ERROR:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Lexical error: Unexpected character '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Lexical error: Unexpected character '"
+                      << *peek().getValue() << "'\n";
         return nullptr;
       case ConstraintToken::ConstraintTokenKind::WHITESPACE:
-        consume(ConstraintToken::ConstraintTokenKind::WHITESPACE);
-        continue;
+        llvm_unreachable("Whitespace is skipped when advancing.");
       case ConstraintToken::ConstraintTokenKind::R_PAR:
         if (NestingLevel) {
           return LHS;
         }
-        llvm::errs() << "Syntax error: Unexpected closing parenthesis.\n";
+        errorStream() << "Syntax error: Unexpected closing parenthesis.\n";
         return nullptr;
       case ConstraintToken::ConstraintTokenKind::END_OF_FILE:
         return LHS;
@@ -376,7 +470,7 @@ private:
       case ConstraintToken::ConstraintTokenKind::NEG:
       case ConstraintToken::ConstraintTokenKind::NOT:
       case ConstraintToken::ConstraintTokenKind::NUMBER:
-        llvm::errs() << "Syntax error: Unexpected token in expression.\n";
+        errorStream() << "Syntax error: Unexpected token in expression.\n";
         return nullptr;
       }
     }
@@ -406,15 +500,14 @@ private:
       switch (peek().getKind()) {
       case ConstraintToken::ConstraintTokenKind::ERROR:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Lexical error: Unexpected character '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Lexical error: Unexpected character '"
+                      << *peek().getValue() << "'\n";
         return nullptr;
       case ConstraintToken::ConstraintTokenKind::END_OF_FILE:
-        llvm::errs() << "Syntax error: Unexpected end of binary expression\n";
+        errorStream() << "Syntax error: Unexpected end of binary expression\n";
         return nullptr;
       case ConstraintToken::ConstraintTokenKind::WHITESPACE:
-        consume(ConstraintToken::ConstraintTokenKind::WHITESPACE);
-        continue;
+        llvm_unreachable("Whitespace is skipped when advancing.");
       case ConstraintToken::ConstraintTokenKind::EQUAL:
         consume(ConstraintToken::ConstraintTokenKind::EQUAL);
         return createConstraint<EqualConstraint>(std::move(LHS),
@@ -473,7 +566,7 @@ private:
       case ConstraintToken::ConstraintTokenKind::NOT:
       case ConstraintToken::ConstraintTokenKind::NUMBER:
       case ConstraintToken::ConstraintTokenKind::R_PAR:
-        llvm::errs()
+        errorStream()
             << "Syntax error: Unexpected token in binary expression.\n";
         return nullptr;
       }
@@ -485,15 +578,14 @@ private:
       switch (peek().getKind()) {
       case ConstraintToken::ConstraintTokenKind::ERROR:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Lexical error: Unexpected character '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Lexical error: Unexpected character '"
+                      << *peek().getValue() << "'\n";
         return nullptr;
       case ConstraintToken::ConstraintTokenKind::END_OF_FILE:
-        llvm::errs() << "Syntax error: Unexpected end of unary expression.\n";
+        errorStream() << "Syntax error: Unexpected end of unary expression.\n";
         return nullptr;
       case ConstraintToken::ConstraintTokenKind::WHITESPACE:
-        consume(ConstraintToken::ConstraintTokenKind::WHITESPACE);
-        continue;
+        llvm_unreachable("Whitespace is skipped when advancing.");
       case ConstraintToken::ConstraintTokenKind::AND:
       case ConstraintToken::ConstraintTokenKind::EQUAL:
       case ConstraintToken::ConstraintTokenKind::EQUIVALENT:
@@ -507,16 +599,15 @@ private:
       case ConstraintToken::ConstraintTokenKind::OR:
       case ConstraintToken::ConstraintTokenKind::PLUS:
       case ConstraintToken::ConstraintTokenKind::STAR:
-        llvm::errs()
+        errorStream()
             << "Syntax error: Unexpected token before unary expression.\n";
         return nullptr;
       case ConstraintToken::ConstraintTokenKind::R_PAR:
-        llvm::errs() << "Syntax error: Unexpected closing parenthesis.\n";
+        errorStream() << "Syntax error: Unexpected closing parenthesis.\n";
         return nullptr;
       case ConstraintToken::ConstraintTokenKind::IDENTIFIER:
         assert(peek().getValue().has_value());
-        return std::make_unique<PrimaryFeatureConstraint>(
-            std::make_unique<Feature>(*next().getValue()));
+        return createFeatureConstraint(*next().getValue());
       case ConstraintToken::ConstraintTokenKind::NUMBER:
         assert(peek().getValue().has_value());
         return std::make_unique<PrimaryIntegerConstraint>(
@@ -533,7 +624,7 @@ private:
         consume(ConstraintToken::ConstraintTokenKind::L_PAR);
         auto Constraint = parseConstraint(NestingLevel + 1);
         if (!consume(ConstraintToken::ConstraintTokenKind::R_PAR)) {
-          llvm::errs() << "Syntax error: Missing closing parenthesis.\n";
+          errorStream() << "Syntax error: Missing closing parenthesis.\n";
           return nullptr;
         }
         return Constraint;
@@ -541,8 +632,10 @@ private:
     }
   }
 
-  ConstraintLexer::TokenListTy TokenList;
+  ConstraintLexer Lexer;
+  ConstraintToken Current{ConstraintToken::ConstraintTokenKind::END_OF_FILE};
   std::optional<unsigned int> Line;
+  llvm::function_ref<Feature *(llvm::StringRef)> FeatureOf;
 };
 
 } // namespace vara::feature
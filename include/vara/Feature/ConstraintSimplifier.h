@@ -0,0 +1,98 @@
+#ifndef VARA_FEATURE_CONSTRAINTSIMPLIFIER_H
+#define VARA_FEATURE_CONSTRAINTSIMPLIFIER_H
+
+#include "vara/Feature/Constraint.h"
+#include "vara/Feature/ConstraintFactory.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <memory>
+
+namespace vara::feature {
+
+class FeatureModel;
+
+//===----------------------------------------------------------------------===//
+//                         ConstraintSimplifier Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Rewrites constraints into smaller, equivalent ones before they are
+/// handed to a solver.
+///
+/// The simplifier folds constants, pushes negations down to the leaves,
+/// flattens chains of conjunctions and disjunctions while removing duplicate
+/// and complementary operands, and drops constraints that always hold. If a
+/// feature model is given, its root is known to be selected and implications
+/// and exclusions that are already enforced by the feature tree are dropped
+/// as well.
+///
+/// Mixed constraints are not meant to be simplified, as their semantics depend
+/// on the binary features they mention.
+class ConstraintSimplifier {
+public:
+  struct Report {
+    /// Constraints that were simplified.
+    size_t NumConstraints = 0;
+    /// Constraints that always hold and were removed.
+    size_t NumRemovedConstraints = 0;
+    /// Nodes of all constraints before simplification.
+    size_t NumNodes = 0;
+    /// Nodes of all constraints after simplification.
+    size_t NumSimplifiedNodes = 0;
+  };
+
+  /// \param FM model whose feature tree is taken into account, if set
+  explicit ConstraintSimplifier(const FeatureModel *FM = nullptr);
+
+  /// Simplifies the boolean or non-boolean constraint \p C. Feature leaves of
+  /// the result refer to the features referenced by \p C.
+  ///
+  /// \returns the simplified constraint or \c nullptr if \p C always holds
+  [[nodiscard]] std::unique_ptr<Constraint> simplify(Constraint &C);
+
+  [[nodiscard]] const Report &getReport() const { return Stats; }
+
+private:
+  using NodeId = ConstraintFactory::NodeId;
+  using Kind = Constraint::ConstraintKind;
+
+  NodeId simplify(NodeId Id);
+
+  /// \returns the simplified negation of the simplified node \p Id
+  NodeId negate(NodeId Id);
+
+  /// Creates the simplified node for an operator over simplified operands.
+  NodeId build(Kind K, NodeId LHS, NodeId RHS);
+
+  /// Creates a flat chain of conjunctions or disjunctions.
+  NodeId buildJunction(Kind K, llvm::SmallVectorImpl<NodeId> &Operands);
+
+  void collectOperands(Kind K, NodeId Id,
+                       llvm::SmallVectorImpl<NodeId> &Operands) const;
+
+  /// \returns the truth value of constant nodes
+  [[nodiscard]] std::optional<bool> getTruth(NodeId Id) const;
+
+  NodeId getTruthNode(bool Value) { return Value ? True : False; }
+
+  /// Whether the feature tree requires \p B whenever \p A is selected.
+  [[nodiscard]] bool treeImplies(NodeId A, NodeId B) const;
+
+  /// Whether the feature tree forbids selecting both \p A and \p B.
+  [[nodiscard]] bool treeExcludes(NodeId A, NodeId B) const;
+
+  [[nodiscard]] const Feature *getModelFeature(NodeId Id) const;
+
+  const FeatureModel *FM;
+  ConstraintFactory Nodes;
+  NodeId True;
+  NodeId False;
+  llvm::DenseMap<NodeId, NodeId> Simplified;
+  llvm::DenseMap<NodeId, NodeId> Negated;
+  Report Stats;
+};
+
+} // namespace vara::feature
+
+#endif // VARA_FEATURE_CONSTRAINTSIMPLIFIER_H
@@ -27,6 +27,32 @@ enum FTErrorCode {
   RECURSIVE_EDGE
 };
 
+namespace detail {
+inline thread_local llvm::raw_ostream *ErrorStream = nullptr;
+} // namespace detail
+
+/// Stream that parsers and consistency checks print their errors to, which is
+/// standard error unless redirected on the current thread.
+inline llvm::raw_ostream &errorStream() {
+  return detail::ErrorStream ? *detail::ErrorStream : llvm::errs();
+}
+
+/// Redirects errorStream() on the current thread to \p OS while in scope and
+/// restores the previous stream afterwards.
+class ScopedErrorStream {
+public:
+  explicit ScopedErrorStream(llvm::raw_ostream &OS)
+      : Previous(detail::ErrorStream) {
+    detail::ErrorStream = &OS;
+  }
+  ScopedErrorStream(const ScopedErrorStream &) = delete;
+  ScopedErrorStream &operator=(const ScopedErrorStream &) = delete;
+  ~ScopedErrorStream() { detail::ErrorStream = Previous; }
+
+private:
+  llvm::raw_ostream *Previous;
+};
+
 } // namespace feature
 
 template <>
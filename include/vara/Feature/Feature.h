@@ -14,6 +14,7 @@
 #include "llvm/IR/Value.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <cstdint>
 #include <set>
 #include <stack>
 #include <utility>
@@ -33,6 +34,7 @@ class FeatureModelModification;
 class Feature : public FeatureTreeNode {
   friend class FeatureModel;
   friend class FeatureModelBuilder;
+  friend class FeatureModelBinaryParser;
   friend class detail::FeatureModelModification;
 
 public:
@@ -40,21 +42,24 @@ public:
 
   Feature(std::string Name)
       : FeatureTreeNode(NodeKind::NK_FEATURE), Kind(FeatureKind::FK_UNKNOWN),
-        Name(std::move(Name)), Opt(false) {}
+        Name(std::move(Name)), FoldedName(llvm::StringRef(this->Name).lower()),
+        NameHash(std::hash<std::string>{}(FoldedName)), Opt(false) {}
   Feature(const Feature &) = delete;
   Feature &operator=(const Feature &) = delete;
   Feature(Feature &&) = delete;
   Feature &operator=(Feature &&) = delete;
   ~Feature() override = default;
 
-  [[nodiscard]] inline std::size_t hash() const {
-    return std::hash<std::string>{}(getName().lower());
-  }
+  /// Hash of the lowercase name, computed once on construction.
+  [[nodiscard]] inline std::size_t hash() const { return NameHash; }
 
   [[nodiscard]] FeatureKind getKind() const { return Kind; }
 
   [[nodiscard]] llvm::StringRef getName() const { return Name; }
 
+  /// Lowercase name used for comparing features.
+  [[nodiscard]] llvm::StringRef getFoldedName() const { return FoldedName; }
+
   [[nodiscard]] llvm::StringRef getOutputString() const { return OutputString; }
 
   [[nodiscard]] bool isOptional() const { return Opt; }
@@ -77,18 +82,41 @@ public:
   /// Compare lowercase name assuming those are unique.
   bool operator==(const vara::feature::Feature &Other) const {
     // TODO(s9latimm): keys in FM are case sensitive
-    return getName().lower() == Other.getName().lower();
+    return NameHash == Other.NameHash && FoldedName == Other.FoldedName;
   }
   bool operator!=(const vara::feature::Feature &Other) const {
     return !operator==(Other);
   }
 
   /// Compare in depth first ordering.
+  ///
+  /// Features of the same model are compared in constant time by their
+  /// pre-order labels, otherwise by their paths to the root.
   bool operator<(const vara::feature::Feature &Other) const;
   bool operator>(const vara::feature::Feature &Other) const {
     return Other.operator<(*this);
   }
 
+  //===--------------------------------------------------------------------===//
+  // Tree queries
+
+  /// Checks whether this feature is a proper ancestor of \p Other.
+  [[nodiscard]] bool isAncestorOf(const Feature &Other) const;
+
+  /// Number of features in the subtree rooted at this feature, including the
+  /// feature itself.
+  [[nodiscard]] unsigned getSubtreeSize() const;
+
+  /// Search the deepest feature that is this feature or one of its ancestors
+  /// and also \p Other or one of its ancestors.
+  ///
+  /// Takes O(log depth) steps if both features carry current labels of the
+  /// same model.
+  ///
+  /// \returns the lowest common ancestor or \c nullptr if both features are
+  /// in different trees
+  [[nodiscard]] Feature *getLowestCommonAncestor(const Feature &Other);
+
   //===--------------------------------------------------------------------===//
   // Locations
   [[nodiscard]] bool hasLocations() const { return !Locations.empty(); }
@@ -187,8 +215,10 @@ protected:
           std::string OutputString = "", FeatureTreeNode *Parent = nullptr,
           const NodeSetType &Children = {})
       : FeatureTreeNode(NodeKind::NK_FEATURE, Parent, Children), Kind(Kind),
-        Name(std::move(Name)), OutputString(std::move(OutputString)),
-        Locations(std::move(Locations)), Opt(Opt) {}
+        Name(std::move(Name)), FoldedName(llvm::StringRef(this->Name).lower()),
+        NameHash(std::hash<std::string>{}(FoldedName)),
+        OutputString(std::move(OutputString)), Locations(std::move(Locations)),
+        Opt(Opt) {}
 
 private:
   void addConstraint(Constraint *C) {
@@ -213,13 +243,48 @@ private:
     }
   }
 
+  /// \brief Position of a feature in the depth first order of its model.
+  ///
+  /// The subtree of a feature covers the pre-order interval
+  /// [PreOrder, PreOrder + SubtreeSize). \a Ancestors holds the 2^K-th
+  /// ancestor at index K to climb the tree in logarithmic steps. Labels are
+  /// assigned by the model and are only valid while \a Epoch matches the
+  /// current epoch of the model.
+  struct TreeLabel {
+    const uint64_t *ModelEpoch{nullptr};
+    uint64_t Epoch{0};
+    unsigned PreOrder{0};
+    unsigned SubtreeSize{0};
+    std::vector<Feature *> Ancestors{};
+  };
+
+  /// Checks whether \p Other is in the subtree of this feature, which requires
+  /// comparable labels.
+  [[nodiscard]] bool labelCovers(const Feature &Other) const {
+    return Label.PreOrder <= Other.Label.PreOrder &&
+           Other.Label.PreOrder < Label.PreOrder + Label.SubtreeSize;
+  }
+
+  [[nodiscard]] bool hasValidLabel() const {
+    return Label.ModelEpoch && *Label.ModelEpoch == Label.Epoch;
+  }
+
+  /// Checks whether both features carry valid labels of the same model.
+  [[nodiscard]] bool hasComparableLabel(const Feature &Other) const {
+    return hasValidLabel() && Label.ModelEpoch == Other.Label.ModelEpoch &&
+           Other.hasValidLabel();
+  }
+
   const FeatureKind Kind;
   std::string Name;
+  std::string FoldedName;
+  std::size_t NameHash;
   std::string OutputString;
   std::vector<FeatureSourceRange> Locations;
   std::vector<Constraint *> Constraints;
   std::vector<ExcludesConstraint *> Excludes;
   std::vector<ImpliesConstraint *> Implications;
+  TreeLabel Label;
   bool Opt;
 };
 
@@ -301,4 +366,13 @@ inline llvm::raw_ostream &operator<<(llvm::raw_ostream &Out,
   return Out;
 }
 
+namespace std {
+template <>
+struct hash<vara::feature::Feature> {
+  std::size_t operator()(const vara::feature::Feature &F) const {
+    return F.hash();
+  }
+};
+} // namespace std
+
 #endif // VARA_FEATURE_FEATURE_H
@@ -11,11 +11,14 @@
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/GraphWriter.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #include <algorithm>
 #include <numeric>
+#include <optional>
 #include <queue>
 #include <utility>
+#include <vector>
 
 namespace vara::feature {
 
@@ -30,6 +33,7 @@ class FeatureModelModification;
 /// \brief Tree like representation of features and dependencies.
 class FeatureModel {
   friend class FeatureModelBuilder;
+  friend class FeatureModelBinaryParser;
   // Only Modifications are allowed to edit a FeatureModel after creation.
   friend class detail::FeatureModelModification;
 
@@ -43,9 +47,18 @@ public:
       fs::path Path = "", std::string Commit = "")
       : Name(std::move(Name)), Root(Root.get()), Path(std::move(Path)),
         Commit(std::move(Commit)) {
-    addFeature(std::move(Root));
+    if (this->Root) {
+      addFeature(std::move(Root));
+    }
   }
 
+  // Features refer to the label epoch of their model, so models stay in place.
+  FeatureModel(const FeatureModel &) = delete;
+  FeatureModel &operator=(const FeatureModel &) = delete;
+  FeatureModel(FeatureModel &&) = delete;
+  FeatureModel &operator=(FeatureModel &&) = delete;
+  ~FeatureModel() = default;
+
   [[nodiscard]] unsigned int size() const { return Features.size(); }
 
   [[nodiscard]] llvm::StringRef getName() const { return Name; }
@@ -68,101 +81,18 @@ public:
   }
 
   //===--------------------------------------------------------------------===//
-  // DFS feature iterator
-
-  class DFSIterator {
-
-  public:
-    using iterator_category = std::forward_iterator_tag;
-    using value_type = Feature *;
-    using difference_type = ptrdiff_t;
-    using pointer = Feature **;
-    using reference = Feature *;
-
-    using const_pointer = const Feature *const *;
-    using const_reference = const Feature *;
-
-    DFSIterator(Feature *F = nullptr) {
-      if (F) {
-        Frontier.push(F);
-      }
-    }
-    DFSIterator(const DFSIterator &) = default;
-    DFSIterator &operator=(const DFSIterator &) = delete;
-    DFSIterator(DFSIterator &&) = default;
-    DFSIterator &operator=(DFSIterator &&) = delete;
-    ~DFSIterator() = default;
-
-    reference operator*() {
-      return Frontier.empty() ? nullptr : Frontier.top();
-    }
-
-    const_reference operator*() const {
-      return Frontier.empty() ? nullptr : Frontier.top();
-    }
-
-    pointer operator->() {
-      return Frontier.empty() ? nullptr : &Frontier.top();
-    }
-
-    const_pointer operator->() const {
-      return Frontier.empty() ? nullptr : &Frontier.top();
-    }
-
-    DFSIterator operator++() {
-      if (Frontier.empty()) {
-        return *this;
-      }
-      auto *F = Frontier.top();
-      Frontier.pop();
-      if (F) {
-        Visited.insert(F);
-        llvm::SmallVector<Feature *, 3> Children;
-        for (auto *C : F->getChildren<Feature>()) {
-          Children.insert(std::upper_bound(Children.begin(), Children.end(), C,
-                                           [](Feature *A, Feature *B) {
-                                             return A->getName().lower() >
-                                                    B->getName().lower();
-                                             ;
-                                           }),
-                          C);
-        }
-        std::for_each(Children.begin(), Children.end(), [this](Feature *C) {
-          if (Visited.find(C) == Visited.end()) {
-            Frontier.push(C);
-          }
-        });
-      }
-      return *this;
-    }
+  // Ordered feature iterator
 
-    DFSIterator operator++(int) {
-      auto Iter(*this);
-      ++*this;
-      return Iter;
-    }
+  /// Features are visited in depth first pre-order, children ordered by their
+  /// case-insensitive name. The order is computed once and cached until the
+  /// structure of the model changes.
+  using const_ordered_feature_iterator = std::vector<Feature *>::const_iterator;
 
-    bool operator==(const DFSIterator &Other) const {
-      if (Frontier.empty() || Other.Frontier.empty()) {
-        return Frontier.empty() && Other.Frontier.empty();
-      }
-      return *this->Frontier.top() == *Other.Frontier.top();
-    };
-
-    bool operator!=(const DFSIterator &Other) const {
-      return !(*this == Other);
-    };
-
-  private:
-    std::stack<Feature *> Frontier;
-    std::set<Feature *> Visited;
-  };
-
-  using const_ordered_feature_iterator = DFSIterator;
-
-  [[nodiscard]] const_ordered_feature_iterator begin() const { return {Root}; }
+  [[nodiscard]] const_ordered_feature_iterator begin() const {
+    return getOrderedFeatures().begin();
+  }
   [[nodiscard]] const_ordered_feature_iterator end() const {
-    return {Root ? Root->getParentFeature() : nullptr};
+    return getOrderedFeatures().end();
   }
 
   [[nodiscard]] llvm::iterator_range<const_ordered_feature_iterator>
@@ -343,9 +273,53 @@ public:
 
   /// Create deep clone of whole data structure.
   ///
+  /// Features, relationships, and constraints are copied structurally, all
+  /// pointers are remapped through a single table from original to copied
+  /// nodes.
+  ///
   /// \return new \a FeatureModel
   [[nodiscard]] std::unique_ptr<FeatureModel> clone() const;
 
+  /// \brief Approximate footprint of a feature model in bytes, split by the
+  /// parts of the model.
+  struct MemoryUsage {
+    struct FeatureKindUsage {
+      unsigned Count{0};
+      size_t Bytes{0};
+    };
+
+    /// Feature objects with their names and per feature containers.
+    FeatureKindUsage BinaryFeatures;
+    FeatureKindUsage NumericFeatures;
+    FeatureKindUsage RootFeatures;
+    FeatureKindUsage UnknownFeatures;
+    /// Location lists of all features.
+    size_t SourceRanges{0};
+    /// Constraint trees with their wrappers.
+    size_t Constraints{0};
+    size_t Relationships{0};
+    /// Hash table and entries of the feature name map.
+    size_t FeatureMap{0};
+    /// Information derived from the tree structure, e.g., the feature order.
+    size_t Caches{0};
+    /// The model object itself with its name, path, and commit.
+    size_t Metadata{0};
+
+    [[nodiscard]] size_t features() const {
+      return BinaryFeatures.Bytes + NumericFeatures.Bytes + RootFeatures.Bytes +
+             UnknownFeatures.Bytes;
+    }
+
+    [[nodiscard]] size_t total() const {
+      return features() + SourceRanges + Constraints + Relationships +
+             FeatureMap + Caches + Metadata;
+    }
+  };
+
+  /// Estimates the memory used by this model, including heap allocations of
+  /// strings and containers owned by it.
+  [[nodiscard]] MemoryUsage memoryUsage() const;
+
   LLVM_DUMP_METHOD
   void dump() const;
 
@@ -371,16 +345,6 @@ private:
 
   RootFeature *setRoot(RootFeature &NewRoot);
 
-  using ordered_feature_iterator = DFSIterator;
-
-  [[nodiscard]] ordered_feature_iterator begin() { return {Root}; }
-  [[nodiscard]] ordered_feature_iterator end() {
-    return {Root ? Root->getParentFeature() : nullptr};
-  }
-
-  [[nodiscard]] llvm::iterator_range<ordered_feature_iterator> features() {
-    return llvm::make_range(begin(), end());
-  }
 
   using unordered_feature_iterator = FeatureMapIterator;
 
@@ -442,11 +406,13 @@ private:
   // Relationships
 
   Relationship *addRelationship(std::unique_ptr<Relationship> Relationship) {
+    invalidateCaches();
     Relationships.push_back(std::move(Relationship));
     return Relationships.back().get();
   }
 
   void removeRelationship(Relationship *R) {
+    invalidateCaches();
     Relationships.erase(
         std::find_if(Relationships.begin(), Relationships.end(),
                      [R](const std::unique_ptr<Relationship> &UniR) {
@@ -460,11 +426,32 @@ private:
     return llvm::make_range(Relationships.begin(), Relationships.end());
   }
 
+  //===--------------------------------------------------------------------===//
+  // Caches
+
+  /// Returns the cached depth first order of all features, computing it if
+  /// necessary.
+  const std::vector<Feature *> &getOrderedFeatures() const;
+
+  /// Recomputes all cached information derived from the tree structure.
+  void rebuildCaches() const;
+
+  /// Drops all cached information derived from the tree structure. Needs to be
+  /// called whenever features, relationships, or edges change.
+  void invalidateCaches() {
+    OrderedFeatures.reset();
+    // Outdates the tree labels of all features.
+    ++LabelEpoch;
+  }
+
   std::string Name;
   RootFeature *Root;
   fs::path Path;
   std::string Commit;
   FeatureMapTy Features;
+  mutable std::optional<std::vector<Feature *>> OrderedFeatures;
+  /// Tree labels of features are valid as long as they carry this epoch.
+  uint64_t LabelEpoch{1};
   BooleanConstraintContainerTy BooleanConstraints;
   NonBooleanConstraintContainerTy NonBooleanConstraints;
   MixedConstraintContainerTy MixedConstraints;
@@ -475,8 +462,55 @@ private:
 //                           FeatureModel Helpers
 //===----------------------------------------------------------------------===//
 
+/// \brief Problem found while loading a feature model.
+struct FeatureModelDiagnostic {
+  /// Line in the input, zero if the problem is not tied to a line.
+  unsigned Line;
+  std::string Message;
+
+  friend llvm::raw_ostream &operator<<(llvm::raw_ostream &OS,
+                                       const FeatureModelDiagnostic &D) {
+    if (D.Line) {
+      OS << D.Line << ':';
+    }
+    return OS << ' ' << D.Message;
+  }
+};
+
+using FeatureModelDiagnostics = std::vector<FeatureModelDiagnostic>;
+
+/// Options for loading a feature model.
+struct FeatureModelLoadOptions {
+  /// Skip the DTD validation of files whose writer checksum is intact.
+  bool TrustedInput = false;
+};
+
 std::unique_ptr<FeatureModel> loadFeatureModel(llvm::StringRef Path);
 
+/// Build a feature model from \p Buffer, which is parsed in place and
+/// released once the model is built.
+std::unique_ptr<FeatureModel>
+loadFeatureModelFromBuffer(std::unique_ptr<llvm::MemoryBuffer> Buffer);
+
+using FeatureModelLoadResult =
+    Result<FeatureModelDiagnostics, std::unique_ptr<FeatureModel>>;
+
+/// Read, validate, and build a feature model with a single read and parse of
+/// the file, instead of calling \a verifyFeatureModel and \a loadFeatureModel.
+///
+/// \returns the feature model or the diagnostics explaining why it could not
+/// be loaded
+[[nodiscard]] FeatureModelLoadResult
+loadFeatureModel(llvm::StringRef Path, const FeatureModelLoadOptions &Options);
+
+/// Load many feature models concurrently on a pool of \p Threads threads, or
+/// one per hardware thread if zero.
+///
+/// \returns one result per path, in the order of \p Paths
+[[nodiscard]] std::vector<FeatureModelLoadResult>
+loadFeatureModels(llvm::ArrayRef<std::string> Paths, unsigned Threads = 0,
+                  const FeatureModelLoadOptions &Options = {});
+
 bool verifyFeatureModel(llvm::StringRef Path);
 
 } // namespace vara::feature
@@ -672,7 +706,7 @@ struct EveryFeatureRequiresParent {
                     })) {
       return true;
     }
-    llvm::errs() << "Failed to validate 'EveryFeatureRequiresParent'." << '\n';
+    errorStream() << "Failed to validate 'EveryFeatureRequiresParent'." << '\n';
     return false;
   }
 };
@@ -690,8 +724,8 @@ struct CheckFeatureParentChildRelationShip {
             })) {
       return true;
     }
-    llvm::errs() << "Failed to validate 'CheckFeatureParentChildRelationShip'."
-                 << '\n';
+    errorStream() << "Failed to validate 'CheckFeatureParentChildRelationShip'."
+                  << '\n';
     return false;
   }
 };
@@ -706,7 +740,7 @@ struct ExactlyOneRootNode {
                              })) {
       return true;
     }
-    llvm::errs() << "Failed to validate 'ExactlyOneRootNode'." << '\n';
+    errorStream() << "Failed to validate 'ExactlyOneRootNode'." << '\n';
     return false;
   }
 };
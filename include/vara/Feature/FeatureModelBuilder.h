@@ -44,11 +44,23 @@ public:
       std::enable_if_t<std::is_base_of_v<Feature, FeatureTy>, bool> = true>
   FeatureModelBuilder *makeFeature(std::string FeatureName,
                                    Args &&...FurtherArgs) {
-    FeatureBuilder.addFeature(std::make_unique<FeatureTy>(
-        FeatureName, std::forward<Args>(FurtherArgs)...));
+    auto NewFeature = std::make_unique<FeatureTy>(
+        FeatureName, std::forward<Args>(FurtherArgs)...);
+    // Only the first feature of a name is added, later ones fail the build.
+    Features.try_emplace(FeatureName, NewFeature.get());
+    FeatureBuilder.addFeature(std::move(NewFeature));
     return this;
   }
 
+  /// Looks up a feature that was made by this builder, e.g., to refer to it
+  /// from constraints before the model is built. The root is not considered,
+  /// as it may still be replaced.
+  ///
+  /// \returns the feature named \p Name or \c nullptr
+  [[nodiscard]] Feature *getFeature(llvm::StringRef Name) const {
+    return Features.lookup(Name);
+  }
+
   FeatureModelBuilder *addEdge(const std::string &ParentName,
                                const std::string &FeatureName) {
     Parents[FeatureName] = ParentName;
@@ -96,13 +108,15 @@ public:
     return this;
   }
 
-  /// Build \a FeatureModel.
+  /// Build \a FeatureModel. Failures are reported to \p OS.
   ///
   /// \return instance of \a FeatureModel
-  std::unique_ptr<FeatureModel> buildFeatureModel();
+  std::unique_ptr<FeatureModel>
+  buildFeatureModel(llvm::raw_ostream &OS = llvm::errs());
 
 private:
   std::unique_ptr<FeatureModel> FM;
+  llvm::StringMap<Feature *> Features;
   llvm::StringMap<std::string> Parents;
   // Modifications to initialize features as children of root.
   FeatureModelTransaction<detail::ModifyTransactionMode> FeatureBuilder;
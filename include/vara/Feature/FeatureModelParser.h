@@ -3,6 +3,8 @@
 
 #include "vara/Feature/FeatureModelBuilder.h"
 
+#include "llvm/Support/MemoryBuffer.h"
+
 #include "libxml/parser.h"
 #include "libxml/tree.h"
 
@@ -43,9 +45,21 @@ public:
 //===----------------------------------------------------------------------===//
 
 /// \brief Parsers for feature models in XML.
+///
+/// The DTD is compiled once per process and shared by all parsers. If
+/// \p TrustedInput is set, documents that end with an intact checksum written
+/// by \a FeatureModelXmlWriter skip the DTD validation, all other documents
+/// are still validated.
 class FeatureModelXmlParser : public FeatureModelParser {
 public:
-  explicit FeatureModelXmlParser(std::string Xml) : Xml(std::move(Xml)) {}
+  explicit FeatureModelXmlParser(std::string Xml, bool TrustedInput = false)
+      : Xml(std::move(Xml)), TrustedInput(TrustedInput) {}
+
+  /// Parses directly from \p Buffer, e.g., a memory mapped file, without
+  /// copying its content.
+  explicit FeatureModelXmlParser(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+                                 bool TrustedInput = false)
+      : Buffer(std::move(Buffer)), TrustedInput(TrustedInput) {}
 
   /// Check if XML is a valid feature model according to DTD.
   ///
@@ -54,6 +68,14 @@ public:
 
   std::unique_ptr<FeatureModel> buildFeatureModel() override;
 
+  /// Parse, validate, and build the feature model in a single pass. Problems
+  /// are collected instead of printed.
+  ///
+  /// \returns the feature model or the diagnostics explaining why it could
+  /// not be built
+  Result<FeatureModelDiagnostics, std::unique_ptr<FeatureModel>>
+  buildVerifiedFeatureModel();
+
   /// This method is solely relevant for parsing XML, as alternatives are
   /// represented als mutual excluded but non-optional features (which requires
   /// additional processing).
@@ -61,11 +83,16 @@ public:
 
 private:
   std::string Xml;
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  bool TrustedInput;
   FeatureModelBuilder FMB;
+  /// Collects problems instead of printing them, if set.
+  FeatureModelDiagnostics *Diagnostics = nullptr;
+
+  void report(const llvm::Twine &Message, unsigned Line = 0);
 
   Result<FTErrorCode> parseConfigurationOption(xmlNode *Node, bool Num);
   Result<FTErrorCode> parseOptions(xmlNode *Node, bool Num);
-  template <class ConstraintTy>
   Result<FTErrorCode> parseConstraints(xmlNode *Node);
   Result<FTErrorCode> parseVm(xmlNode *Node);
 
@@ -76,8 +103,67 @@ private:
   static FeatureSourceRange createFeatureSourceRange(xmlNode *Node);
   static long parseNumber(llvm::StringRef Str);
 
+  [[nodiscard]] llvm::StringRef getXml() const {
+    return Buffer ? Buffer->getBuffer() : llvm::StringRef(Xml);
+  }
+
   UniqueXmlDoc parseDoc();
-  static UniqueXmlDtd createDtd();
+  static xmlDtd *getDtd();
+};
+
+//===----------------------------------------------------------------------===//
+//                       FeatureModelXmlStreamParser Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Streaming parser for feature models in XML.
+///
+/// In contrast to \a FeatureModelXmlParser, no DOM is built. The input is fed
+/// to the SAX interface of libxml2 in chunks and every element is passed on
+/// to the \a FeatureModelBuilder as soon as it is closed, so only the text of
+/// the current element and the state of the enclosing elements are buffered.
+/// Instead of a full DTD validation, the parser checks that every element is
+/// nested as required by the DTD.
+class FeatureModelXmlStreamParser : public FeatureModelParser {
+public:
+  explicit FeatureModelXmlStreamParser(std::string Xml) : Xml(std::move(Xml)) {}
+
+  /// Parses directly from \p Buffer, e.g., a memory mapped file, without
+  /// copying its content.
+  explicit FeatureModelXmlStreamParser(
+      std::unique_ptr<llvm::MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  /// Parses the file at \p Path, which is read in chunks while parsing
+  /// instead of being loaded up front.
+  static std::unique_ptr<FeatureModelXmlStreamParser>
+  fromFile(llvm::StringRef Path) {
+    std::unique_ptr<FeatureModelXmlStreamParser> P(
+        new FeatureModelXmlStreamParser(std::string()));
+    P->Path = Path.str();
+    return P;
+  }
+
+  /// Check if XML is well-formed and its elements are nested like the DTD
+  /// requires. Unlike the DOM parser, ambiguous parent-child edges are
+  /// reported here as well.
+  ///
+  /// \return possible error if inconsistent
+  Result<FTErrorCode> verifyFeatureModel() override;
+
+  std::unique_ptr<FeatureModel> buildFeatureModel() override;
+
+private:
+  [[nodiscard]] llvm::StringRef getXml() const {
+    return Buffer ? Buffer->getBuffer() : llvm::StringRef(Xml);
+  }
+
+  Result<FTErrorCode> parse(FeatureModelBuilder &B);
+
+  std::string Xml;
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  /// File to read from instead of \a Xml or \a Buffer, if set.
+  std::string Path;
+  FeatureModelBuilder FMB;
 };
 
 //===----------------------------------------------------------------------===//
@@ -179,10 +265,11 @@ public:
 
 private:
   /// Returns a pointer to the dtd representation of the xml file, which
-  /// is needed to verify the structure of the xml file.
+  /// is needed to verify the structure of the xml file. The dtd is compiled
+  /// once and shared for the lifetime of the process.
   ///
   /// \returns a pointer to the dtd representation
-  static UniqueXmlDtd createDtd();
+  static xmlDtd *getDtd();
 
   /// Parses the given xml file by using libxml2 and returns a pointer to
   /// the xml document.
@@ -241,6 +328,52 @@ private:
   std::unordered_map<std::string, std::string> IdentifierMap;
 };
 
+//===----------------------------------------------------------------------===//
+//                        FeatureModelBinaryParser Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Parser for feature models written by \a FeatureModelBinaryWriter.
+///
+/// The input is read in place, e.g., from a memory mapped file, and the model
+/// is constructed in a single pass over the records without going through
+/// \a FeatureModelBuilder. Every count, index, and string reference is
+/// checked against the input, so damaged files are rejected instead of
+/// producing broken models.
+class FeatureModelBinaryParser : public FeatureModelParser {
+public:
+  explicit FeatureModelBinaryParser(std::string Data) : Data(std::move(Data)) {}
+
+  /// Parses directly from \p Buffer without copying its content.
+  explicit FeatureModelBinaryParser(std::unique_ptr<llvm::MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  /// Checks whether \p Data starts like a binary feature model.
+  static bool isBinaryFeatureModel(llvm::StringRef Data);
+
+  /// Decodes the whole input, as the records can only be checked together.
+  ///
+  /// \return possible error if inconsistent
+  Result<FTErrorCode> verifyFeatureModel() override;
+
+  std::unique_ptr<FeatureModel> buildFeatureModel() override;
+
+  /// Build the feature model, problems are collected instead of printed.
+  Result<FeatureModelDiagnostics, std::unique_ptr<FeatureModel>>
+  buildVerifiedFeatureModel();
+
+private:
+  [[nodiscard]] llvm::StringRef getData() const {
+    return Buffer ? Buffer->getBuffer() : llvm::StringRef(Data);
+  }
+
+  void report(const llvm::Twine &Message);
+
+  std::string Data;
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  /// Collects problems instead of printing them, if set.
+  FeatureModelDiagnostics *Diagnostics = nullptr;
+};
+
 } // namespace vara::feature
 
 #endif // VARA_FEATURE_FEATUREMODELPARSER_H
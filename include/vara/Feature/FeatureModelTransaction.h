@@ -68,7 +68,7 @@ public:
       if (this->isUncommitted()) {
         // In modification mode we should ensure that changes are committed
         //  before destruction
-        llvm::errs()
+        errorStream()
             << "warning: Uncommitted modifications before destruction.\n";
         commit();
       }
@@ -193,15 +193,10 @@ public:
   virtual Result<FTErrorCode> exec(FeatureModel &FM) = 0;
 
 protected:
-  /// \brief Set the parent of a \a Feature.
-  static void setParent(FeatureTreeNode &F, FeatureTreeNode &Parent) {
-    F.setParent(&Parent);
-  }
-
   /// \brief Remove the parent of a \a Feature.
   static void removeParent(FeatureTreeNode &F) { F.setParent(nullptr); }
 
-  /// \brief Add a \a Feature Child to F.
+  /// \brief Add a \a Feature Child to F, which becomes its parent.
   static void addEdge(FeatureTreeNode &F, FeatureTreeNode &Child) {
     F.addEdge(&Child);
   }
@@ -270,6 +265,13 @@ protected:
     return FM.setRoot(NewRoot);
   }
 
+  /// \brief Drop the cached structural information of a \a FeatureModel.
+  static void invalidateCaches(FeatureModel &FM) { FM.invalidateCaches(); }
+
+  /// \brief Recompute the cached structural information of a \a FeatureModel
+  /// after its tree was changed.
+  static void rebuildCaches(FeatureModel &FM) { FM.rebuildCaches(); }
+
   /// \brief Remove \a Feature from a \a FeatureModel.
   ///
   /// \param FM model to remove from
@@ -310,10 +312,8 @@ public:
       return ALREADY_PRESENT;
     }
     if (Parent) {
-      setParent(*InsertedFeature, *Parent);
       addEdge(*Parent, *InsertedFeature);
     } else if (FM.getRoot()) {
-      setParent(*InsertedFeature, *FM.getRoot());
       addEdge(*FM.getRoot(), *InsertedFeature);
     }
     return InsertedFeature;
@@ -415,14 +415,12 @@ public:
         },
         Parent);
 
-    setParent(*InsertedRelationship, *P);
     addEdge(*P, *InsertedRelationship);
 
     for (auto *C : P->getChildren<Feature>()) {
       assert(P->hasEdgeTo(*C) && C->hasEdgeFrom(*P));
       removeEdge(*P, *C);
       addEdge(*InsertedRelationship, *C);
-      setParent(*C, *InsertedRelationship);
     }
 
     return InsertedRelationship;
@@ -472,7 +470,6 @@ public:
       assert(R->hasEdgeTo(*C) && C->hasEdgeFrom(*R));
       removeEdge(*R, *C);
       addEdge(*P, *C);
-      setParent(*C, *P);
     }
     removeRelationship(FM, R);
     return Ok();
@@ -706,7 +703,6 @@ public:
   Result<FTErrorCode, RootFeature *> operator()(FeatureModel &FM) {
     if (FM.getRoot() && FM.getRoot()->getName() == Root->getName()) {
       for (auto *C : Root->children()) {
-        setParent(*C, *FM.getRoot());
         addEdge(*FM.getRoot(), *C);
       }
       for (auto *C : FM.getRoot()->children()) {
@@ -723,7 +719,6 @@ public:
     }
     if (FM.getRoot()) {
       for (auto *C : FM.getRoot()->children()) {
-        setParent(*C, *InsertedRoot);
         addEdge(*InsertedRoot, *C);
       }
       for (auto *C : InsertedRoot->children()) {
@@ -787,11 +782,13 @@ public:
       return RECURSIVE_EDGE;
     }
 
+    if (C->getParent() == P) {
+      return Ok();
+    }
     if (C->getParent()) {
       removeEdge(*C->getParent(), *C);
     }
     addEdge(*P, *C);
-    setParent(*C, *P);
     return Ok();
   }
 
@@ -803,6 +800,10 @@ private:
   FeatureTreeNodeVariantTy Parent;
 };
 
+/// \brief Base of transactions that modify a copy of a feature model.
+///
+/// The copy is a full clone of the original taken when the transaction is
+/// opened, so later changes to the original do not leak into it.
 class FeatureModelCopyTransactionBase {
 protected:
   FeatureModelCopyTransactionBase(FeatureModel &FM) : FM(FM.clone()) {}
@@ -810,6 +811,7 @@ protected:
   [[nodiscard]] inline Result<FTErrorCode, std::unique_ptr<FeatureModel>>
   commitImpl() {
     if (isUncommitted() && FM && ConsistencyCheck::isFeatureModelValid(*FM)) {
+      FeatureModelModification::rebuildCaches(*FM);
       return std::move(FM);
     }
     abortImpl();
@@ -980,14 +982,17 @@ protected:
       for (const std::unique_ptr<FeatureModelModification> &FMM :
            Modifications) {
         if (auto E = FMM->exec(*FM); !E) {
+          FeatureModelModification::invalidateCaches(*FM);
           abortImpl();
           return E;
         }
       }
+      FeatureModelModification::invalidateCaches(*FM);
       if (auto E = ConsistencyCheck::isFeatureModelValid(*FM); !E) {
         abortImpl();
         return E;
       }
+      FeatureModelModification::rebuildCaches(*FM);
       FM = nullptr;
       return Ok();
     }
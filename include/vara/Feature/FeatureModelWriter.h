@@ -35,9 +35,15 @@ public:
 //===----------------------------------------------------------------------===//
 
 /// \brief Parsers for feature models in XML.
+///
+/// With \p WithChecksum, the document ends with a comment containing a
+/// checksum of its content, which lets \a FeatureModelXmlParser skip the DTD
+/// validation for unchanged files on request.
 class FeatureModelXmlWriter : public FeatureModelWriter {
 public:
-  explicit FeatureModelXmlWriter(const FeatureModel &FM) : FM{FM} {}
+  explicit FeatureModelXmlWriter(const FeatureModel &FM,
+                                 bool WithChecksum = false)
+      : FM{FM}, WithChecksum(WithChecksum) {}
 
   int writeFeatureModel(std::string Path) override;
   std::optional<std::string> writeFeatureModel() override;
@@ -55,6 +61,28 @@ private:
                               FeatureSourceRange &Location);
 
   const FeatureModel &FM;
+  bool WithChecksum;
+};
+
+//===----------------------------------------------------------------------===//
+//                         FeatureModelBinaryWriter Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Writer for feature models in the compact binary format.
+///
+/// The output can be memory mapped and is read by \a FeatureModelBinaryParser
+/// without validating or re-parsing any text. Writing fails for models that
+/// cannot be represented, i.e., features with more than one relationship or
+/// with a relationship next to other children.
+class FeatureModelBinaryWriter : public FeatureModelWriter {
+public:
+  explicit FeatureModelBinaryWriter(const FeatureModel &FM) : FM{FM} {}
+
+  int writeFeatureModel(std::string Path) override;
+  std::optional<std::string> writeFeatureModel() override;
+
+private:
+  const FeatureModel &FM;
 };
 
 } // namespace vara::feature
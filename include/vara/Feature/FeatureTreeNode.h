@@ -3,8 +3,8 @@
 
 #include "vara/Feature/FeatureSourceRange.h"
 
-#include "llvm/ADT/DirectedGraph.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/IR/Function.h"
@@ -28,15 +28,23 @@ class FeatureModelModification;
 //                          FeatureTreeNode Class
 //===----------------------------------------------------------------------===//
 
-class FeatureTreeNode : private llvm::DGNode<FeatureTreeNode, FeatureTreeNode> {
+/// \brief Node of the feature tree.
+///
+/// Children are kept in insertion order in a contiguous array, which is
+/// cheaper to traverse than a set for the small fan-out of feature trees.
+class FeatureTreeNode {
   friend class FeatureModel;
   friend class FeatureModelBuilder;
+  friend class FeatureModelBinaryParser;
   friend class detail::FeatureModelModification;
 
 public:
   enum class NodeKind { NK_FEATURE, NK_RELATIONSHIP };
 
   using NodeSetType = typename llvm::SmallSet<FeatureTreeNode *, 3>;
+  using ChildrenContainerTy = llvm::SmallVector<FeatureTreeNode *, 4>;
+  using iterator = typename ChildrenContainerTy::iterator;
+  using const_iterator = typename ChildrenContainerTy::const_iterator;
 
   FeatureTreeNode(NodeKind Kind) : Kind(Kind){};
   FeatureTreeNode(FeatureTreeNode &) = delete;
@@ -59,11 +67,11 @@ public:
   //===--------------------------------------------------------------------===//
   // Children
 
-  [[nodiscard]] iterator begin() { return DGNode::begin(); }
-  [[nodiscard]] const_iterator begin() const { return DGNode::begin(); }
+  [[nodiscard]] iterator begin() { return Children.begin(); }
+  [[nodiscard]] const_iterator begin() const { return Children.begin(); }
 
-  [[nodiscard]] iterator end() { return DGNode::end(); }
-  [[nodiscard]] const_iterator end() const { return DGNode::end(); }
+  [[nodiscard]] iterator end() { return Children.end(); }
+  [[nodiscard]] const_iterator end() const { return Children.end(); }
 
   [[nodiscard]] llvm::iterator_range<iterator> children() {
     return llvm::make_range(begin(), end());
@@ -103,22 +111,39 @@ protected:
   FeatureTreeNode(NodeKind Kind, FeatureTreeNode *Parent,
                   const llvm::SmallPtrSetImpl<FeatureTreeNode *> &Children)
       : Kind(Kind), Parent(Parent) {
-    this->Edges.insert(Children.begin(), Children.end());
+    for (auto *C : Children) {
+      addEdge(C);
+    }
   }
 
   FeatureTreeNode(NodeKind Kind, FeatureTreeNode *Parent,
                   const std::vector<FeatureTreeNode *> &Children)
       : Kind(Kind), Parent(Parent) {
-    this->Edges.insert(Children.begin(), Children.end());
+    for (auto *C : Children) {
+      addEdge(C);
+    }
   }
 
 private:
   void setParent(FeatureTreeNode *Feature) { Parent = Feature; }
 
-  bool addEdge(FeatureTreeNode *Feature) { return DGNode::addEdge(*Feature); }
+  /// Adds an edge to \p Feature and makes this node its parent. Modifications
+  /// link a node to a new parent right after removing its old edge, so the
+  /// parent mirrors the edge and a duplicate is found without a search.
+  bool addEdge(FeatureTreeNode *Feature) {
+    if (Feature->Parent == this) {
+      return false;
+    }
+    Feature->Parent = this;
+    Children.push_back(Feature);
+    return true;
+  }
 
   void removeEdge(FeatureTreeNode *Feature) {
-    return DGNode::removeEdge(*Feature);
+    auto *Search = std::find(Children.begin(), Children.end(), Feature);
+    if (Search != Children.end()) {
+      Children.erase(Search);
+    }
   }
 
   template <typename T>
@@ -138,6 +163,7 @@ private:
 
   const NodeKind Kind;
   FeatureTreeNode *Parent{nullptr};
+  ChildrenContainerTy Children;
 };
 } // namespace vara::feature
 
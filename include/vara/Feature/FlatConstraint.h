@@ -0,0 +1,114 @@
+#ifndef VARA_FEATURE_FLATCONSTRAINT_H
+#define VARA_FEATURE_FLATCONSTRAINT_H
+
+#include "vara/Feature/Constraint.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace vara::feature {
+
+class Feature;
+
+//===----------------------------------------------------------------------===//
+//                            FlatConstraint Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Compact representation of a constraint tree as one contiguous array
+/// of nodes in post-order.
+///
+/// Operands always precede their operator: the only or right operand of an
+/// operator at index I is at I - 1, the left operand of a binary operator is
+/// stored in the node. Traversals are therefore simple loops over the array
+/// instead of virtual calls through the \a Constraint hierarchy. Feature leaves
+/// refer to features without owning them.
+class FlatConstraint {
+public:
+  struct Node {
+    Constraint::ConstraintKind Kind;
+    /// Index of the left operand of binary operators.
+    uint32_t LeftOperand = 0;
+    union {
+      Feature *F;
+      int64_t Value;
+    };
+
+    [[nodiscard]] Feature *getFeature() const {
+      assert(Kind == Constraint::ConstraintKind::CK_FEATURE);
+      return F;
+    }
+
+    [[nodiscard]] int64_t getValue() const {
+      assert(Kind == Constraint::ConstraintKind::CK_INTEGER);
+      return Value;
+    }
+  };
+
+  FlatConstraint() = default;
+
+  /// Flattens the constraint tree \p C.
+  static FlatConstraint fromConstraint(Constraint &C);
+
+  /// Rebuilds the constraint tree, the flat constraint has to be complete.
+  ///
+  /// \param Leaves receives the feature leaves of the tree in order, if set
+  [[nodiscard]] std::unique_ptr<Constraint>
+  toConstraint(llvm::SmallVectorImpl<PrimaryFeatureConstraint *> *Leaves =
+                   nullptr) const;
+
+  /// Number of operands of constraints of \p Kind, or \c std::nullopt for
+  /// abstract kinds like \c CK_BINARY and values outside of the enumeration.
+  static std::optional<unsigned> getArity(Constraint::ConstraintKind Kind);
+
+  //===--------------------------------------------------------------------===//
+  // Construction in post-order
+
+  void pushFeature(Feature *F);
+
+  void pushInteger(int64_t Value);
+
+  /// Appends an operator over the last complete operands.
+  ///
+  /// \returns \c false if \p Kind is no operator or its operands are missing
+  bool pushOperator(Constraint::ConstraintKind Kind);
+
+  /// Whether the nodes form exactly one constraint tree.
+  [[nodiscard]] bool isComplete() const { return Roots.size() == 1; }
+
+  //===--------------------------------------------------------------------===//
+  // Access
+
+  [[nodiscard]] llvm::ArrayRef<Node> nodes() const { return Nodes; }
+
+  [[nodiscard]] size_t size() const { return Nodes.size(); }
+
+  [[nodiscard]] bool empty() const { return Nodes.empty(); }
+
+  [[nodiscard]] const Node &operator[](size_t I) const { return Nodes[I]; }
+
+  /// Replaces the feature of every feature leaf by \p Map(feature).
+  void remapFeatures(llvm::function_ref<Feature *(Feature *)> Map);
+
+  /// Evaluates the constraint where features have the value given by
+  /// \p ValueOf. Boolean results are \c 1 or \c 0 and every non-zero value
+  /// counts as true.
+  ///
+  /// \returns the value or \c std::nullopt on a division by zero
+  [[nodiscard]] std::optional<int64_t> evaluate(
+      llvm::function_ref<int64_t(const Feature &)> ValueOf) const;
+
+private:
+  std::vector<Node> Nodes;
+  /// Indices of the roots of complete subtrees that are not yet operands.
+  llvm::SmallVector<uint32_t, 4> Roots;
+};
+
+} // namespace vara::feature
+
+#endif // VARA_FEATURE_FLATCONSTRAINT_H
@@ -0,0 +1,153 @@
+#ifndef VARA_FEATURE_FROZENFEATUREMODEL_H
+#define VARA_FEATURE_FROZENFEATUREMODEL_H
+
+#include "vara/Feature/FeatureModel.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include <climits>
+#include <memory>
+#include <vector>
+
+namespace vara::feature {
+
+//===----------------------------------------------------------------------===//
+//                          FrozenFeatureModel Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Immutable view of a feature model for concurrent readers.
+///
+/// The view takes ownership of the model, so it can no longer be modified by
+/// transactions, and precomputes all derived tree information on
+/// construction. Afterwards, no member function mutates or lazily computes
+/// any state, which makes all of them safe to call concurrently from multiple
+/// threads without synchronization. The same holds for the const member
+/// functions of the wrapped model and its features.
+class FrozenFeatureModel {
+public:
+  using const_iterator = llvm::ArrayRef<const Feature *>::iterator;
+
+  /// Index of features that are not part of the model.
+  static constexpr unsigned NoIndex = UINT_MAX;
+
+  explicit FrozenFeatureModel(std::unique_ptr<FeatureModel> FM);
+  FrozenFeatureModel(const FrozenFeatureModel &) = delete;
+  FrozenFeatureModel &operator=(const FrozenFeatureModel &) = delete;
+  FrozenFeatureModel(FrozenFeatureModel &&) = delete;
+  FrozenFeatureModel &operator=(FrozenFeatureModel &&) = delete;
+  ~FrozenFeatureModel() = default;
+
+  [[nodiscard]] const FeatureModel &getModel() const { return *FM; }
+
+  [[nodiscard]] llvm::StringRef getName() const { return FM->getName(); }
+
+  [[nodiscard]] unsigned size() const { return Features.size(); }
+
+  //===--------------------------------------------------------------------===//
+  // Features
+
+  [[nodiscard]] const RootFeature *getRoot() const { return FM->getRoot(); }
+
+  [[nodiscard]] const Feature *getFeature(llvm::StringRef Name) const {
+    return FM->getFeature(Name);
+  }
+
+  /// Features in depth first pre-order, same as iterating the model.
+  [[nodiscard]] llvm::ArrayRef<const Feature *> features() const {
+    return Features;
+  }
+
+  [[nodiscard]] const_iterator begin() const { return features().begin(); }
+  [[nodiscard]] const_iterator end() const { return features().end(); }
+
+  /// Position of the feature in pre-order.
+  ///
+  /// \returns the index or \c NoIndex if the feature is not part of the model
+  [[nodiscard]] unsigned getIndex(const Feature &F) const {
+    auto Search = Indices.find(&F);
+    return Search != Indices.end() ? Search->second : NoIndex;
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Tree queries
+
+  /// Closest feature above \p F, looking through relationships.
+  [[nodiscard]] const Feature *getParentFeature(const Feature &F) const {
+    unsigned I = getIndex(F);
+    return I == NoIndex || Parents[I] == NoIndex ? nullptr
+                                                 : Features[Parents[I]];
+  }
+
+  /// Closest features below \p F, looking through relationships, ordered by
+  /// their case-insensitive name.
+  [[nodiscard]] llvm::ArrayRef<const Feature *>
+  getChildFeatures(const Feature &F) const {
+    unsigned I = getIndex(F);
+    if (I == NoIndex) {
+      return {};
+    }
+    return llvm::makeArrayRef(Children).slice(
+        ChildOffsets[I], ChildOffsets[I + 1] - ChildOffsets[I]);
+  }
+
+  /// Relationship that groups \p F with its siblings, if any.
+  [[nodiscard]] const Relationship *
+  getParentRelationship(const Feature &F) const {
+    unsigned I = getIndex(F);
+    return I == NoIndex ? nullptr : ParentRelationships[I];
+  }
+
+  /// Number of features between \p F and the root, zero for the root.
+  [[nodiscard]] unsigned getDepth(const Feature &F) const {
+    unsigned I = getIndex(F);
+    return I == NoIndex ? 0 : Depths[I];
+  }
+
+  /// Features of the subtree rooted at \p F in pre-order, starting with \p F.
+  [[nodiscard]] llvm::ArrayRef<const Feature *>
+  getSubtree(const Feature &F) const {
+    unsigned I = getIndex(F);
+    if (I == NoIndex) {
+      return {};
+    }
+    return features().slice(I, SubtreeEnds[I] - I);
+  }
+
+  /// Checks whether \p Ancestor is a proper ancestor of \p F.
+  [[nodiscard]] bool isAncestorOf(const Feature &Ancestor,
+                                  const Feature &F) const {
+    unsigned A = getIndex(Ancestor);
+    unsigned I = getIndex(F);
+    return A != NoIndex && I != NoIndex && A < I && I < SubtreeEnds[A];
+  }
+
+  /// Search the deepest feature that is an ancestor of, or equal to, both
+  /// \p LHS and \p RHS.
+  ///
+  /// \returns the lowest common ancestor or \c nullptr if one of the features
+  /// is not part of the model
+  [[nodiscard]] const Feature *
+  getLowestCommonAncestor(const Feature &LHS, const Feature &RHS) const;
+
+private:
+  std::unique_ptr<const FeatureModel> FM;
+  std::vector<const Feature *> Features;
+  llvm::DenseMap<const Feature *, unsigned> Indices;
+  /// Per feature data indexed by pre-order position.
+  std::vector<unsigned> Parents;
+  std::vector<unsigned> Depths;
+  std::vector<unsigned> SubtreeEnds;
+  std::vector<const Relationship *> ParentRelationships;
+  /// Children of feature I are Children[ChildOffsets[I], ChildOffsets[I+1]).
+  std::vector<unsigned> ChildOffsets;
+  std::vector<const Feature *> Children;
+};
+
+/// Turns the model into an immutable view that can be shared between threads.
+[[nodiscard]] std::shared_ptr<const FrozenFeatureModel>
+freeze(std::unique_ptr<FeatureModel> FM);
+
+} // namespace vara::feature
+
+#endif // VARA_FEATURE_FROZENFEATUREMODEL_H
@@ -56,6 +56,12 @@ public:
 
   [[nodiscard]] double operator()(double Value) { return next(Value); }
 
+  [[nodiscard]] StepOperation getOperation() const { return Op; }
+
+  [[nodiscard]] const OperandVariantType &getLHS() const { return LHS; }
+
+  [[nodiscard]] const OperandVariantType &getRHS() const { return RHS; }
+
   [[nodiscard]] std::string toString() const {
     if (std::holds_alternative<double>(RHS)) {
       assert(std::holds_alternative<std::string>(LHS));
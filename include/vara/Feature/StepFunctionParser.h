@@ -1,6 +1,7 @@
 #ifndef VARA_FEATURE_STEPFUNCTIONPARSER_H
 #define VARA_FEATURE_STEPFUNCTIONPARSER_H
 
+#include "vara/Feature/Error.h"
 #include "vara/Feature/StepFunction.h"
 
 #include <llvm/ADT/StringExtras.h>
@@ -176,23 +177,23 @@ private:
       switch (peek().getKind()) {
       case StepFunctionToken::TokenKind::ERROR:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Lexical error: Unexpected character '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Lexical error: Unexpected character '"
+                      << *peek().getValue() << "'\n";
         return std::nullopt;
       case StepFunctionToken::TokenKind::END_OF_FILE:
-        llvm::errs() << "Syntax error: Unexpected end of expression.\n";
+        errorStream() << "Syntax error: Unexpected end of expression.\n";
         return std::nullopt;
       case StepFunctionToken::TokenKind::WHITESPACE:
         consume(StepFunctionToken::TokenKind::WHITESPACE);
         continue;
       case StepFunctionToken::TokenKind::PLUS:
-        llvm::errs() << "Lexical error: Unexpected operator '+'.\n";
+        errorStream() << "Lexical error: Unexpected operator '+'.\n";
         return std::nullopt;
       case StepFunctionToken::TokenKind::STAR:
-        llvm::errs() << "Lexical error: Unexpected operator '*'.\n";
+        errorStream() << "Lexical error: Unexpected operator '*'.\n";
         return std::nullopt;
       case StepFunctionToken::TokenKind::CARET:
-        llvm::errs() << "Lexical error: Unexpected operator '^'.\n";
+        errorStream() << "Lexical error: Unexpected operator '^'.\n";
         return std::nullopt;
       case StepFunctionToken::TokenKind::IDENTIFIER:
         assert(peek().getValue().has_value());
@@ -212,11 +213,11 @@ private:
       switch (peek().getKind()) {
       case StepFunctionToken::TokenKind::ERROR:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Lexical error: Unexpected character '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Lexical error: Unexpected character '"
+                      << *peek().getValue() << "'\n";
         return std::nullopt;
       case StepFunctionToken::TokenKind::END_OF_FILE:
-        llvm::errs() << "Syntax error: Unexpected end of expression.\n";
+        errorStream() << "Syntax error: Unexpected end of expression.\n";
         return std::nullopt;
       case StepFunctionToken::TokenKind::WHITESPACE:
         consume(StepFunctionToken::TokenKind::WHITESPACE);
@@ -232,13 +233,13 @@ private:
         return StepFunction::StepOperation::EXPONENTIATION;
       case StepFunctionToken::TokenKind::IDENTIFIER:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Syntax error: Unexpected identifier '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Syntax error: Unexpected identifier '"
+                      << *peek().getValue() << "'\n";
         return std::nullopt;
       case StepFunctionToken::TokenKind::NUMBER:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Syntax error: Unexpected number '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Syntax error: Unexpected number '"
+                      << *peek().getValue() << "'\n";
         return std::nullopt;
       }
     }
@@ -250,8 +251,8 @@ private:
       switch (peek().getKind()) {
       case StepFunctionToken::TokenKind::ERROR:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Lexical error: Unexpected character '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Lexical error: Unexpected character '"
+                      << *peek().getValue() << "'\n";
         return false;
       case StepFunctionToken::TokenKind::END_OF_FILE:
         return true;
@@ -259,23 +260,23 @@ private:
         consume(StepFunctionToken::TokenKind::WHITESPACE);
         continue;
       case StepFunctionToken::TokenKind::PLUS:
-        llvm::errs() << "Lexical error: Unexpected operator '+'.\n";
+        errorStream() << "Lexical error: Unexpected operator '+'.\n";
         return false;
       case StepFunctionToken::TokenKind::STAR:
-        llvm::errs() << "Lexical error: Unexpected operator '*'.\n";
+        errorStream() << "Lexical error: Unexpected operator '*'.\n";
         return false;
       case StepFunctionToken::TokenKind::CARET:
-        llvm::errs() << "Lexical error: Unexpected operator '^'.\n";
+        errorStream() << "Lexical error: Unexpected operator '^'.\n";
         return false;
       case StepFunctionToken::TokenKind::IDENTIFIER:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Syntax error: Unexpected identifier '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Syntax error: Unexpected identifier '"
+                      << *peek().getValue() << "'\n";
         return false;
       case StepFunctionToken::TokenKind::NUMBER:
         assert(peek().getValue().has_value());
-        llvm::errs() << "Syntax error: Unexpected number '"
-                     << *peek().getValue() << "'\n";
+        errorStream() << "Syntax error: Unexpected number '"
+                      << *peek().getValue() << "'\n";
         return false;
       }
     }
@@ -301,12 +302,12 @@ private:
 
     if (std::holds_alternative<std::string>(LHS.value()) &&
         std::holds_alternative<std::string>(RHS.value())) {
-      llvm::errs() << "Syntax error: Missing constant.\n";
+      errorStream() << "Syntax error: Missing constant.\n";
       return nullptr;
     }
     if (std::holds_alternative<double>(LHS.value()) &&
         std::holds_alternative<double>(RHS.value())) {
-      llvm::errs() << "Syntax error: Missing operand.\n";
+      errorStream() << "Syntax error: Missing operand.\n";
       return nullptr;
     }
 
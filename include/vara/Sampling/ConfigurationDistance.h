@@ -0,0 +1,165 @@
+#ifndef VARA_SAMPLING_CONFIGURATIONDISTANCE_H
+#define VARA_SAMPLING_CONFIGURATIONDISTANCE_H
+
+#include "vara/Configuration/Configuration.h"
+#include "vara/Feature/FeatureModel.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vara::sampling {
+
+//===----------------------------------------------------------------------===//
+//                          PackedConfiguration Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Packed representation of a configuration: binary options are stored
+/// as bits, numeric options as values normalized to [0, 1].
+struct PackedConfiguration {
+  std::vector<uint64_t> Bits;
+  std::vector<double> Numerics;
+};
+
+/// Number of differing binary options.
+[[nodiscard]] unsigned hammingDistance(llvm::ArrayRef<uint64_t> LHS,
+                                       llvm::ArrayRef<uint64_t> RHS);
+
+/// Sum of the absolute differences of normalized numeric options.
+[[nodiscard]] double numericDistance(llvm::ArrayRef<double> LHS,
+                                     llvm::ArrayRef<double> RHS);
+
+/// Distance between two packed configurations, every option contributes a
+/// value between 0 and 1.
+[[nodiscard]] inline double distance(const PackedConfiguration &LHS,
+                                     const PackedConfiguration &RHS) {
+  return hammingDistance(LHS.Bits, RHS.Bits) +
+         numericDistance(LHS.Numerics, RHS.Numerics);
+}
+
+//===----------------------------------------------------------------------===//
+//                        ConfigurationEncoding Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Maps the options of configurations onto their packed representation.
+///
+/// Options that are not part of the encoding are ignored while packing,
+/// missing binary options are treated as disabled and missing numeric options
+/// as their minimal value.
+class ConfigurationEncoding {
+public:
+  ConfigurationEncoding() = default;
+
+  /// Creates an encoding for all binary and numeric features of the model.
+  explicit ConfigurationEncoding(const feature::FeatureModel &FM);
+
+  /// Creates an encoding from sampled configurations: boolean options are
+  /// encoded as binary options and integer options as numeric options ranging
+  /// over the observed values.
+  [[nodiscard]] static ConfigurationEncoding fromConfigurations(
+      llvm::ArrayRef<std::unique_ptr<feature::Configuration>> Configs);
+
+  void addBinaryOption(llvm::StringRef Name);
+
+  void addNumericOption(llvm::StringRef Name, int64_t Min, int64_t Max);
+
+  [[nodiscard]] unsigned getNumBinaryOptions() const { return NumBinary; }
+
+  [[nodiscard]] unsigned getNumNumericOptions() const { return NumNumeric; }
+
+  /// Number of 64 bit words needed to store the binary options.
+  [[nodiscard]] unsigned getNumWords() const { return (NumBinary + 63) / 64; }
+
+  [[nodiscard]] PackedConfiguration
+  pack(const feature::Configuration &Config) const;
+
+  /// Packs the configuration into preallocated storage of getNumWords() words
+  /// and getNumNumericOptions() values.
+  void pack(const feature::Configuration &Config, uint64_t *Bits,
+            double *Numerics) const;
+
+private:
+  struct OptionSlot {
+    bool IsNumeric;
+    unsigned Index;
+    int64_t Min;
+    int64_t Max;
+  };
+
+  llvm::StringMap<OptionSlot> Slots;
+  unsigned NumBinary = 0;
+  unsigned NumNumeric = 0;
+};
+
+//===----------------------------------------------------------------------===//
+//                        NearestNeighbourIndex Class
+//===----------------------------------------------------------------------===//
+
+/// \brief Index over packed configurations answering nearest neighbour and
+/// diversity queries.
+///
+/// All configurations are stored contiguously in their packed representation,
+/// so queries scan flat arrays with word-wise kernels instead of comparing
+/// option maps.
+class NearestNeighbourIndex {
+public:
+  struct Neighbour {
+    size_t Index;
+    double Distance;
+  };
+
+  explicit NearestNeighbourIndex(ConfigurationEncoding Encoding)
+      : Encoding(std::move(Encoding)) {}
+
+  /// Adds a configuration to the index.
+  ///
+  /// \returns the index of the configuration
+  size_t insert(const feature::Configuration &Config);
+
+  [[nodiscard]] size_t size() const { return Size; }
+
+  [[nodiscard]] bool empty() const { return Size == 0; }
+
+  [[nodiscard]] const ConfigurationEncoding &getEncoding() const {
+    return Encoding;
+  }
+
+  /// Distance between the configurations with the given indices.
+  [[nodiscard]] double distance(size_t LHS, size_t RHS) const;
+
+  /// Searches the \p K stored configurations closest to \p Config.
+  ///
+  /// \returns the neighbours ordered by ascending distance
+  [[nodiscard]] std::vector<Neighbour>
+  nearest(const feature::Configuration &Config, size_t K) const;
+
+  /// Selects up to \p N stored configurations that are maximally spread, by
+  /// greedily picking the configuration farthest from all previously picked
+  /// ones. Selection starts with the first stored configuration.
+  ///
+  /// \returns the indices of the selected configurations
+  [[nodiscard]] std::vector<size_t> selectDiverse(size_t N) const;
+
+private:
+  [[nodiscard]] llvm::ArrayRef<uint64_t> bits(size_t I) const {
+    return llvm::makeArrayRef(Bits).slice(I * Encoding.getNumWords(),
+                                          Encoding.getNumWords());
+  }
+
+  [[nodiscard]] llvm::ArrayRef<double> numerics(size_t I) const {
+    return llvm::makeArrayRef(Numerics).slice(
+        I * Encoding.getNumNumericOptions(), Encoding.getNumNumericOptions());
+  }
+
+  ConfigurationEncoding Encoding;
+  std::vector<uint64_t> Bits;
+  std::vector<double> Numerics;
+  size_t Size = 0;
+};
+
+} // namespace vara::sampling
+
+#endif // VARA_SAMPLING_CONFIGURATIONDISTANCE_H
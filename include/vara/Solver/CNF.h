@@ -0,0 +1,90 @@
+#ifndef VARA_SOLVER_CNF_H_
+#define VARA_SOLVER_CNF_H_
+
+#include "vara/Feature/FeatureModel.h"
+#include "vara/Solver/Error.h"
+#include "vara/Utils/Result.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vara::solver {
+
+//===----------------------------------------------------------------------===//
+//                                 CNF Class
+//===----------------------------------------------------------------------===//
+
+/// \brief A propositional formula in conjunctive normal form.
+///
+/// Variables are numbered from one and literals are variables or their
+/// negation, as in DIMACS. Variables that stand for features carry the name of
+/// the feature. All other variables are introduced by the encoding and are
+/// defined by equivalences over the named ones, so the formula has exactly as
+/// many models as the boolean part of the feature model it was compiled from.
+class CNF {
+public:
+  using Literal = int;
+
+  /// Compiles the boolean part of \p FM, i.e., the tree of binary features,
+  /// its relationships, and the boolean constraints. Numeric features as well
+  /// as non-boolean and mixed constraints are not part of the formula.
+  /// Nested constraints are encoded with Tseitin variables.
+  ///
+  /// \returns the formula or an error if a boolean constraint refers to a
+  /// numeric feature or contains arithmetic
+  [[nodiscard]] static Result<SolverErrorCode, std::unique_ptr<CNF>>
+  compile(const feature::FeatureModel &FM);
+
+  /// Parses a formula in DIMACS format. Names of variables are taken from
+  /// comment lines of the form `c <variable> <name>`.
+  [[nodiscard]] static Result<SolverErrorCode, std::unique_ptr<CNF>>
+  parseDimacs(llvm::StringRef Dimacs);
+
+  /// Writes the formula in DIMACS format, preceded by one comment line per
+  /// named variable that can be read back by \a parseDimacs.
+  void writeDimacs(llvm::raw_ostream &OS) const;
+
+  /// Adds a new variable, which is auxiliary if \p Name is empty.
+  ///
+  /// \returns the new variable or zero if \p Name is already taken
+  unsigned addVariable(llvm::StringRef Name = "");
+
+  /// \returns the variable named \p Name or zero if there is none
+  [[nodiscard]] unsigned getVariable(llvm::StringRef Name) const {
+    return Variables.lookup(Name);
+  }
+
+  /// \returns the name of \p Variable, empty for auxiliary variables
+  [[nodiscard]] llvm::StringRef getName(unsigned Variable) const {
+    assert(Variable > 0 && Variable <= Names.size());
+    return Names[Variable - 1];
+  }
+
+  [[nodiscard]] unsigned getNumVariables() const { return Names.size(); }
+
+  void addClause(llvm::ArrayRef<Literal> Clause);
+
+  [[nodiscard]] llvm::ArrayRef<Literal> getClause(size_t I) const {
+    size_t Begin = I == 0 ? 0 : ClauseEnds[I - 1];
+    return llvm::ArrayRef<Literal>(Literals).slice(Begin,
+                                                   ClauseEnds[I] - Begin);
+  }
+
+  [[nodiscard]] size_t getNumClauses() const { return ClauseEnds.size(); }
+
+private:
+  std::vector<std::string> Names;
+  llvm::StringMap<unsigned> Variables;
+  /// Literals of all clauses, which end at the offsets in \a ClauseEnds.
+  std::vector<Literal> Literals;
+  std::vector<size_t> ClauseEnds;
+};
+
+} // namespace vara::solver
+
+#endif // VARA_SOLVER_CNF_H_
@@ -15,6 +15,7 @@ enum SolverErrorCode {
   NOT_ALL_CONSTRAINTS_PROCESSED,
   PARENT_NOT_PRESENT,
   ILLEGAL_STATE,
+  MALFORMED_INPUT,
 };
 
 } // namespace solver
@@ -56,6 +57,9 @@ public:
     case vara::solver::ILLEGAL_STATE:
       OS << "The solver is in an illegal state for this operation.";
       break;
+    case vara::solver::MALFORMED_INPUT:
+      OS << "The input could not be parsed.";
+      break;
     }
     return OS;
   }
@@ -5,6 +5,7 @@
 #include "vara/Feature/Constraint.h"
 #include "vara/Feature/Feature.h"
 #include "vara/Feature/FeatureModel.h"
+#include "vara/Solver/CNF.h"
 #include "vara/Solver/Error.h"
 #include "vara/Utils/Result.h"
 
@@ -109,6 +110,15 @@ public:
                      feature::FeatureModel::MixedConstraint::ExprKind ExprKind,
                      feature::FeatureModel::MixedConstraint::Req Req) = 0;
 
+  /// Adds all variables and clauses of the given formula, e.g., a compiled
+  /// feature model that was loaded from a DIMACS file. Named variables become
+  /// boolean features, auxiliary variables are not part of configurations.
+  ///
+  /// \param Formula the formula to add.
+  ///
+  /// \returns a possible error if a named variable is already present.
+  virtual Result<SolverErrorCode> addCNF(const CNF &Formula) = 0;
+
   /// Returns \c true if the current constraint system (i.e., its features and
   /// its constraints) has valid configurations.
   ///
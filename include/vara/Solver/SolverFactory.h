@@ -31,6 +31,28 @@ public:
     return applyModelOnSolver(Model, std::move(S));
   }
 
+  /// This method returns a pointer to a solver that has processed the given
+  /// formula, which skips building the solver from a feature model, e.g., for
+  /// cached compilations of its boolean part.
+  ///
+  /// \param Formula the formula to use for the initialization of the solver
+  /// \param Type the type of solver to use
+  ///
+  /// \returns a unique pointer containing the initialized solver or the error
+  /// of adding the formula
+  [[nodiscard]] static Result<SolverErrorCode, std::unique_ptr<Solver>>
+  initializeSolver(const CNF &Formula, const SolverType Type) {
+    std::unique_ptr<Solver> S;
+    switch (Type) {
+    case Z3:
+      S = initializeZ3Solver();
+    }
+    if (auto R = S->addCNF(Formula); !R) {
+      return Error(R.extractError());
+    }
+    return S;
+  }
+
   /// This method returns a pointer to an initialized solver.
   ///
   /// \param Type the type of solver to use
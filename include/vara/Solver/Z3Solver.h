@@ -3,15 +3,22 @@
 
 #include "vara/Configuration/Configuration.h"
 #include "vara/Feature/Constraint.h"
+#include "vara/Feature/ConstraintFactory.h"
 #include "vara/Feature/Feature.h"
+#include "vara/Feature/FlatConstraint.h"
 #include "vara/Feature/Relationship.h"
 #include "vara/Solver/Error.h"
 #include "vara/Solver/Solver.h"
 #include "vara/Utils/Result.h"
 
+#include "llvm/ADT/DenseSet.h"
+
 #include "z3++.h"
 
 namespace vara::solver {
+
+class Z3SolverConstraintVisitor;
+
 //===----------------------------------------------------------------------===//
 //                               Z3Solver Class
 //===----------------------------------------------------------------------===//
@@ -55,6 +62,8 @@ public:
                      feature::FeatureModel::MixedConstraint::ExprKind ExprKind,
                      feature::FeatureModel::MixedConstraint::Req Req) override;
 
+  Result<SolverErrorCode> addCNF(const CNF &Formula) override;
+
   Result<SolverErrorCode, bool> hasValidConfigurations() override;
 
   Result<SolverErrorCode, std::unique_ptr<vara::feature::Configuration>>
@@ -63,6 +72,12 @@ public:
   Result<SolverErrorCode, std::unique_ptr<vara::feature::Configuration>>
   getNextConfiguration() override;
 
+  /// Statistics about the sharing of the constraints added to this solver.
+  [[nodiscard]] const feature::ConstraintFactory::Statistics &
+  getConstraintStatistics() const {
+    return Constraints.getStatistics();
+  }
+
 private:
   // The Z3SolverConstraintVisitor is a friend class to access the solver and
   // the context.
@@ -78,6 +93,13 @@ private:
   setBinaryFeatureConstraints(const feature::BinaryFeature &Feature,
                               bool IsInAlternativeGroup);
 
+  /// Adds \p C with the visitor \p SCV unless an equal constraint was
+  /// already added in the same way, which is identified by \p Variant.
+  Result<SolverErrorCode> addUniqueConstraint(feature::Constraint &C,
+                                              unsigned Variant,
+                                              Z3SolverConstraintVisitor &SCV,
+                                              bool NegateExpr, bool RequireAll);
+
   /// The context of Z3 needed to initialize variables.
   z3::context Context;
 
@@ -91,6 +113,14 @@ private:
 
   /// The current model of the SAT solver.
   std::optional<z3::model> CurrentModel;
+
+  /// Interns the added constraints, so equal ones are only encoded once.
+  feature::ConstraintFactory Constraints;
+
+  /// Interned constraints that are part of the solver, paired with the way
+  /// they were added.
+  llvm::DenseSet<std::pair<feature::ConstraintFactory::NodeId, unsigned>>
+      AddedConstraints;
 };
 
 /// \brief This class is a visitor to convert the constraints from the
@@ -123,9 +153,12 @@ public:
   bool addConstraint(vara::feature::Constraint *C, bool NegateExpr = false,
                      bool RequireAll = true);
 
-  /// Visits the binary constraint. Thereby, it constructs the z3 constraint
-  /// by first executing the first part of the binary operator and afterwards
-  /// the second (right) part.
+  /// Adds the flattened constraint \p C, see above.
+  bool addConstraint(const vara::feature::FlatConstraint &C,
+                     bool NegateExpr = false, bool RequireAll = true);
+
+  /// Visits the binary constraint. Thereby, it flattens the constraint and
+  /// constructs the z3 constraint from its nodes, operands first.
   ///
   /// \param C the binary constraint to be converted
   ///
@@ -133,8 +166,8 @@ public:
   /// otherwise.
   bool visit(vara::feature::BinaryConstraint *C) override;
 
-  /// Visits the unary constraints. Thereby, it visits the operand and creates
-  /// a new z3 constraint by preceeding it with the according expression.
+  /// Visits the unary constraints. Thereby, it flattens the constraint and
+  /// constructs the z3 constraint from its nodes, operand first.
   ///
   /// \param C the unary constraint to visit
   ///
@@ -161,6 +194,16 @@ public:
   bool visit(feature::PrimaryIntegerConstraint *C) override;
 
 private:
+  /// Encodes \p C into the z3 constraint with one loop over its nodes instead
+  /// of visiting the constraint tree.
+  ///
+  /// \returns \c true if encoding the constraint was successfull; \c false
+  /// otherwise.
+  bool encode(const vara::feature::FlatConstraint &C);
+
+  /// Creates the z3 constant of \p F, which mixed constraints use as integer.
+  z3::expr encodeFeature(const vara::feature::Feature &F);
+
   /// The z3 constraint will be adjusted while visiting the given constraint
   z3::expr Z3ConstraintExpression;
 
@@ -1,11 +1,194 @@
 #include "vara/Configuration/Configuration.h"
+#include "vara/Feature/FeatureModel.h"
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ConvertUTF.h"
 #include "llvm/Support/JSON.h"
+#include "llvm/Support/NativeFormatting.h"
 
+#include <algorithm>
 #include <sstream>
 
 namespace vara::feature {
 
+namespace {
+
+/// Writes a quoted json string, escaping like the llvm json printer.
+void writeJsonString(llvm::raw_ostream &OS, llvm::StringRef Str) {
+  OS << '"';
+  for (unsigned char C : Str) {
+    if (C >= 0x20 && C != '\\' && C != '"') {
+      OS << C;
+      continue;
+    }
+    OS << '\\';
+    switch (C) {
+    case '"':
+    case '\\':
+      OS << C;
+      break;
+    case '\t':
+      OS << 't';
+      break;
+    case '\n':
+      OS << 'n';
+      break;
+    case '\r':
+      OS << 'r';
+      break;
+    default:
+      OS << 'u';
+      llvm::write_hex(OS, C, llvm::HexPrintStyle::Lower, 4);
+      break;
+    }
+  }
+  OS << '"';
+}
+
+/// \brief Single-pass scanner for flat json objects with string values.
+///
+/// Strings without escape sequences are returned as references into the
+/// input, escaped strings are decoded into a caller provided buffer.
+class JsonObjectScanner {
+public:
+  explicit JsonObjectScanner(llvm::StringRef Input) : Input(Input) {}
+
+  void skipWhitespace() {
+    while (Pos < Input.size() && (Input[Pos] == ' ' || Input[Pos] == '\t' ||
+                                  Input[Pos] == '\n' || Input[Pos] == '\r')) {
+      ++Pos;
+    }
+  }
+
+  bool consume(char C) {
+    skipWhitespace();
+    if (Pos < Input.size() && Input[Pos] == C) {
+      ++Pos;
+      return true;
+    }
+    return false;
+  }
+
+  [[nodiscard]] bool atEnd() {
+    skipWhitespace();
+    return Pos == Input.size();
+  }
+
+  [[nodiscard]] size_t position() const { return Pos; }
+
+  std::optional<llvm::StringRef> parseString(llvm::SmallVectorImpl<char> &Buf) {
+    if (!consume('"')) {
+      return std::nullopt;
+    }
+    size_t Start = Pos;
+    while (Pos < Input.size() && Input[Pos] != '"' && Input[Pos] != '\\') {
+      ++Pos;
+    }
+    if (Pos == Input.size()) {
+      return std::nullopt;
+    }
+    if (Input[Pos] == '"') {
+      return Input.slice(Start, Pos++);
+    }
+
+    Buf.assign(Input.begin() + Start, Input.begin() + Pos);
+    while (Pos < Input.size() && Input[Pos] != '"') {
+      char C = Input[Pos++];
+      if (C != '\\') {
+        Buf.push_back(C);
+        continue;
+      }
+      if (Pos == Input.size()) {
+        return std::nullopt;
+      }
+      switch (char E = Input[Pos++]) {
+      case '"':
+      case '\\':
+      case '/':
+        Buf.push_back(E);
+        break;
+      case 'b':
+        Buf.push_back('\b');
+        break;
+      case 'f':
+        Buf.push_back('\f');
+        break;
+      case 'n':
+        Buf.push_back('\n');
+        break;
+      case 'r':
+        Buf.push_back('\r');
+        break;
+      case 't':
+        Buf.push_back('\t');
+        break;
+      case 'u':
+        if (!parseCodePoint(Buf)) {
+          return std::nullopt;
+        }
+        break;
+      default:
+        return std::nullopt;
+      }
+    }
+    if (Pos == Input.size()) {
+      return std::nullopt;
+    }
+    ++Pos;
+    return llvm::StringRef(Buf.data(), Buf.size());
+  }
+
+private:
+  bool parseHex4(unsigned &CodePoint) {
+    if (Pos + 4 > Input.size() ||
+        Input.substr(Pos, 4).getAsInteger(16, CodePoint)) {
+      return false;
+    }
+    Pos += 4;
+    return true;
+  }
+
+  bool parseCodePoint(llvm::SmallVectorImpl<char> &Buf) {
+    unsigned CodePoint;
+    if (!parseHex4(CodePoint)) {
+      return false;
+    }
+    // Combine UTF-16 surrogate pairs.
+    if (CodePoint >= 0xD800 && CodePoint < 0xDC00 &&
+        Input.substr(Pos).startswith("\\u")) {
+      Pos += 2;
+      unsigned Low;
+      if (!parseHex4(Low) || Low < 0xDC00 || Low >= 0xE000) {
+        return false;
+      }
+      CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (Low - 0xDC00);
+    }
+    char UTF8[UNI_MAX_UTF8_BYTES_PER_CODE_POINT];
+    char *End = UTF8;
+    if (!llvm::ConvertCodePointToUTF8(CodePoint, End)) {
+      return false;
+    }
+    Buf.append(UTF8, End);
+    return true;
+  }
+
+  llvm::StringRef Input;
+  size_t Pos = 0;
+};
+
+/// Checks whether the given value can be assigned to the feature.
+bool isValidValue(const Feature &F, llvm::StringRef Value) {
+  if (llvm::isa<NumericFeature>(F)) {
+    int64_t IntegerValue;
+    return !Value.getAsInteger(10, IntegerValue);
+  }
+  return Value == "true" || Value == "false";
+}
+
+} // namespace
+
 std::unique_ptr<Configuration> Configuration::createConfigurationFromString(
     llvm::StringRef ConfigurationString) {
   std::unique_ptr<Configuration> Conf = std::make_unique<Configuration>();
@@ -42,6 +225,57 @@ std::unique_ptr<Configuration> Configuration::createConfigurationFromString(
   return Conf;
 }
 
+std::unique_ptr<Configuration> Configuration::createConfigurationFromString(
+    llvm::StringRef ConfigurationString, const FeatureModel &FM) {
+  auto Conf = std::make_unique<Configuration>();
+  JsonObjectScanner Scanner(ConfigurationString);
+  llvm::SmallString<64> NameBuffer;
+  llvm::SmallString<64> ValueBuffer;
+
+  auto Fail = [&Scanner](llvm::StringRef Message) {
+    llvm::errs() << "Invalid configuration at offset " << Scanner.position()
+                 << ": " << Message << "\n";
+    return nullptr;
+  };
+
+  if (!Scanner.consume('{')) {
+    return Fail("The provided json has to be a map from the name to the value "
+                "(as string).");
+  }
+  if (!Scanner.consume('}')) {
+    do {
+      auto Name = Scanner.parseString(NameBuffer);
+      if (!Name) {
+        return Fail("Expected option name.");
+      }
+      if (!Scanner.consume(':')) {
+        return Fail("Expected ':' after option name.");
+      }
+      auto Value = Scanner.parseString(ValueBuffer);
+      if (!Value) {
+        return Fail("The values of the provided json string have to be simple "
+                    "strings.");
+      }
+      const Feature *F = FM.getFeature(*Name);
+      if (!F) {
+        return Fail("Unknown option '" + Name->str() + "'.");
+      }
+      if (!isValidValue(*F, *Value)) {
+        return Fail("Invalid value '" + Value->str() + "' for option '" +
+                    Name->str() + "'.");
+      }
+      Conf->setConfigurationOption(*Name, *Value);
+    } while (Scanner.consume(','));
+    if (!Scanner.consume('}')) {
+      return Fail("Expected ',' or '}'.");
+    }
+  }
+  if (!Scanner.atEnd()) {
+    return Fail("Unexpected trailing characters.");
+  }
+  return Conf;
+}
+
 void Configuration::addConfigurationOption(
     std::unique_ptr<ConfigurationOption> Option) {
   this->OptionMappings[Option->name()] = std::move(Option);
@@ -55,7 +289,7 @@ void Configuration::setConfigurationOption(llvm::StringRef Name,
 }
 
 std::optional<std::string>
-Configuration::configurationOptionValue(llvm::StringRef Name) {
+Configuration::configurationOptionValue(llvm::StringRef Name) const {
   auto Search = this->OptionMappings.find(Name);
   if (Search == this->OptionMappings.end()) {
     return std::optional<std::string>{};
@@ -63,18 +297,68 @@ Configuration::configurationOptionValue(llvm::StringRef Name) {
   return std::optional<std::string>{Search->second->asString()};
 }
 
-std::string Configuration::dumpToString() {
-  llvm::json::Object Obj{};
-  for (auto &Iterator : this->OptionMappings) {
-    Obj[std::string(Iterator.first())] =
-        std::string(Iterator.second->asString());
+bool Configuration::operator==(const Configuration &Other) const {
+  if (OptionMappings.size() != Other.OptionMappings.size()) {
+    return false;
+  }
+  return std::all_of(OptionMappings.begin(), OptionMappings.end(),
+                     [&Other](const auto &Entry) {
+                       auto Search = Other.OptionMappings.find(Entry.first());
+                       return Search != Other.OptionMappings.end() &&
+                              *Search->second == *Entry.second;
+                     });
+}
+
+llvm::hash_code Configuration::hash() const {
+  // StringMap does not guarantee an iteration order, so per-option hashes are
+  // combined with a commutative operation.
+  size_t Sum = 0;
+  for (const auto &Entry : OptionMappings) {
+    Sum += Entry.second->hash();
   }
-  llvm::json::Value Value(std::move(Obj));
+  return llvm::hash_combine(OptionMappings.size(), Sum);
+}
+
+std::string Configuration::dumpToString() const {
   std::string DumpedString;
   llvm::raw_string_ostream Rs(DumpedString);
-  Rs << Value;
+  writeJson(Rs);
   Rs.flush();
   return DumpedString;
 }
 
+void Configuration::writeJson(llvm::raw_ostream &OS) const {
+  llvm::SmallVector<const llvm::StringMapEntry<
+                        std::unique_ptr<ConfigurationOption>> *,
+                    32>
+      Entries;
+  Entries.reserve(OptionMappings.size());
+  for (const auto &Entry : OptionMappings) {
+    Entries.push_back(&Entry);
+  }
+  llvm::sort(Entries, [](const auto *LHS, const auto *RHS) {
+    return LHS->first() < RHS->first();
+  });
+
+  OS << '{';
+  bool First = true;
+  for (const auto *Entry : Entries) {
+    if (!First) {
+      OS << ',';
+    }
+    First = false;
+    writeJsonString(OS, Entry->first());
+    OS << ':';
+    const ConfigurationOption &Option = *Entry->second;
+    if (auto BoolValue = Option.boolValue()) {
+      OS << (*BoolValue ? "\"true\"" : "\"false\"");
+    } else if (auto IntValue = Option.intValue()) {
+      OS << '"' << *IntValue << '"';
+    } else {
+      writeJsonString(OS, *Option.stringValue());
+    }
+  }
+  OS << '}';
+}
+
 } // namespace vara::feature
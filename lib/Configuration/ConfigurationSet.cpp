@@ -0,0 +1,135 @@
+#include "vara/Configuration/ConfigurationSet.h"
+
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace vara::feature {
+
+ConfigurationSet::ConfigurationSet(
+    std::vector<std::unique_ptr<Configuration>> Configurations) {
+  reserve(Configurations.size());
+  for (auto &Config : Configurations) {
+    insert(std::move(Config));
+  }
+}
+
+bool ConfigurationSet::insert(std::unique_ptr<Configuration> Config) {
+  assert(Config && "Cannot insert a null configuration.");
+  assert(Configurations.size() < EmptySlot && "Configuration set is full.");
+
+  // Keep the load factor of the index below 3/4.
+  if ((Configurations.size() + 1) * 4 > Index.size() * 3) {
+    rehash(Configurations.size() + 1);
+  }
+
+  size_t Hash = Config->hash();
+  size_t Slot = lookupSlot(*Config, Hash);
+  if (Index[Slot] != EmptySlot) {
+    return false;
+  }
+
+  Index[Slot] = Configurations.size();
+  Configurations.push_back(std::move(Config));
+  Hashes.push_back(Hash);
+  return true;
+}
+
+Configuration *ConfigurationSet::find(const Configuration &Config) const {
+  if (Index.empty()) {
+    return nullptr;
+  }
+  uint32_t Entry = Index[lookupSlot(Config, Config.hash())];
+  return Entry == EmptySlot ? nullptr : Configurations[Entry].get();
+}
+
+void ConfigurationSet::merge(ConfigurationSet &&Other) {
+  reserve(size() + Other.size());
+  for (size_t I = 0; I < Other.Configurations.size(); ++I) {
+    size_t Slot = lookupSlot(*Other.Configurations[I], Other.Hashes[I]);
+    if (Index[Slot] == EmptySlot) {
+      Index[Slot] = Configurations.size();
+      Configurations.push_back(std::move(Other.Configurations[I]));
+      Hashes.push_back(Other.Hashes[I]);
+    }
+  }
+  Other.clear();
+}
+
+void ConfigurationSet::intersect(const ConfigurationSet &Other) {
+  retain([&Other](const Configuration &Config, size_t Hash) {
+    return !Other.Index.empty() &&
+           Other.Index[Other.lookupSlot(Config, Hash)] != EmptySlot;
+  });
+}
+
+void ConfigurationSet::subtract(const ConfigurationSet &Other) {
+  retain([&Other](const Configuration &Config, size_t Hash) {
+    return Other.Index.empty() ||
+           Other.Index[Other.lookupSlot(Config, Hash)] == EmptySlot;
+  });
+}
+
+void ConfigurationSet::reserve(size_t N) {
+  Configurations.reserve(N);
+  Hashes.reserve(N);
+  if (N * 4 > Index.size() * 3) {
+    rehash(N);
+  }
+}
+
+std::vector<std::unique_ptr<Configuration>> ConfigurationSet::release() {
+  auto Released = std::move(Configurations);
+  clear();
+  return Released;
+}
+
+size_t ConfigurationSet::lookupSlot(const Configuration &Config,
+                                    size_t Hash) const {
+  assert(!Index.empty() && "Lookup in an empty index.");
+  size_t Mask = Index.size() - 1;
+  for (size_t Slot = Hash & Mask;; Slot = (Slot + 1) & Mask) {
+    uint32_t Entry = Index[Slot];
+    if (Entry == EmptySlot ||
+        (Hashes[Entry] == Hash && *Configurations[Entry] == Config)) {
+      return Slot;
+    }
+  }
+}
+
+void ConfigurationSet::rehash(size_t MinSize) {
+  size_t NewSize =
+      llvm::PowerOf2Ceil(std::max<size_t>(MinSize * 4 / 3 + 1, 8));
+  Index.assign(NewSize, EmptySlot);
+  size_t Mask = NewSize - 1;
+  for (uint32_t Entry = 0; Entry < Configurations.size(); ++Entry) {
+    size_t Slot = Hashes[Entry] & Mask;
+    while (Index[Slot] != EmptySlot) {
+      Slot = (Slot + 1) & Mask;
+    }
+    Index[Slot] = Entry;
+  }
+}
+
+template <typename PredTy>
+void ConfigurationSet::retain(PredTy Keep) {
+  size_t Kept = 0;
+  for (size_t I = 0; I < Configurations.size(); ++I) {
+    if (Keep(*Configurations[I], Hashes[I])) {
+      if (Kept != I) {
+        Configurations[Kept] = std::move(Configurations[I]);
+        Hashes[Kept] = Hashes[I];
+      }
+      ++Kept;
+    }
+  }
+  if (Kept == Configurations.size()) {
+    return;
+  }
+  Configurations.resize(Kept);
+  Hashes.resize(Kept);
+  rehash(Kept);
+}
+
+} // namespace vara::feature
@@ -0,0 +1,146 @@
+#ifndef VARA_FEATURE_BINARYFORMAT_H
+#define VARA_FEATURE_BINARYFORMAT_H
+
+#include "vara/Feature/Constraint.h"
+
+#include "llvm/Support/Endian.h"
+
+#include <cstdint>
+
+namespace vara::feature::binary {
+
+//===----------------------------------------------------------------------===//
+//                          Binary feature model format
+//===----------------------------------------------------------------------===//
+//
+// A binary feature model is a header followed by fixed size records and a
+// string table, all little endian and without padding:
+//
+//   FileHeader
+//   FeatureRecord     [NumFeatures]        depth first pre-order, root first
+//   LocationRecord    [NumLocations]       grouped by feature
+//   little64_t        [NumValues]          numeric values, grouped by feature
+//   ConstraintRecord  [NumConstraints]
+//   ConstraintNode    [NumConstraintNodes] postfix, grouped by constraint
+//   char              [StringTableSize]
+//
+// Records of a section are consumed in order, so features only refer to
+// their counts of locations and values instead of offsets. Parents precede
+// their children, which allows building the model in a single pass.
+// Changing any record layout or encoding requires bumping Version.
+
+using llvm::support::little64_t;
+using llvm::support::ulittle32_t;
+using llvm::support::ulittle64_t;
+
+static constexpr char Magic[4] = {'V', 'F', 'M', 'B'};
+static constexpr uint32_t Version = 1;
+static constexpr uint32_t NoIndex = ~0U;
+
+/// Slice of the string table.
+struct StringRecord {
+  ulittle32_t Offset;
+  ulittle32_t Size;
+};
+
+struct FileHeader {
+  char Magic[4];
+  ulittle32_t Version;
+  StringRecord Name;
+  StringRecord Path;
+  StringRecord Commit;
+  ulittle32_t NumFeatures;
+  ulittle32_t NumLocations;
+  ulittle32_t NumValues;
+  ulittle32_t NumConstraints;
+  ulittle32_t NumConstraintNodes;
+  ulittle32_t StringTableSize;
+};
+
+enum FeatureFlags : uint8_t { FF_OPTIONAL = 1 };
+
+/// Encoding of a relationship grouping all children of a feature.
+enum GroupKind : uint8_t { GK_NONE, GK_ALTERNATIVE, GK_OR };
+
+enum ValueKind : uint8_t { VK_NONE, VK_RANGE, VK_LIST };
+
+/// Encoding of the step function of a numeric feature, shifted by one against
+/// \a StepFunction::StepOperation.
+enum StepKind : uint8_t {
+  SK_NONE,
+  SK_ADDITION,
+  SK_MULTIPLICATION,
+  SK_EXPONENTIATION
+};
+
+struct FeatureRecord {
+  StringRecord Name;
+  StringRecord OutputString;
+  /// Index of the parent feature or \a NoIndex for the root.
+  ulittle32_t Parent;
+  /// Value of \a Feature::FeatureKind.
+  uint8_t Kind;
+  uint8_t Flags;
+  uint8_t Group;
+  uint8_t Values;
+  ulittle32_t NumValues;
+  ulittle32_t NumLocations;
+  uint8_t Step;
+  /// Whether the variable is the left operand of the step function.
+  uint8_t StepVariableFirst;
+  StringRecord StepVariable;
+  /// Bit pattern of the constant operand of the step function.
+  ulittle64_t StepConstant;
+};
+
+enum LocationFlags : uint8_t {
+  LF_START = 1,
+  LF_END = 2,
+  LF_MEMBER_OFFSET = 4,
+  LF_REVISION_RANGE = 8,
+  LF_REMOVING_COMMIT = 16
+};
+
+struct LocationRecord {
+  StringRecord Path;
+  /// Value of \a FeatureSourceRange::Category.
+  uint8_t Category;
+  uint8_t Flags;
+  ulittle32_t StartLine;
+  ulittle32_t StartColumn;
+  ulittle32_t EndLine;
+  ulittle32_t EndColumn;
+  /// Member offset in its textual form, e.g., \c Class::member.
+  StringRecord MemberOffset;
+  StringRecord Introduced;
+  StringRecord Removed;
+};
+
+enum ConstraintKind : uint8_t { CK_BOOLEAN, CK_NON_BOOLEAN, CK_MIXED };
+
+struct ConstraintRecord {
+  uint8_t Kind;
+  /// Values of \a FeatureModel::MixedConstraint::Req and ExprKind.
+  uint8_t Req;
+  uint8_t ExprKind;
+  ulittle32_t NumNodes;
+};
+
+/// Node of a constraint tree in postfix order.
+struct ConstraintNode {
+  /// Value of \a Constraint::ConstraintKind.
+  ulittle32_t Kind;
+  /// Index of the referenced feature or the value of an integer constant.
+  little64_t Operand;
+};
+
+// Kinds are stored by value, reordering the enums breaks existing files.
+static_assert(static_cast<unsigned>(Constraint::ConstraintKind::CK_XOR) == 22,
+              "Constraint kinds changed, bump the binary format version.");
+static_assert(sizeof(FeatureRecord) == 50 && sizeof(LocationRecord) == 50 &&
+                  sizeof(ConstraintNode) == 12,
+              "Records must not contain padding.");
+
+} // namespace vara::feature::binary
+
+#endif // VARA_FEATURE_BINARYFORMAT_H
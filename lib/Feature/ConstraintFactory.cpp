@@ -0,0 +1,136 @@
+#include "vara/Feature/ConstraintFactory.h"
+#include "vara/Feature/Feature.h"
+
+#include "llvm/ADT/SmallVector.h"
+
+namespace vara::feature {
+
+ConstraintFactory::NodeId ConstraintFactory::intern(const FlatConstraint &C) {
+  assert(C.isComplete() && "Cannot intern an incomplete constraint.");
+  llvm::SmallVector<NodeId, 16> Ids;
+  Ids.reserve(C.size());
+  for (const auto &N : C.nodes()) {
+    switch (N.Kind) {
+    case Constraint::ConstraintKind::CK_FEATURE:
+      Ids.push_back(makeFeature(*N.getFeature()));
+      break;
+    case Constraint::ConstraintKind::CK_INTEGER:
+      Ids.push_back(makeInteger(N.getValue()));
+      break;
+    case Constraint::ConstraintKind::CK_NEG:
+    case Constraint::ConstraintKind::CK_NOT:
+      Ids.push_back(makeUnary(N.Kind, Ids.back()));
+      break;
+    default:
+      Ids.push_back(makeBinary(N.Kind, Ids[N.LeftOperand], Ids.back()));
+    }
+  }
+
+  NodeId Root = Ids.back();
+  ++Stats.NumConstraints;
+  if (IsConstraint[Root]) {
+    ++Stats.NumDuplicateConstraints;
+  }
+  IsConstraint[Root] = true;
+  return Root;
+}
+
+ConstraintFactory::NodeId ConstraintFactory::makeFeature(const Feature &F) {
+  return makeFeature(F.getName());
+}
+
+ConstraintFactory::NodeId ConstraintFactory::makeFeature(llvm::StringRef Name) {
+  ++Stats.NumNodes;
+  auto [It, Inserted] = FeatureLeaves.try_emplace(Name, Nodes.size());
+  if (Inserted) {
+    Node N;
+    N.Kind = Constraint::ConstraintKind::CK_FEATURE;
+    N.Leaf = &*It;
+    Nodes.push_back(N);
+    IsConstraint.push_back(false);
+    ++Stats.NumUniqueNodes;
+  }
+  return It->second;
+}
+
+ConstraintFactory::NodeId ConstraintFactory::makeInteger(int64_t Value) {
+  auto Bits = static_cast<uint64_t>(Value);
+  Node N;
+  N.Kind = Constraint::ConstraintKind::CK_INTEGER;
+  N.Value = Value;
+  return lookupOrCreate({static_cast<unsigned>(N.Kind),
+                         {static_cast<uint32_t>(Bits),
+                          static_cast<uint32_t>(Bits >> 32)}},
+                        N);
+}
+
+ConstraintFactory::NodeId
+ConstraintFactory::makeUnary(Constraint::ConstraintKind Kind, NodeId Operand) {
+  assert(FlatConstraint::getArity(Kind) == 1u && "Not a unary operator.");
+  assert(Operand < Nodes.size());
+  Node N;
+  N.Kind = Kind;
+  N.Operand = Operand;
+  N.Value = 0;
+  return lookupOrCreate({static_cast<unsigned>(Kind), {0, Operand}}, N);
+}
+
+ConstraintFactory::NodeId
+ConstraintFactory::makeBinary(Constraint::ConstraintKind Kind,
+                              NodeId LeftOperand, NodeId RightOperand) {
+  assert(FlatConstraint::getArity(Kind) == 2u && "Not a binary operator.");
+  assert(LeftOperand < Nodes.size() && RightOperand < Nodes.size());
+  Node N;
+  N.Kind = Kind;
+  N.LeftOperand = LeftOperand;
+  N.Operand = RightOperand;
+  N.Value = 0;
+  return lookupOrCreate(
+      {static_cast<unsigned>(Kind), {LeftOperand, RightOperand}}, N);
+}
+
+ConstraintFactory::NodeId ConstraintFactory::lookupOrCreate(KeyTy Key,
+                                                            const Node &N) {
+  ++Stats.NumNodes;
+  auto [It, Inserted] = Uniques.try_emplace(Key, Nodes.size());
+  if (Inserted) {
+    Nodes.push_back(N);
+    IsConstraint.push_back(false);
+    ++Stats.NumUniqueNodes;
+  }
+  return It->second;
+}
+
+FlatConstraint ConstraintFactory::toFlatConstraint(
+    NodeId Id, llvm::function_ref<Feature *(llvm::StringRef)> FeatureOf) const {
+  FlatConstraint Flat;
+  // Post-order traversal of the DAG, shared nodes are visited once per use.
+  llvm::SmallVector<std::pair<NodeId, bool>, 16> Worklist{{Id, false}};
+  while (!Worklist.empty()) {
+    auto [Current, Expanded] = Worklist.pop_back_val();
+    const Node &N = (*this)[Current];
+    switch (N.Kind) {
+    case Constraint::ConstraintKind::CK_FEATURE:
+      Flat.pushFeature(FeatureOf(N.getFeatureName()));
+      continue;
+    case Constraint::ConstraintKind::CK_INTEGER:
+      Flat.pushInteger(N.getValue());
+      continue;
+    default:
+      break;
+    }
+    if (Expanded) {
+      [[maybe_unused]] bool Pushed = Flat.pushOperator(N.Kind);
+      assert(Pushed);
+      continue;
+    }
+    Worklist.emplace_back(Current, true);
+    Worklist.emplace_back(N.Operand, false);
+    if (FlatConstraint::getArity(N.Kind) == 2u) {
+      Worklist.emplace_back(N.LeftOperand, false);
+    }
+  }
+  return Flat;
+}
+
+} // namespace vara::feature
@@ -0,0 +1,436 @@
+#include "vara/Feature/ConstraintSimplifier.h"
+#include "vara/Feature/FeatureModel.h"
+#include "vara/Feature/FlatConstraint.h"
+
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+
+namespace vara::feature {
+
+namespace {
+
+bool isComparison(Constraint::ConstraintKind K) {
+  switch (K) {
+  case Constraint::ConstraintKind::CK_EQUAL:
+  case Constraint::ConstraintKind::CK_NOT_EQUAL:
+  case Constraint::ConstraintKind::CK_LESS:
+  case Constraint::ConstraintKind::CK_LESS_EQUAL:
+  case Constraint::ConstraintKind::CK_GREATER:
+  case Constraint::ConstraintKind::CK_GREATER_EQUAL:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// \returns the comparison that holds iff \p K does not
+Constraint::ConstraintKind negateComparison(Constraint::ConstraintKind K) {
+  switch (K) {
+  case Constraint::ConstraintKind::CK_EQUAL:
+    return Constraint::ConstraintKind::CK_NOT_EQUAL;
+  case Constraint::ConstraintKind::CK_NOT_EQUAL:
+    return Constraint::ConstraintKind::CK_EQUAL;
+  case Constraint::ConstraintKind::CK_LESS:
+    return Constraint::ConstraintKind::CK_GREATER_EQUAL;
+  case Constraint::ConstraintKind::CK_LESS_EQUAL:
+    return Constraint::ConstraintKind::CK_GREATER;
+  case Constraint::ConstraintKind::CK_GREATER:
+    return Constraint::ConstraintKind::CK_LESS_EQUAL;
+  case Constraint::ConstraintKind::CK_GREATER_EQUAL:
+    return Constraint::ConstraintKind::CK_LESS;
+  default:
+    llvm_unreachable("Not a comparison.");
+  }
+}
+
+/// Applies \p K to two constants with the semantics of the solvers, which use
+/// unbounded integers and floor divisions by positive divisors.
+///
+/// \returns the value or \c std::nullopt if it cannot be folded into a 64-bit
+/// constant with these semantics
+std::optional<int64_t> fold(Constraint::ConstraintKind K, int64_t LHS,
+                            int64_t RHS) {
+  int64_t Result;
+  switch (K) {
+  case Constraint::ConstraintKind::CK_ADDITION:
+    if (llvm::AddOverflow(LHS, RHS, Result)) {
+      return std::nullopt;
+    }
+    return Result;
+  case Constraint::ConstraintKind::CK_SUBTRACTION:
+    if (llvm::SubOverflow(LHS, RHS, Result)) {
+      return std::nullopt;
+    }
+    return Result;
+  case Constraint::ConstraintKind::CK_MULTIPLICATION:
+    if (llvm::MulOverflow(LHS, RHS, Result)) {
+      return std::nullopt;
+    }
+    return Result;
+  case Constraint::ConstraintKind::CK_DIVISION:
+    // Truncating and flooring division only agree on non-negative operands.
+    if (LHS < 0 || RHS <= 0) {
+      return std::nullopt;
+    }
+    return LHS / RHS;
+  default:
+    break;
+  }
+
+  // Logical operators and comparisons cannot overflow.
+  FlatConstraint Flat;
+  Flat.pushInteger(LHS);
+  Flat.pushInteger(RHS);
+  Flat.pushOperator(K);
+  return Flat.evaluate([](const Feature &) -> int64_t {
+    llvm_unreachable("Constants refer to no feature.");
+  });
+}
+
+} // namespace
+
+ConstraintSimplifier::ConstraintSimplifier(const FeatureModel *FM)
+    : FM(FM), True(Nodes.makeInteger(1)), False(Nodes.makeInteger(0)) {}
+
+std::unique_ptr<Constraint> ConstraintSimplifier::simplify(Constraint &C) {
+  auto Flat = FlatConstraint::fromConstraint(C);
+  ++Stats.NumConstraints;
+  Stats.NumNodes += Flat.size();
+
+  NodeId Result = simplify(Nodes.intern(Flat));
+  if (auto Truth = getTruth(Result)) {
+    if (*Truth) {
+      ++Stats.NumRemovedConstraints;
+      return nullptr;
+    }
+    // Unsatisfiable constraints are kept as they are, as there is no constant
+    // false constraint.
+    Stats.NumSimplifiedNodes += Flat.size();
+    return Flat.toConstraint();
+  }
+  // The simplified constraint only contains feature leaves of the original.
+  llvm::StringMap<Feature *> Leaves;
+  for (const auto &N : Flat.nodes()) {
+    if (N.Kind == Kind::CK_FEATURE) {
+      Leaves.try_emplace(N.getFeature()->getName(), N.getFeature());
+    }
+  }
+  auto Simplified =
+      Nodes.toFlatConstraint(Result, [&Leaves](llvm::StringRef Name) {
+        assert(Leaves.count(Name) && "Simplification introduced a feature.");
+        return Leaves.lookup(Name);
+      });
+  Stats.NumSimplifiedNodes += Simplified.size();
+  return Simplified.toConstraint();
+}
+
+ConstraintFactory::NodeId ConstraintSimplifier::simplify(NodeId Id) {
+  if (auto It = Simplified.find(Id); It != Simplified.end()) {
+    return It->second;
+  }
+
+  const auto &N = Nodes[Id];
+  NodeId Result = Id;
+  switch (N.Kind) {
+  case Kind::CK_FEATURE:
+    if (FM && getModelFeature(Id) == FM->getRoot()) {
+      Result = True;
+    }
+    break;
+  case Kind::CK_INTEGER:
+    break;
+  case Kind::CK_NOT:
+    Result = negate(simplify(N.Operand));
+    break;
+  case Kind::CK_NEG: {
+    NodeId Operand = simplify(N.Operand);
+    const auto &Op = Nodes[Operand];
+    std::optional<int64_t> Value;
+    if (Op.Kind == Kind::CK_INTEGER &&
+        (Value = fold(Kind::CK_SUBTRACTION, 0, Op.Value))) {
+      Result = Nodes.makeInteger(*Value);
+    } else if (Op.Kind == Kind::CK_NEG) {
+      Result = Op.Operand;
+    } else {
+      Result = Nodes.makeUnary(Kind::CK_NEG, Operand);
+    }
+    break;
+  }
+  default: {
+    // Operands are simplified first, the node may be invalidated meanwhile.
+    Kind K = N.Kind;
+    NodeId RHS = N.Operand;
+    NodeId LHS = simplify(N.LeftOperand);
+    Result = build(K, LHS, simplify(RHS));
+  }
+  }
+  Simplified[Id] = Result;
+  Simplified[Result] = Result;
+  return Result;
+}
+
+ConstraintFactory::NodeId ConstraintSimplifier::negate(NodeId Id) {
+  if (auto Truth = getTruth(Id)) {
+    return getTruthNode(!*Truth);
+  }
+  if (auto It = Negated.find(Id); It != Negated.end()) {
+    return It->second;
+  }
+
+  Kind K = Nodes[Id].Kind;
+  NodeId LHS = Nodes[Id].LeftOperand;
+  NodeId RHS = Nodes[Id].Operand;
+  NodeId Result;
+  if (K == Kind::CK_NOT) {
+    Result = RHS;
+  } else if (K == Kind::CK_AND || K == Kind::CK_OR) {
+    llvm::SmallVector<NodeId, 8> Operands;
+    collectOperands(K, Id, Operands);
+    for (auto &Operand : Operands) {
+      Operand = negate(Operand);
+    }
+    Result = buildJunction(K == Kind::CK_AND ? Kind::CK_OR : Kind::CK_AND,
+                           Operands);
+  } else if (K == Kind::CK_IMPLIES) {
+    Result = build(Kind::CK_AND, LHS, negate(RHS));
+  } else if (K == Kind::CK_EXCLUDES) {
+    Result = build(Kind::CK_AND, LHS, RHS);
+  } else if (K == Kind::CK_EQUIVALENCE) {
+    Result = build(Kind::CK_XOR, LHS, RHS);
+  } else if (K == Kind::CK_XOR) {
+    Result = build(Kind::CK_EQUIVALENCE, LHS, RHS);
+  } else if (isComparison(K)) {
+    Result = build(negateComparison(K), LHS, RHS);
+  } else {
+    Result = Nodes.makeUnary(Kind::CK_NOT, Id);
+  }
+  Negated[Id] = Result;
+  Negated[Result] = Id;
+  return Result;
+}
+
+ConstraintFactory::NodeId ConstraintSimplifier::build(Kind K, NodeId LHS,
+                                                      NodeId RHS) {
+  // Copies, as nodes may be added while building.
+  const auto L = Nodes[LHS];
+  const auto R = Nodes[RHS];
+  auto LTruth = getTruth(LHS);
+  auto RTruth = getTruth(RHS);
+
+  switch (K) {
+  case Kind::CK_AND:
+  case Kind::CK_OR: {
+    llvm::SmallVector<NodeId, 8> Operands;
+    collectOperands(K, LHS, Operands);
+    collectOperands(K, RHS, Operands);
+    return buildJunction(K, Operands);
+  }
+  case Kind::CK_IMPLIES: {
+    if (LTruth) {
+      return *LTruth ? RHS : True;
+    }
+    if (RTruth) {
+      return *RTruth ? True : negate(LHS);
+    }
+    if (LHS == RHS || treeImplies(LHS, RHS)) {
+      return True;
+    }
+    // A & B => A and A => A | B always hold.
+    llvm::SmallVector<NodeId, 8> Conjuncts;
+    llvm::SmallVector<NodeId, 8> Disjuncts;
+    collectOperands(Kind::CK_AND, LHS, Conjuncts);
+    collectOperands(Kind::CK_OR, RHS, Disjuncts);
+    if (llvm::is_contained(Conjuncts, RHS) ||
+        llvm::is_contained(Disjuncts, LHS)) {
+      return True;
+    }
+    break;
+  }
+  case Kind::CK_EXCLUDES:
+    if (LTruth) {
+      return *LTruth ? negate(RHS) : True;
+    }
+    if (RTruth) {
+      return *RTruth ? negate(LHS) : True;
+    }
+    if (LHS == RHS) {
+      return negate(LHS);
+    }
+    if (treeExcludes(LHS, RHS)) {
+      return True;
+    }
+    break;
+  case Kind::CK_EQUIVALENCE:
+  case Kind::CK_XOR: {
+    bool Equivalence = K == Kind::CK_EQUIVALENCE;
+    if (LTruth) {
+      return *LTruth == Equivalence ? RHS : negate(RHS);
+    }
+    if (RTruth) {
+      return *RTruth == Equivalence ? LHS : negate(LHS);
+    }
+    // Negated operands flip the operator, i.e., A ^ !B is A <=> B.
+    Kind Flipped = Equivalence ? Kind::CK_XOR : Kind::CK_EQUIVALENCE;
+    if (L.Kind == Kind::CK_NOT) {
+      return build(Flipped, L.Operand, RHS);
+    }
+    if (R.Kind == Kind::CK_NOT) {
+      return build(Flipped, LHS, R.Operand);
+    }
+    if (LHS == RHS) {
+      return getTruthNode(Equivalence);
+    }
+    if (RHS == negate(LHS)) {
+      return getTruthNode(!Equivalence);
+    }
+    if (Equivalence && treeImplies(LHS, RHS) && treeImplies(RHS, LHS)) {
+      return True;
+    }
+    break;
+  }
+  default:
+    if (L.Kind == Kind::CK_INTEGER && R.Kind == Kind::CK_INTEGER) {
+      if (auto Value = fold(K, L.Value, R.Value)) {
+        return Nodes.makeInteger(*Value);
+      }
+      break;
+    }
+    if (isComparison(K) && LHS == RHS) {
+      return getTruthNode(K == Kind::CK_EQUAL || K == Kind::CK_LESS_EQUAL ||
+                          K == Kind::CK_GREATER_EQUAL);
+    }
+    // Neutral elements of arithmetic.
+    if (R.Kind == Kind::CK_INTEGER &&
+        ((R.Value == 0 &&
+          (K == Kind::CK_ADDITION || K == Kind::CK_SUBTRACTION)) ||
+         (R.Value == 1 &&
+          (K == Kind::CK_MULTIPLICATION || K == Kind::CK_DIVISION)))) {
+      return LHS;
+    }
+    if (L.Kind == Kind::CK_INTEGER &&
+        ((L.Value == 0 && K == Kind::CK_ADDITION) ||
+         (L.Value == 1 && K == Kind::CK_MULTIPLICATION))) {
+      return RHS;
+    }
+  }
+  return Nodes.makeBinary(K, LHS, RHS);
+}
+
+ConstraintFactory::NodeId
+ConstraintSimplifier::buildJunction(Kind K,
+                                    llvm::SmallVectorImpl<NodeId> &Operands) {
+  // The neutral element of the junction and the one that absorbs it.
+  bool Neutral = K == Kind::CK_AND;
+  llvm::SmallSetVector<NodeId, 8> Unique;
+  for (NodeId Operand : Operands) {
+    if (auto Truth = getTruth(Operand)) {
+      if (*Truth != Neutral) {
+        return getTruthNode(!Neutral);
+      }
+      continue;
+    }
+    Unique.insert(Operand);
+  }
+  for (NodeId Operand : Unique) {
+    if (Unique.count(negate(Operand))) {
+      return getTruthNode(!Neutral);
+    }
+  }
+  if (Unique.empty()) {
+    return getTruthNode(Neutral);
+  }
+
+  NodeId Result = Unique[0];
+  for (size_t I = 1; I < Unique.size(); ++I) {
+    Result = Nodes.makeBinary(K, Result, Unique[I]);
+  }
+  return Result;
+}
+
+void ConstraintSimplifier::collectOperands(
+    Kind K, NodeId Id, llvm::SmallVectorImpl<NodeId> &Operands) const {
+  const auto &N = Nodes[Id];
+  if (N.Kind != K) {
+    Operands.push_back(Id);
+    return;
+  }
+  collectOperands(K, N.LeftOperand, Operands);
+  collectOperands(K, N.Operand, Operands);
+}
+
+std::optional<bool> ConstraintSimplifier::getTruth(NodeId Id) const {
+  const auto &N = Nodes[Id];
+  if (N.Kind != Kind::CK_INTEGER) {
+    return std::nullopt;
+  }
+  return N.Value != 0;
+}
+
+const Feature *ConstraintSimplifier::getModelFeature(NodeId Id) const {
+  const auto &N = Nodes[Id];
+  if (!FM || N.Kind != Kind::CK_FEATURE) {
+    return nullptr;
+  }
+  const auto *F = FM->getFeature(N.getFeatureName());
+  if (!F || (F->getKind() != Feature::FeatureKind::FK_BINARY &&
+             F->getKind() != Feature::FeatureKind::FK_ROOT)) {
+    return nullptr;
+  }
+  return F;
+}
+
+bool ConstraintSimplifier::treeImplies(NodeId A, NodeId B) const {
+  const auto *FA = getModelFeature(A);
+  const auto *FB = getModelFeature(B);
+  if (!FA || !FB) {
+    return false;
+  }
+
+  // Selected features require their parents.
+  llvm::SmallPtrSet<const Feature *, 16> Required;
+  for (const auto *F = FA; F; F = F->getParentFeature()) {
+    Required.insert(F);
+  }
+  // Mandatory features outside of groups are required by their parents.
+  for (const auto *F = FB; F; F = F->getParentFeature()) {
+    if (Required.count(F)) {
+      return true;
+    }
+    if (F->isOptional() || !llvm::isa_and_nonnull<Feature>(F->getParent())) {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool ConstraintSimplifier::treeExcludes(NodeId A, NodeId B) const {
+  const auto *FA = getModelFeature(A);
+  const auto *FB = getModelFeature(B);
+  if (!FA || !FB) {
+    return false;
+  }
+
+  // Children of an alternative group exclude each other, and so do the
+  // features below them.
+  llvm::SmallDenseMap<const Relationship *, const Feature *, 8> Alternatives;
+  for (const auto *F = FA; F; F = F->getParentFeature()) {
+    const auto *R = llvm::dyn_cast_or_null<Relationship>(F->getParent());
+    if (R &&
+        R->getKind() == Relationship::RelationshipKind::RK_ALTERNATIVE) {
+      Alternatives[R] = F;
+    }
+  }
+  for (const auto *F = FB; F; F = F->getParentFeature()) {
+    const auto *R = llvm::dyn_cast_or_null<Relationship>(F->getParent());
+    if (auto It = Alternatives.find(R);
+        It != Alternatives.end() && It->second != F) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace vara::feature
@@ -51,6 +51,10 @@ std::string BinaryFeature::toString() const { return Feature::toString(); }
 /// common parent feature and compare them lexicographically. If no such node
 /// can be found compare names directly.
 bool Feature::operator<(const Feature &Other) const {
+  if (hasComparableLabel(Other)) {
+    return Label.PreOrder < Other.Label.PreOrder;
+  }
+
   std::stack<const Feature *> TraceA;
   std::stack<const Feature *> TraceB;
 
@@ -63,7 +67,7 @@ bool Feature::operator<(const Feature &Other) const {
   assert(!TraceA.empty() && !TraceB.empty());
 
   if (TraceA.top() != TraceB.top()) { // different roots
-    return this->getName().lower() < Other.getName().lower();
+    return this->getFoldedName() < Other.getFoldedName();
   }
   while (!TraceA.empty() && !TraceB.empty() &&
          TraceA.top() == TraceB.top()) { // skip common ancestors
@@ -77,6 +81,55 @@ bool Feature::operator<(const Feature &Other) const {
   if (TraceB.empty()) { // A in subtree of B
     return false;
   }
-  return TraceA.top()->getName().lower() < TraceB.top()->getName().lower();
+  return TraceA.top()->getFoldedName() < TraceB.top()->getFoldedName();
+}
+bool Feature::isAncestorOf(const Feature &Other) const {
+  if (hasComparableLabel(Other)) {
+    return Label.PreOrder < Other.Label.PreOrder &&
+           Other.Label.PreOrder < Label.PreOrder + Label.SubtreeSize;
+  }
+  for (const auto *Head = Other.getParentFeature(); Head;
+       Head = Head->getParentFeature()) {
+    if (Head == this) {
+      return true;
+    }
+  }
+  return false;
+}
+
+unsigned Feature::getSubtreeSize() const {
+  if (hasValidLabel()) {
+    return Label.SubtreeSize;
+  }
+  unsigned Size = 1;
+  for (auto *C : const_cast<Feature *>(this)->getChildren<Feature>()) {
+    Size += C->getSubtreeSize();
+  }
+  return Size;
 }
+
+Feature *Feature::getLowestCommonAncestor(const Feature &Other) {
+  if (hasComparableLabel(Other)) {
+    if (labelCovers(Other)) {
+      return this;
+    }
+    // Climb to the highest ancestor that does not cover Other yet, its parent
+    // is the lowest common ancestor.
+    Feature *Head = this;
+    for (auto K = Head->Label.Ancestors.size(); K-- > 0;) {
+      if (K < Head->Label.Ancestors.size() &&
+          !Head->Label.Ancestors[K]->labelCovers(Other)) {
+        Head = Head->Label.Ancestors[K];
+      }
+    }
+    return Head->Label.Ancestors.empty() ? nullptr : Head->Label.Ancestors[0];
+  }
+  for (auto *Head = this; Head; Head = Head->getParentFeature()) {
+    if (Head == &Other || Head->isAncestorOf(Other)) {
+      return Head;
+    }
+  }
+  return nullptr;
+}
+
 } // namespace vara::feature
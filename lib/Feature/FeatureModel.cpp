@@ -2,10 +2,15 @@
 #include "vara/Feature/FeatureModelBuilder.h"
 #include "vara/Feature/FeatureModelParser.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+
+#include "libxml/parser.h"
 
 #include <algorithm>
+#include <optional>
 
 //===----------------------------------------------------------------------===//
 //                          FeatureModel
@@ -21,9 +26,168 @@ void FeatureModel::dump() const {
   llvm::outs() << '\n';
 }
 
+//===--------------------------------------------------------------------===//
+// Memory usage
+
+/// Bytes allocated on the heap for a string of the given length, short
+/// strings are stored inline.
+static size_t heapBytes(llvm::StringRef S) {
+  static const size_t InlineCapacity = std::string().capacity();
+  return S.size() > InlineCapacity ? S.size() + 1 : 0;
+}
+
+template <typename T>
+static size_t heapBytes(const std::vector<T> &V) {
+  return V.capacity() * sizeof(T);
+}
+
+template <typename T, unsigned N>
+static size_t heapBytes(const llvm::SmallVector<T, N> &V) {
+  return V.capacity() > N ? V.capacity() * sizeof(T) : 0;
+}
+
+static size_t heapBytes(FeatureSourceRange &FSR) {
+  size_t Bytes = heapBytes(FSR.getPath().native());
+  if (auto *MO = FSR.getMemberOffset()) {
+    Bytes += heapBytes(MO->memberName());
+    // A single class name is stored inline.
+    if (MO->nestingDepth() > 1) {
+      Bytes += MO->nestingDepth() * sizeof(std::string);
+    }
+    for (size_t I = 0; I < MO->nestingDepth(); ++I) {
+      Bytes += heapBytes(MO->className(I));
+    }
+  }
+  if (auto *RR = FSR.revisionRange()) {
+    Bytes += heapBytes(RR->introducingCommit()) +
+             heapBytes(RR->removingCommit());
+  }
+  return Bytes;
+}
+
+namespace {
+
+/// Sums up the size of all nodes of a constraint tree.
+class ConstraintMemoryVisitor : public ConstraintVisitor {
+public:
+  bool visit(BinaryConstraint *C) override {
+    Bytes += sizeof(*C);
+    return ConstraintVisitor::visit(C);
+  }
+
+  bool visit(UnaryConstraint *C) override {
+    Bytes += sizeof(*C);
+    return ConstraintVisitor::visit(C);
+  }
+
+  bool visit(PrimaryIntegerConstraint *C) override {
+    Bytes += sizeof(*C);
+    return true;
+  }
+
+  bool visit(PrimaryFeatureConstraint *C) override {
+    Bytes += sizeof(*C);
+    return true;
+  }
+
+  size_t Bytes{0};
+};
+
+} // namespace
+
+FeatureModel::MemoryUsage FeatureModel::memoryUsage() const {
+  MemoryUsage Usage;
+
+  for (const auto &KV : Features) {
+    Feature &F = *KV.getValue();
+    size_t Bytes = heapBytes(F.Name) + heapBytes(F.FoldedName) +
+                   heapBytes(F.OutputString) + heapBytes(F.Children) +
+                   heapBytes(F.Constraints) + heapBytes(F.Excludes) +
+                   heapBytes(F.Implications);
+    MemoryUsage::FeatureKindUsage *KindUsage = nullptr;
+    switch (F.getKind()) {
+    case Feature::FeatureKind::FK_BINARY:
+      Bytes += sizeof(BinaryFeature);
+      KindUsage = &Usage.BinaryFeatures;
+      break;
+    case Feature::FeatureKind::FK_NUMERIC: {
+      auto &N = llvm::cast<NumericFeature>(F);
+      Bytes += sizeof(NumericFeature);
+      if (auto Values = N.getValues();
+          std::holds_alternative<NumericFeature::ValueListType>(Values)) {
+        Bytes += std::get<NumericFeature::ValueListType>(Values).size() *
+                 sizeof(int64_t);
+      }
+      if (N.getStepFunction()) {
+        Bytes += sizeof(StepFunction);
+      }
+      KindUsage = &Usage.NumericFeatures;
+      break;
+    }
+    case Feature::FeatureKind::FK_ROOT:
+      Bytes += sizeof(RootFeature);
+      KindUsage = &Usage.RootFeatures;
+      break;
+    case Feature::FeatureKind::FK_UNKNOWN:
+      Bytes += sizeof(Feature);
+      KindUsage = &Usage.UnknownFeatures;
+      break;
+    }
+    ++KindUsage->Count;
+    KindUsage->Bytes += Bytes;
+
+    Usage.SourceRanges += heapBytes(F.Locations);
+    for (auto &FSR : F.Locations) {
+      Usage.SourceRanges += heapBytes(FSR);
+    }
+  }
+
+  ConstraintMemoryVisitor V;
+  for (const auto &C : BooleanConstraints) {
+    C->constraint()->accept(V);
+  }
+  for (const auto &C : NonBooleanConstraints) {
+    C->constraint()->accept(V);
+  }
+  for (const auto &C : MixedConstraints) {
+    C->constraint()->accept(V);
+  }
+  Usage.Constraints = V.Bytes +
+                      BooleanConstraints.size() * sizeof(BooleanConstraint) +
+                      NonBooleanConstraints.size() *
+                          sizeof(NonBooleanConstraint) +
+                      MixedConstraints.size() * sizeof(MixedConstraint) +
+                      heapBytes(BooleanConstraints) +
+                      heapBytes(NonBooleanConstraints) +
+                      heapBytes(MixedConstraints);
+
+  Usage.Relationships = heapBytes(Relationships);
+  for (const auto &R : Relationships) {
+    Usage.Relationships += sizeof(Relationship) + heapBytes(R->Children);
+  }
+
+  // Buckets hold a pointer to the entry and its full hash value, entries are
+  // allocated together with their null terminated key.
+  Usage.FeatureMap = Features.getNumBuckets() *
+                     (sizeof(llvm::StringMapEntryBase *) + sizeof(unsigned));
+  for (const auto &Entry : Features) {
+    Usage.FeatureMap += sizeof(Entry) + Entry.getKeyLength() + 1;
+  }
+
+  if (OrderedFeatures) {
+    Usage.Caches = heapBytes(*OrderedFeatures);
+  }
+
+  Usage.Metadata = sizeof(FeatureModel) + heapBytes(Name) +
+                   heapBytes(Path.native()) + heapBytes(Commit);
+  return Usage;
+}
+
 Feature *FeatureModel::addFeature(std::unique_ptr<Feature> NewFeature) {
-  auto PosInsertedFeature = Features.try_emplace(
-      std::string(NewFeature->getName()), std::move(NewFeature));
+  invalidateCaches();
+  // The key is copied into the map entry, the feature itself stays in place.
+  auto PosInsertedFeature =
+      Features.try_emplace(NewFeature->getName(), std::move(NewFeature));
   if (!PosInsertedFeature.second) {
     return nullptr;
   }
@@ -31,6 +195,7 @@ Feature *FeatureModel::addFeature(std::unique_ptr<Feature> NewFeature) {
 }
 
 void FeatureModel::removeFeature(Feature &F) {
+  invalidateCaches();
   if (&F == Root) {
     Root = nullptr;
   }
@@ -38,123 +203,290 @@ void FeatureModel::removeFeature(Feature &F) {
 }
 
 RootFeature *FeatureModel::setRoot(RootFeature &NewRoot) {
+  invalidateCaches();
   return Root = &NewRoot;
 }
 
-std::unique_ptr<FeatureModel> FeatureModel::clone() const {
-  FeatureModelBuilder FMB;
-  FMB.setVmName(this->getName().str());
-  FMB.setCommit(this->getCommit().str());
-  FMB.setPath(this->getPath().string());
+/// Collects the closest features below N, looking through relationships.
+static void collectChildFeatures(FeatureTreeNode &N,
+                                 llvm::SmallVectorImpl<Feature *> &Children) {
+  for (auto *C : N.children()) {
+    if (auto *F = llvm::dyn_cast<Feature>(C)) {
+      Children.push_back(F);
+    } else {
+      collectChildFeatures(*C, Children);
+    }
+  }
+}
+
+const std::vector<Feature *> &FeatureModel::getOrderedFeatures() const {
+  if (!OrderedFeatures) {
+    rebuildCaches();
+  }
+  return *OrderedFeatures;
+}
+
+void FeatureModel::rebuildCaches() const {
+  std::vector<Feature *> Ordered;
+  Ordered.reserve(Features.size());
+  llvm::SmallVector<Feature *, 16> Frontier;
+  llvm::SmallVector<Feature *, 8> Children;
+  if (Root) {
+    Frontier.push_back(Root);
+  }
+  // A well-formed tree visits every feature once, stop early on broken models
+  // that contain cycles.
+  while (!Frontier.empty() && Ordered.size() <= Features.size()) {
+    Feature *F = Frontier.pop_back_val();
+    Ordered.push_back(F);
 
-  for (const auto &KV : this->Features) {
-    std::vector<FeatureSourceRange> SourceRanges(
-        KV.getValue()->getLocations().begin(),
-        KV.getValue()->getLocations().end());
+    Children.clear();
+    collectChildFeatures(*F, Children);
+    // Push in descending order, so children are visited in ascending order.
+    std::stable_sort(Children.begin(), Children.end(),
+                     [](Feature *A, Feature *B) {
+                       return A->getFoldedName() > B->getFoldedName();
+                     });
+    Frontier.append(Children.begin(), Children.end());
+  }
 
-    switch (KV.getValue()->getKind()) {
+  // Assign pre-order intervals, subtree sizes are accumulated bottom up.
+  // Parents precede their children, so their ancestor jumps are complete.
+  for (unsigned I = 0; I < Ordered.size(); ++I) {
+    Feature *F = Ordered[I];
+    auto &Ancestors = F->Label.Ancestors;
+    F->Label = {&LabelEpoch, LabelEpoch, I, 1};
+    if (auto *P = F->getParentFeature(); P && P->hasValidLabel()) {
+      Ancestors.push_back(P);
+      // Cycles in broken models may lead back to F itself.
+      while (Ancestors.back() != F &&
+             Ancestors.back()->Label.Ancestors.size() >= Ancestors.size()) {
+        Ancestors.push_back(
+            Ancestors.back()->Label.Ancestors[Ancestors.size() - 1]);
+      }
+    }
+  }
+  for (auto It = Ordered.rbegin(); It != Ordered.rend(); ++It) {
+    if (auto *P = (*It)->getParentFeature(); P && P->hasValidLabel()) {
+      P->Label.SubtreeSize += (*It)->Label.SubtreeSize;
+    }
+  }
+  OrderedFeatures = std::move(Ordered);
+}
+
+namespace {
+
+/// Collects the feature references of a constraint in visiting order.
+class PrimaryFeatureCollector : public ConstraintVisitor {
+public:
+  bool visit(PrimaryFeatureConstraint *C) override {
+    Leaves.push_back(C);
+    return true;
+  }
+
+  llvm::SmallVector<PrimaryFeatureConstraint *, 8> Leaves;
+};
+
+} // namespace
+
+std::unique_ptr<FeatureModel> FeatureModel::clone() const {
+  // Maps every node of this model onto its copy, so pointers of the copy are
+  // remapped in one pass instead of being resolved by name.
+  llvm::DenseMap<const FeatureTreeNode *, FeatureTreeNode *> Nodes;
+  Nodes.reserve(Features.size() + Relationships.size());
+
+  auto Clone = std::make_unique<FeatureModel>(Name, nullptr, Path, Commit);
+  for (const auto &KV : Features) {
+    const Feature &F = *KV.getValue();
+    std::unique_ptr<Feature> Copy;
+    switch (F.getKind()) {
     case Feature::FeatureKind::FK_UNKNOWN:
-      FMB.makeFeature<Feature>(KV.getValue()->getName().str());
+      Copy = std::make_unique<Feature>(F.Name);
       break;
     case Feature::FeatureKind::FK_ROOT:
-      FMB.makeRoot(KV.getValue()->getName().str());
+      Copy = std::make_unique<RootFeature>(F.Name);
       break;
     case Feature::FeatureKind::FK_BINARY:
-      if (auto *F = llvm::dyn_cast<BinaryFeature>(KV.getValue().get()); F) {
-        FMB.makeFeature<BinaryFeature>(F->getName().str(), F->isOptional(),
-                                       std::move(SourceRanges));
-      }
+      Copy = std::make_unique<BinaryFeature>(F.Name);
       break;
-    case Feature::FeatureKind::FK_NUMERIC:
-      if (auto *F = llvm::dyn_cast<NumericFeature>(KV.getValue().get()); F) {
-        FMB.makeFeature<NumericFeature>(F->getName().str(), F->getValues(),
-                                        F->isOptional(),
-                                        std::move(SourceRanges));
-      }
+    case Feature::FeatureKind::FK_NUMERIC: {
+      const auto &N = llvm::cast<NumericFeature>(F);
+      auto *Step = N.getStepFunction();
+      Copy = std::make_unique<NumericFeature>(
+          F.Name, N.getValues(), false, std::vector<FeatureSourceRange>(), "",
+          Step ? std::make_unique<StepFunction>(*Step) : nullptr);
       break;
     }
-
-    if (auto *ParentFeature = KV.getValue()->getParentFeature()) {
-      FMB.addEdge(ParentFeature->getName().str(),
-                  KV.getValue()->getName().str());
     }
+    Copy->OutputString = F.OutputString;
+    Copy->Locations = F.Locations;
+    Copy->Opt = F.Opt;
+    if (&F == Root) {
+      Clone->Root = llvm::cast<RootFeature>(Copy.get());
+    }
+    Nodes[&F] = Clone->addFeature(std::move(Copy));
   }
 
-  for (const auto &Rel : this->Relationships) {
-    if (auto *P = llvm::dyn_cast_or_null<Feature>(Rel->getParent())) {
-      FMB.emplaceRelationship(Rel->getKind(), P->getName().str());
-    }
+  for (const auto &R : Relationships) {
+    Nodes[R.get()] =
+        Clone->addRelationship(std::make_unique<Relationship>(R->getKind()));
   }
 
-  // We can use recursive cloning on constraints, as we can rely on the
-  // builder to update pointers into the feature model correctly if invoked
-  // afterwards.
-  // TODO(s9latimm): Add unittests for cloned Constraints
-  for (const auto &C : this->booleanConstraints()) {
-    FMB.addConstraint(
-        std::make_unique<FeatureModel::BooleanConstraint>((**C)->clone()));
+  for (const auto &[Old, New] : Nodes) {
+    New->Parent = Nodes.lookup(Old->Parent);
+    New->Children.reserve(Old->Children.size());
+    for (auto *C : Old->Children) {
+      if (auto *NewC = Nodes.lookup(C)) {
+        New->Children.push_back(NewC);
+      }
+    }
   }
 
-  for (const auto &C : this->nonBooleanConstraints()) {
-    FMB.addConstraint(
-        std::make_unique<FeatureModel::NonBooleanConstraint>((**C)->clone()));
+  // Constraints are cloned recursively, afterwards the feature references of
+  // both trees are visited in the same order and rebound through the map.
+  llvm::DenseMap<const Constraint *, PrimaryFeatureConstraint *> Leaves;
+  auto CloneConstraint = [&Nodes, &Leaves](Constraint &C) {
+    auto Copy = C.clone();
+    PrimaryFeatureCollector OldLeaves;
+    PrimaryFeatureCollector NewLeaves;
+    C.accept(OldLeaves);
+    Copy->accept(NewLeaves);
+    assert(OldLeaves.Leaves.size() == NewLeaves.Leaves.size());
+    for (size_t I = 0; I < OldLeaves.Leaves.size(); ++I) {
+      auto *NewF = llvm::cast_or_null<Feature>(
+          Nodes.lookup(OldLeaves.Leaves[I]->getFeature()));
+      if (NewF) {
+        NewLeaves.Leaves[I]->setFeature(NewF);
+      }
+      Leaves[OldLeaves.Leaves[I]] = NewLeaves.Leaves[I];
+    }
+    return Copy;
+  };
+
+  for (const auto &C : BooleanConstraints) {
+    Clone->addConstraint(std::make_unique<BooleanConstraint>(
+        CloneConstraint(*C->constraint())));
+  }
+  for (const auto &C : NonBooleanConstraints) {
+    Clone->addConstraint(std::make_unique<NonBooleanConstraint>(
+        CloneConstraint(*C->constraint())));
+  }
+  for (const auto &C : MixedConstraints) {
+    Clone->addConstraint(std::make_unique<MixedConstraint>(
+        CloneConstraint(*C->constraint()), C->req(), C->exprKind()));
   }
 
-  for (const auto &C : this->mixedConstraints()) {
-    FMB.addConstraint(std::make_unique<FeatureModel::MixedConstraint>(
-        C->constraint()->clone(), C->req(), C->exprKind()));
+  // Keep the order in which features reference their constraints.
+  for (const auto &KV : Features) {
+    auto *NewF = llvm::cast<Feature>(Nodes.lookup(KV.getValue().get()));
+    for (auto *C : KV.getValue()->Constraints) {
+      if (auto *NewC = Leaves.lookup(C)) {
+        NewF->addConstraint(NewC);
+      }
+    }
   }
 
-  // Build clone of FM which is supposed to work, as the original FM should be
-  //  valid.
-  auto FM = FMB.buildFeatureModel();
-  assert(FM);
-  return FM;
+  return Clone;
 }
 
 //===----------------------------------------------------------------------===//
 //                           FeatureModel Helpers
 //===----------------------------------------------------------------------===//
 
+/// Opens \p Path for reading. Large files are memory mapped instead of read,
+/// and no null terminator is requested, so the mapping can be parsed as is.
+static llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+openFeatureModelFile(llvm::StringRef Path) {
+  return llvm::MemoryBuffer::getFile(Path, /*IsText=*/false,
+                                     /*RequiresNullTerminator=*/false);
+}
+
 std::unique_ptr<FeatureModel>
-loadXMLFeatureModelFromBuffer(std::string FileContent) {
-  return FeatureModelXmlParser(std::move(FileContent)).buildFeatureModel();
+loadXMLFeatureModelFromBuffer(std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  return FeatureModelXmlParser(std::move(Buffer)).buildFeatureModel();
 }
 
 std::unique_ptr<FeatureModel>
-loadFeatureModelFromBuffer(std::string FileContent) {
-  // TODO (se-sic/VaRA#784): implement checking for different FM file types
-  return loadXMLFeatureModelFromBuffer(std::move(FileContent));
+loadFeatureModelFromBuffer(std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  if (FeatureModelBinaryParser::isBinaryFeatureModel(Buffer->getBuffer())) {
+    return FeatureModelBinaryParser(std::move(Buffer)).buildFeatureModel();
+  }
+  return loadXMLFeatureModelFromBuffer(std::move(Buffer));
 }
 
 std::unique_ptr<FeatureModel> loadFeatureModel(llvm::StringRef Path) {
-  auto FStream = llvm::MemoryBuffer::getFileAsStream(Path);
-  if (std::error_code EC = FStream.getError()) {
+  auto Buffer = openFeatureModelFile(Path);
+  if (std::error_code EC = Buffer.getError()) {
     llvm::errs() << EC.message() << '\n';
     return {};
   }
 
-  return loadFeatureModelFromBuffer(FStream.get()->getBuffer().str());
+  return loadFeatureModelFromBuffer(std::move(Buffer.get()));
 }
 
-bool verifyXMLFeatureModelFromBuffer(std::string FileContent) {
-  return vara::feature::FeatureModelXmlParser(std::move(FileContent))
+FeatureModelLoadResult
+loadFeatureModel(llvm::StringRef Path, const FeatureModelLoadOptions &Options) {
+  auto Buffer = openFeatureModelFile(Path);
+  if (std::error_code EC = Buffer.getError()) {
+    return Error(FeatureModelDiagnostics{{0, EC.message()}});
+  }
+
+  if (FeatureModelBinaryParser::isBinaryFeatureModel(
+          Buffer.get()->getBuffer())) {
+    return FeatureModelBinaryParser(std::move(Buffer.get()))
+        .buildVerifiedFeatureModel();
+  }
+  return FeatureModelXmlParser(std::move(Buffer.get()), Options.TrustedInput)
+      .buildVerifiedFeatureModel();
+}
+
+std::vector<FeatureModelLoadResult>
+loadFeatureModels(llvm::ArrayRef<std::string> Paths, unsigned Threads,
+                  const FeatureModelLoadOptions &Options) {
+  // libxml2 sets up its global state lazily, which is only safe as long as a
+  // single thread uses it.
+  xmlInitParser();
+
+  std::vector<std::optional<FeatureModelLoadResult>> Results(Paths.size());
+  {
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(Threads));
+    for (size_t I = 0; I < Paths.size(); ++I) {
+      Pool.async([&Results, &Paths, &Options, I]() {
+        Results[I].emplace(loadFeatureModel(Paths[I], Options));
+      });
+    }
+    Pool.wait();
+  }
+
+  std::vector<FeatureModelLoadResult> Loaded;
+  Loaded.reserve(Results.size());
+  for (auto &R : Results) {
+    Loaded.push_back(std::move(*R));
+  }
+  return Loaded;
+}
+
+bool verifyXMLFeatureModelFromBuffer(
+    std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  return vara::feature::FeatureModelXmlParser(std::move(Buffer))
       .verifyFeatureModel();
 }
 
-bool verifyFeatureModelFromBuffer(std::string FileContent) {
-  // TODO (se-sic/VaRA#784): implement checking for different FM file types
-  return verifyXMLFeatureModelFromBuffer(std::move(FileContent));
+bool verifyFeatureModelFromBuffer(std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  if (FeatureModelBinaryParser::isBinaryFeatureModel(Buffer->getBuffer())) {
+    return FeatureModelBinaryParser(std::move(Buffer)).verifyFeatureModel();
+  }
+  return verifyXMLFeatureModelFromBuffer(std::move(Buffer));
 }
 
 bool verifyFeatureModel(llvm::StringRef Path) {
-  auto FStream = llvm::MemoryBuffer::getFileAsStream(Path);
-  if (std::error_code EC = FStream.getError()) {
+  auto Buffer = openFeatureModelFile(Path);
+  if (std::error_code EC = Buffer.getError()) {
     llvm::errs() << EC.message() << '\n';
     return {};
   }
 
-  return verifyFeatureModelFromBuffer(FStream.get()->getBuffer().str());
+  return verifyFeatureModelFromBuffer(std::move(Buffer.get()));
 }
 
 } // namespace vara::feature
@@ -6,25 +6,25 @@ namespace vara::feature {
 //                        FeatureModelBuilder
 //===----------------------------------------------------------------------===//
 
-std::unique_ptr<FeatureModel> FeatureModelBuilder::buildFeatureModel() {
+std::unique_ptr<FeatureModel>
+FeatureModelBuilder::buildFeatureModel(llvm::raw_ostream &OS) {
   assert(FM->getRoot() && "FeatureModel has no root.");
 
   if (Result E = FeatureBuilder.commit(); !E) {
-    llvm::errs() << "Building features failed with error: " << E << '\n';
+    OS << "Building features failed with error: " << E << '\n';
     ModelBuilder.abort();
     RelationBuilder.abort();
     return nullptr;
   }
 
   if (Result E = ModelBuilder.commit(); !E) {
-    llvm::errs() << "Building feature tree failed with error: " << E << '\n';
+    OS << "Building feature tree failed with error: " << E << '\n';
     RelationBuilder.abort();
     return nullptr;
   }
 
   if (Result E = RelationBuilder.commit(); !E) {
-    llvm::errs() << "Building feature relations failed with error: " << E
-                 << '\n';
+    OS << "Building feature relations failed with error: " << E << '\n';
     return nullptr;
   }
 
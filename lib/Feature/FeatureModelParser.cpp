@@ -3,147 +3,308 @@
 #include "vara/Feature/ConstraintParser.h"
 #include "vara/Feature/Feature.h"
 #include "vara/Feature/FeatureSourceRange.h"
+#include "vara/Feature/FlatConstraint.h"
 #include "vara/Feature/StepFunctionParser.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "libxml/hash.h"
+#include "libxml/valid.h"
+
 #include "vara/Utils/VariantUtil.h"
 
+#include "BinaryFormat.h"
 #include "SxfmConstants.h"
+#include "XmlChecksum.h"
 #include "XmlConstants.h"
 
 #include <iostream>
-#include <regex>
 
 namespace vara::feature {
 
 std::string trim(llvm::StringRef S) { return llvm::StringRef(S).trim().str(); }
 
-Result<FTErrorCode>
-FeatureModelXmlParser::parseConfigurationOption(xmlNode *Node,
-                                                bool Num = false) {
+//===----------------------------------------------------------------------===//
+//                        XML elements and options
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// Elements of the feature model DTD.
+enum class XmlElement {
+  VM,
+  BINARYOPTIONS,
+  NUMERICOPTIONS,
+  BOOLEANCONSTRAINTS,
+  NONBOOLEANCONSTRAINTS,
+  MIXEDCONSTRAINTS,
+  CONFIGURATIONOPTION,
+  CONSTRAINT,
+  NAME,
+  OUTPUTSTRING,
+  PARENT,
+  CHILDREN,
+  IMPLIEDOPTIONS,
+  EXCLUDEDOPTIONS,
+  OPTIONS,
+  OPTIONAL,
+  MINVALUE,
+  MAXVALUE,
+  VALUES,
+  STEPFUNCTION,
+  LOCATIONS,
+  SOURCERANGE,
+  REVISIONRANGE,
+  INTRODUCED,
+  REMOVED,
+  PATH,
+  START,
+  END,
+  LINE,
+  COLUMN,
+  MEMBEROFFSET,
+  /// Elements of configuration options that are accepted but not used.
+  UNUSED,
+  UNKNOWN
+};
+
+llvm::StringRef toStringRef(const xmlChar *S) {
+  return reinterpret_cast<const char *>(S);
+}
+
+XmlElement classifyElement(llvm::StringRef Name) {
+  static const llvm::StringMap<XmlElement> Elements{
+      {toStringRef(XmlConstants::VM), XmlElement::VM},
+      {toStringRef(XmlConstants::BINARYOPTIONS), XmlElement::BINARYOPTIONS},
+      {toStringRef(XmlConstants::NUMERICOPTIONS), XmlElement::NUMERICOPTIONS},
+      {toStringRef(XmlConstants::BOOLEANCONSTRAINTS),
+       XmlElement::BOOLEANCONSTRAINTS},
+      {toStringRef(XmlConstants::NONBOOLEANCONSTRAINTS),
+       XmlElement::NONBOOLEANCONSTRAINTS},
+      {toStringRef(XmlConstants::MIXEDCONSTRAINTS),
+       XmlElement::MIXEDCONSTRAINTS},
+      {toStringRef(XmlConstants::CONFIGURATIONOPTION),
+       XmlElement::CONFIGURATIONOPTION},
+      {toStringRef(XmlConstants::CONSTRAINT), XmlElement::CONSTRAINT},
+      {toStringRef(XmlConstants::NAME), XmlElement::NAME},
+      {toStringRef(XmlConstants::OUTPUTSTRING), XmlElement::OUTPUTSTRING},
+      {toStringRef(XmlConstants::PARENT), XmlElement::PARENT},
+      {toStringRef(XmlConstants::CHILDREN), XmlElement::CHILDREN},
+      {toStringRef(XmlConstants::IMPLIEDOPTIONS), XmlElement::IMPLIEDOPTIONS},
+      {toStringRef(XmlConstants::EXCLUDEDOPTIONS),
+       XmlElement::EXCLUDEDOPTIONS},
+      {toStringRef(XmlConstants::OPTIONS), XmlElement::OPTIONS},
+      {toStringRef(XmlConstants::OPTIONAL), XmlElement::OPTIONAL},
+      {toStringRef(XmlConstants::MINVALUE), XmlElement::MINVALUE},
+      {toStringRef(XmlConstants::MAXVALUE), XmlElement::MAXVALUE},
+      {toStringRef(XmlConstants::VALUES), XmlElement::VALUES},
+      {toStringRef(XmlConstants::STEPFUNCTION), XmlElement::STEPFUNCTION},
+      {toStringRef(XmlConstants::LOCATIONS), XmlElement::LOCATIONS},
+      {toStringRef(XmlConstants::SOURCERANGE), XmlElement::SOURCERANGE},
+      {toStringRef(XmlConstants::REVISIONRANGE), XmlElement::REVISIONRANGE},
+      {toStringRef(XmlConstants::INTRODUCED), XmlElement::INTRODUCED},
+      {toStringRef(XmlConstants::REMOVED), XmlElement::REMOVED},
+      {toStringRef(XmlConstants::PATH), XmlElement::PATH},
+      {toStringRef(XmlConstants::START), XmlElement::START},
+      {toStringRef(XmlConstants::END), XmlElement::END},
+      {toStringRef(XmlConstants::LINE), XmlElement::LINE},
+      {toStringRef(XmlConstants::COLUMN), XmlElement::COLUMN},
+      {toStringRef(XmlConstants::MEMBEROFFSET), XmlElement::MEMBEROFFSET},
+      {"prefix", XmlElement::UNUSED},
+      {"preFix", XmlElement::UNUSED},
+      {"postfix", XmlElement::UNUSED},
+      {"postFix", XmlElement::UNUSED},
+      {"defaultValue", XmlElement::UNUSED},
+  };
+  auto Search = Elements.find(Name);
+  return Search != Elements.end() ? Search->getValue() : XmlElement::UNKNOWN;
+}
+
+/// Checks whether element \p E may be nested in \p Parent according to the
+/// DTD, \p Parent is \c std::nullopt for the document element.
+bool isValidNesting(XmlElement E, std::optional<XmlElement> Parent) {
+  if (!Parent) {
+    return E == XmlElement::VM;
+  }
+  switch (E) {
+  case XmlElement::VM:
+  case XmlElement::UNKNOWN:
+    return false;
+  case XmlElement::BINARYOPTIONS:
+  case XmlElement::NUMERICOPTIONS:
+  case XmlElement::BOOLEANCONSTRAINTS:
+  case XmlElement::NONBOOLEANCONSTRAINTS:
+  case XmlElement::MIXEDCONSTRAINTS:
+    return *Parent == XmlElement::VM;
+  case XmlElement::CONFIGURATIONOPTION:
+    return *Parent == XmlElement::BINARYOPTIONS ||
+           *Parent == XmlElement::NUMERICOPTIONS;
+  case XmlElement::CONSTRAINT:
+    return *Parent == XmlElement::BOOLEANCONSTRAINTS ||
+           *Parent == XmlElement::NONBOOLEANCONSTRAINTS ||
+           *Parent == XmlElement::MIXEDCONSTRAINTS;
+  case XmlElement::NAME:
+  case XmlElement::OUTPUTSTRING:
+  case XmlElement::PARENT:
+  case XmlElement::CHILDREN:
+  case XmlElement::IMPLIEDOPTIONS:
+  case XmlElement::EXCLUDEDOPTIONS:
+  case XmlElement::OPTIONAL:
+  case XmlElement::MINVALUE:
+  case XmlElement::MAXVALUE:
+  case XmlElement::VALUES:
+  case XmlElement::STEPFUNCTION:
+  case XmlElement::LOCATIONS:
+  case XmlElement::UNUSED:
+    return *Parent == XmlElement::CONFIGURATIONOPTION;
+  case XmlElement::OPTIONS:
+    return *Parent == XmlElement::CHILDREN ||
+           *Parent == XmlElement::IMPLIEDOPTIONS ||
+           *Parent == XmlElement::EXCLUDEDOPTIONS;
+  case XmlElement::SOURCERANGE:
+    return *Parent == XmlElement::LOCATIONS;
+  case XmlElement::REVISIONRANGE:
+  case XmlElement::PATH:
+  case XmlElement::START:
+  case XmlElement::END:
+  case XmlElement::MEMBEROFFSET:
+    return *Parent == XmlElement::SOURCERANGE;
+  case XmlElement::INTRODUCED:
+  case XmlElement::REMOVED:
+    return *Parent == XmlElement::REVISIONRANGE;
+  case XmlElement::LINE:
+  case XmlElement::COLUMN:
+    return *Parent == XmlElement::START || *Parent == XmlElement::END;
+  }
+  return false;
+}
+
+/// \brief Configuration option of the XML format, collected element by
+/// element and added to a builder. Shared by the DOM and the streaming parser.
+class XmlOption {
+public:
+  explicit XmlOption(bool Numeric = false) : Numeric(Numeric) {}
+
+  /// Handles element \p E of the option with content \p Text. The options
+  /// of children, impliedOptions, and excludedOptions pass that element as
+  /// \p Parent.
+  ///
+  /// \returns the problem if the element contradicts the model so far
+  Result<std::string> addElement(FeatureModelBuilder &FMB, XmlElement E,
+                                 XmlElement Parent, llvm::StringRef Text,
+                                 unsigned Line);
+
+  void addSourceRange(FeatureSourceRange Range) {
+    SourceRanges.push_back(std::move(Range));
+  }
+
+  /// Adds the option as feature to \p FMB.
+  void build(FeatureModelBuilder &FMB);
+
+private:
+  bool Numeric;
+  // XML has the names root and base specified as root nodes.
   std::string Name{"root"};
   std::string OutputString;
-  bool Opt = false;
-  int64_t MinValue = 0;
-  int64_t MaxValue = 0;
+  bool Opt{false};
+  int64_t MinValue{0};
+  int64_t MaxValue{0};
   std::vector<int64_t> Values;
   std::vector<FeatureSourceRange> SourceRanges;
   std::unique_ptr<StepFunction> Step;
-  for (xmlNode *Head = Node->children; Head; Head = Head->next) {
-    if (Head->type == XML_ELEMENT_NODE) {
-      std::string Cnt{trim(reinterpret_cast<char *>(
-          UniqueXmlChar(xmlNodeGetContent(Head), xmlFree).get()))};
-      if (Cnt.empty()) {
-        continue;
+};
+
+Result<std::string> XmlOption::addElement(FeatureModelBuilder &FMB,
+                                          XmlElement E, XmlElement Parent,
+                                          llvm::StringRef Text,
+                                          unsigned Line) {
+  std::string Cnt = trim(Text);
+  if (Cnt.empty()) {
+    return Ok();
+  }
+
+  switch (E) {
+  case XmlElement::NAME:
+    Name = Cnt;
+    break;
+  case XmlElement::OUTPUTSTRING:
+    OutputString = Text.ltrim().str();
+    break;
+  case XmlElement::OPTIONAL:
+    Opt = Cnt == "True";
+    break;
+  case XmlElement::PARENT:
+    if (auto P = FMB.getParentName(Name); P && *P != Cnt) {
+      return Error(llvm::formatv("Ambiguous edge to {0} from either '{1}' or "
+                                 "'{2}'.",
+                                 Name, *P, Cnt)
+                       .str());
+    }
+    FMB.addEdge(Cnt, Name);
+    break;
+  case XmlElement::OPTIONS:
+    if (Parent == XmlElement::CHILDREN) {
+      if (auto P = FMB.getParentName(Cnt); P && *P != Name) {
+        return Error(llvm::formatv("Ambiguous edge to {0} from either '{1}' "
+                                   "or '{2}'.",
+                                   Cnt, *P, Name)
+                         .str());
       }
-      // The DTD enforces name to be the first element of an
-      // configurationOption. This method is never called without validating
-      // the input beforehand.
-      if (!xmlStrcmp(Head->name, XmlConstants::NAME)) {
-        Name = Cnt;
-      } else if (!xmlStrcmp(Head->name, XmlConstants::OUTPUTSTRING)) {
-        OutputString =
-            llvm::StringRef(
-                reinterpret_cast<char *>(
-                    UniqueXmlChar(xmlNodeGetContent(Head), xmlFree).get()))
-                .ltrim()
-                .str();
-      } else if (!xmlStrcmp(Head->name, XmlConstants::OPTIONAL)) {
-        Opt = Cnt == "True";
-      } else if (!xmlStrcmp(Head->name, XmlConstants::PARENT)) {
-        if (auto P = FMB.getParentName(Name); P && *P != Cnt) {
-          llvm::errs() << llvm::formatv(
-              "Ambiguous edge to {0} from either '{1}' or '{2}'.\n", Name, *P,
-              Cnt);
-          return Error(INCONSISTENT);
-        }
-        FMB.addEdge(Cnt, Name);
-      } else if (!xmlStrcmp(Head->name, XmlConstants::CHILDREN)) {
-        for (xmlNode *Child = Head->children; Child; Child = Child->next) {
-          if (Child->type == XML_ELEMENT_NODE) {
-            if (!xmlStrcmp(Child->name, XmlConstants::OPTIONS)) {
-              auto FeatureName = std::string(reinterpret_cast<char *>(
-                  std::unique_ptr<xmlChar, void (*)(void *)>(
-                      xmlNodeGetContent(Child), xmlFree)
-                      .get()));
-              if (auto P = FMB.getParentName(FeatureName); P && *P != Name) {
-                llvm::errs() << llvm::formatv(
-                    "Ambiguous edge to {0} from either '{1}' or '{2}'.\n",
-                    FeatureName, *P, Name);
-                return Error(INCONSISTENT);
-              }
-              FMB.addEdge(Name, FeatureName);
-            }
-          }
-        }
-      } else if (!xmlStrcmp(Head->name, XmlConstants::EXCLUDEDOPTIONS)) {
-        for (xmlNode *Child = Head->children; Child; Child = Child->next) {
-          if (Child->type == XML_ELEMENT_NODE) {
-            if (!xmlStrcmp(Child->name, XmlConstants::OPTIONS)) {
-              UniqueXmlChar CCnt(xmlNodeGetContent(Child), xmlFree);
-              ConstraintBuilder CB;
-              CB.feature(Name).excludes().feature(
-                  trim(reinterpret_cast<char *>(CCnt.get())));
-              FMB.addConstraint(
-                  std::make_unique<FeatureModel::BooleanConstraint>(
-                      CB.build()));
-            }
-          }
-        }
-      } else if (!xmlStrcmp(Head->name, XmlConstants::IMPLIEDOPTIONS)) {
-        for (xmlNode *Child = Head->children; Child; Child = Child->next) {
-          if (Child->type == XML_ELEMENT_NODE) {
-            if (!xmlStrcmp(Child->name, XmlConstants::OPTIONS)) {
-              UniqueXmlChar CCnt(xmlNodeGetContent(Child), xmlFree);
-              ConstraintBuilder CB;
-              CB.feature(Name).implies().feature(
-                  trim(reinterpret_cast<char *>(CCnt.get())));
-              FMB.addConstraint(
-                  std::make_unique<FeatureModel::BooleanConstraint>(
-                      CB.build()));
-            }
-          }
-        }
-      } else if (!xmlStrcmp(Head->name, XmlConstants::LOCATIONS)) {
-        for (xmlNode *Child = Head->children; Child; Child = Child->next) {
-          if (Child->type == XML_ELEMENT_NODE) {
-            if (!xmlStrcmp(Child->name, XmlConstants::SOURCERANGE)) {
-              SourceRanges.push_back(createFeatureSourceRange(Child));
-            }
-          }
-        }
-      } else if (Num) {
-        if (!xmlStrcmp(Head->name, XmlConstants::MINVALUE)) {
-          MinValue = parseInteger(Cnt, Head->line);
-        } else if (!xmlStrcmp(Head->name, XmlConstants::MAXVALUE)) {
-          MaxValue = parseInteger(Cnt, Head->line);
-        } else if (!xmlStrcmp(Head->name, XmlConstants::VALUES)) {
-          const std::regex Regex(R"(-?\d+)");
-          std::smatch Matches;
-          for (std::string Suffix = Cnt; regex_search(Suffix, Matches, Regex);
-               Suffix = Matches.suffix()) {
-            Values.emplace_back(parseInteger(Matches.str(), Head->line));
-          }
-        } else if (!xmlStrcmp(Head->name, XmlConstants::STEPFUNCTION)) {
-          Step = StepFunctionParser(Cnt, Head->line).buildStepFunction();
-        }
+      FMB.addEdge(Name, Cnt);
+    } else {
+      ConstraintBuilder CB;
+      if (Parent == XmlElement::EXCLUDEDOPTIONS) {
+        CB.feature(Name).excludes().feature(Cnt);
+      } else {
+        CB.feature(Name).implies().feature(Cnt);
       }
+      FMB.addConstraint(
+          std::make_unique<FeatureModel::BooleanConstraint>(CB.build()));
+    }
+    break;
+  case XmlElement::MINVALUE:
+    if (Numeric) {
+      MinValue = parseInteger(Cnt, Line);
+    }
+    break;
+  case XmlElement::MAXVALUE:
+    if (Numeric) {
+      MaxValue = parseInteger(Cnt, Line);
     }
+    break;
+  case XmlElement::VALUES:
+    if (Numeric) {
+      Values = parseIntegerList(Cnt, Line);
+    }
+    break;
+  case XmlElement::STEPFUNCTION:
+    if (Numeric) {
+      Step = StepFunctionParser(Cnt, Line).buildStepFunction();
+    }
+    break;
+  default:
+    break;
   }
+  return Ok();
+}
 
-  // XML has those names specified as root nodes
+void XmlOption::build(FeatureModelBuilder &FMB) {
   if (Name == "root" || Name == "base") {
     FMB.makeRoot(Name);
-  } else if (Num) {
+  } else if (Numeric) {
     if (Values.empty()) {
       FMB.makeFeature<NumericFeature>(Name, std::make_pair(MinValue, MaxValue),
                                       Opt, std::move(SourceRanges),
                                       OutputString, std::move(Step));
     } else {
-      FMB.makeFeature<NumericFeature>(Name, Values, Opt,
+      FMB.makeFeature<NumericFeature>(Name, std::move(Values), Opt,
                                       std::move(SourceRanges), OutputString,
                                       std::move(Step));
     }
@@ -151,6 +312,114 @@ FeatureModelXmlParser::parseConfigurationOption(xmlNode *Node,
     FMB.makeFeature<BinaryFeature>(Name, Opt, std::move(SourceRanges),
                                    OutputString);
   }
+}
+
+/// Parses the constraint \p Text of a constraint element below \p Parent and
+/// adds it to \p FMB. Mixed constraints take the attributes \p Req and
+/// \p ExprKind into account.
+///
+/// \returns whether the constraint could be parsed
+bool addXmlConstraint(FeatureModelBuilder &FMB, XmlElement Parent,
+                      llvm::StringRef Text, unsigned Line,
+                      std::optional<llvm::StringRef> Req,
+                      std::optional<llvm::StringRef> ExprKind) {
+  auto Constraint =
+      ConstraintParser(Text, Line).buildConstraint([&FMB](llvm::StringRef N) {
+        return FMB.getFeature(N);
+      });
+  if (!Constraint) {
+    return false;
+  }
+  switch (Parent) {
+  case XmlElement::BOOLEANCONSTRAINTS:
+    FMB.addConstraint(std::make_unique<FeatureModel::BooleanConstraint>(
+        std::move(Constraint)));
+    break;
+  case XmlElement::NONBOOLEANCONSTRAINTS:
+    FMB.addConstraint(std::make_unique<FeatureModel::NonBooleanConstraint>(
+        std::move(Constraint)));
+    break;
+  default:
+    FMB.addConstraint(std::make_unique<FeatureModel::MixedConstraint>(
+        std::move(Constraint),
+        Req && *Req == "none" ? FeatureModel::MixedConstraint::Req::NONE
+                              : FeatureModel::MixedConstraint::Req::ALL,
+        ExprKind && *ExprKind == "neg"
+            ? FeatureModel::MixedConstraint::ExprKind::NEG
+            : FeatureModel::MixedConstraint::ExprKind::POS));
+    break;
+  }
+  return true;
+}
+
+/// Content of the DOM node \p Node.
+std::string getContent(xmlNode *Node) {
+  FeatureModelParser::UniqueXmlChar Cnt(xmlNodeGetContent(Node), xmlFree);
+  return Cnt ? reinterpret_cast<char *>(Cnt.get()) : "";
+}
+
+/// Value of attribute \p Name of the DOM node \p Node, if present.
+std::optional<std::string> getProp(xmlNode *Node, const xmlChar *Name) {
+  FeatureModelParser::UniqueXmlChar Cnt(xmlGetProp(Node, Name), xmlFree);
+  if (!Cnt) {
+    return std::nullopt;
+  }
+  return std::string(reinterpret_cast<char *>(Cnt.get()));
+}
+
+} // namespace
+
+//===----------------------------------------------------------------------===//
+//                        FeatureModelXmlParser Class
+//===----------------------------------------------------------------------===//
+
+Result<FTErrorCode>
+FeatureModelXmlParser::parseConfigurationOption(xmlNode *Node,
+                                                bool Num = false) {
+  XmlOption Option(Num);
+  for (xmlNode *Head = Node->children; Head; Head = Head->next) {
+    if (Head->type != XML_ELEMENT_NODE) {
+      continue;
+    }
+    // The DTD enforces name to be the first element of an
+    // configurationOption. This method is never called without validating
+    // the input beforehand.
+    XmlElement E = classifyElement(toStringRef(Head->name));
+    switch (E) {
+    case XmlElement::LOCATIONS:
+      for (xmlNode *Child = Head->children; Child; Child = Child->next) {
+        if (Child->type == XML_ELEMENT_NODE &&
+            !xmlStrcmp(Child->name, XmlConstants::SOURCERANGE)) {
+          Option.addSourceRange(createFeatureSourceRange(Child));
+        }
+      }
+      break;
+    case XmlElement::CHILDREN:
+    case XmlElement::IMPLIEDOPTIONS:
+    case XmlElement::EXCLUDEDOPTIONS:
+      for (xmlNode *Child = Head->children; Child; Child = Child->next) {
+        if (Child->type == XML_ELEMENT_NODE &&
+            !xmlStrcmp(Child->name, XmlConstants::OPTIONS)) {
+          if (auto R = Option.addElement(FMB, XmlElement::OPTIONS, E,
+                                         getContent(Child), Child->line);
+              !R) {
+            report(R.getError(), Child->line);
+            return Error(INCONSISTENT);
+          }
+        }
+      }
+      break;
+    default:
+      if (auto R = Option.addElement(FMB, E, XmlElement::CONFIGURATIONOPTION,
+                                     getContent(Head), Head->line);
+          !R) {
+        report(R.getError(), Head->line);
+        return Error(INCONSISTENT);
+      }
+      break;
+    }
+  }
+  Option.build(FMB);
   return Ok();
 }
 
@@ -213,55 +482,17 @@ Result<FTErrorCode> FeatureModelXmlParser::parseOptions(xmlNode *Node,
   return Ok();
 }
 
-template <class ConstraintTy>
 Result<FTErrorCode> FeatureModelXmlParser::parseConstraints(xmlNode *Node) {
+  XmlElement Kind = classifyElement(toStringRef(Node->name));
   for (xmlNode *H = Node->children; H; H = H->next) {
-    if (H->type == XML_ELEMENT_NODE) {
-      if (!xmlStrcmp(H->name, XmlConstants::CONSTRAINT)) {
-        UniqueXmlChar Cnt(xmlNodeGetContent(H), xmlFree);
-        if (auto Constraint =
-                ConstraintParser(
-                    std::string(reinterpret_cast<char *>(Cnt.get())),
-                    Node->line)
-                    .buildConstraint()) {
-          FMB.addConstraint(
-              std::make_unique<ConstraintTy>(std::move(Constraint)));
-        } else {
-          return Error(ERROR);
-        }
-      }
-    }
-  }
-  return Ok();
-}
-
-template <>
-Result<FTErrorCode>
-FeatureModelXmlParser::parseConstraints<FeatureModel::MixedConstraint>(
-    xmlNode *Node) {
-  for (xmlNode *H = Node->children; H; H = H->next) {
-    if (H->type == XML_ELEMENT_NODE) {
-      if (!xmlStrcmp(H->name, XmlConstants::CONSTRAINT)) {
-        UniqueXmlChar Cnt(xmlNodeGetContent(H), xmlFree);
-        if (auto Constraint =
-                ConstraintParser(
-                    std::string(reinterpret_cast<char *>(Cnt.get())),
-                    Node->line)
-                    .buildConstraint()) {
-          UniqueXmlChar R(xmlGetProp(H, XmlConstants::REQ), xmlFree);
-          UniqueXmlChar E(xmlGetProp(H, XmlConstants::EXPRKIND), xmlFree);
-
-          FMB.addConstraint(std::make_unique<FeatureModel::MixedConstraint>(
-              std::move(Constraint),
-              std::string(reinterpret_cast<char *>(R.get())) == "none"
-                  ? FeatureModel::MixedConstraint::Req::NONE
-                  : FeatureModel::MixedConstraint::Req::ALL,
-              std::string(reinterpret_cast<char *>(E.get())) == "neg"
-                  ? FeatureModel::MixedConstraint::ExprKind::NEG
-                  : FeatureModel::MixedConstraint::ExprKind::POS));
-        } else {
-          return Error(ERROR);
-        }
+    if (H->type == XML_ELEMENT_NODE &&
+        !xmlStrcmp(H->name, XmlConstants::CONSTRAINT)) {
+      auto Req = getProp(H, XmlConstants::REQ);
+      auto ExprKind = getProp(H, XmlConstants::EXPRKIND);
+      if (!addXmlConstraint(FMB, Kind, getContent(H), H->line, Req,
+                            ExprKind)) {
+        report("Invalid constraint.", H->line);
+        return Error(ERROR);
       }
     }
   }
@@ -293,16 +524,10 @@ Result<FTErrorCode> FeatureModelXmlParser::parseVm(xmlNode *Node) {
         if (!parseOptions(H, true)) {
           return Error(ERROR);
         }
-      } else if (!xmlStrcmp(H->name, XmlConstants::BOOLEANCONSTRAINTS)) {
-        if (!parseConstraints<FeatureModel::BooleanConstraint>(H)) {
-          return Error(ERROR);
-        }
-      } else if (!xmlStrcmp(H->name, XmlConstants::NONBOOLEANCONSTRAINTS)) {
-        if (!parseConstraints<FeatureModel::NonBooleanConstraint>(H)) {
-          return Error(ERROR);
-        }
-      } else if (!xmlStrcmp(H->name, XmlConstants::MIXEDCONSTRAINTS)) {
-        if (!parseConstraints<FeatureModel::MixedConstraint>(H)) {
+      } else if (!xmlStrcmp(H->name, XmlConstants::BOOLEANCONSTRAINTS) ||
+                 !xmlStrcmp(H->name, XmlConstants::NONBOOLEANCONSTRAINTS) ||
+                 !xmlStrcmp(H->name, XmlConstants::MIXEDCONSTRAINTS)) {
+        if (!parseConstraints(H)) {
           return Error(ERROR);
         }
       }
@@ -350,39 +575,43 @@ FeatureModelXmlParser::createFeatureSourceLocation(xmlNode *Node) {
   return {Line, Column};
 }
 
-/// Decide whether feature A excludes B. Beware that this method only detects
-/// very simple trees with binary excludes.
-bool detectExclude(const Feature *A, const Feature *B) {
-  return std::any_of(
-      A->excludes().begin(), A->excludes().end(), [A, B](const auto *E) {
-        if (const auto *LHS =
-                llvm::dyn_cast<PrimaryFeatureConstraint>(E->getLeftOperand())) {
-          if (const auto *RHS = llvm::dyn_cast<PrimaryFeatureConstraint>(
-                  E->getRightOperand())) {
-            return (LHS->getFeature() &&
-                    LHS->getFeature()->getName() == A->getName() &&
-                    RHS->getFeature() &&
-                    RHS->getFeature()->getName() == B->getName());
-          }
-        }
-        return false;
-      });
-}
-
 Result<FTErrorCode>
 FeatureModelXmlParser::detectXMLAlternatives(FeatureModel &FM) {
-  auto Transactions = FeatureModelModifyTransaction::openTransaction(FM);
   const auto &FMConstRef = FM;
+
+  // Count for every feature the distinct siblings it excludes, so each parent
+  // can be checked in time linear to its number of children. Beware that only
+  // very simple trees with binary excludes are detected.
+  llvm::DenseSet<std::pair<const Feature *, const Feature *>> SiblingExcludes;
+  llvm::DenseMap<const Feature *, unsigned> ExcludedSiblings;
+  for (const auto *A : FMConstRef) {
+    for (const auto *E : A->excludes()) {
+      const auto *LHS =
+          llvm::dyn_cast<PrimaryFeatureConstraint>(E->getLeftOperand());
+      const auto *RHS =
+          llvm::dyn_cast<PrimaryFeatureConstraint>(E->getRightOperand());
+      if (!LHS || !RHS || !LHS->getFeature() || !RHS->getFeature() ||
+          LHS->getFeature()->getName() != A->getName()) {
+        continue;
+      }
+      const auto *B = FMConstRef.getFeature(RHS->getFeature()->getName());
+      if (B && B != A && B->getParent() == A->getParent() &&
+          SiblingExcludes.insert({A, B}).second) {
+        ++ExcludedSiblings[A];
+      }
+    }
+  }
+
+  auto Transactions = FeatureModelModifyTransaction::openTransaction(FM);
   for (auto *F : FMConstRef) {
     auto Children = F->getChildren<Feature>();
+    // All children exclude each other iff each excludes all its siblings.
     if (Children.size() > 1 &&
-        std::all_of(Children.begin(), Children.end(), [Children](auto *F) {
-          return !F->isOptional() &&
-                 std::all_of(Children.begin(), Children.end(), [F](auto *C) {
-                   return F == C ||
-                          (detectExclude(F, C) && detectExclude(C, F));
-                 });
-        })) {
+        std::all_of(Children.begin(), Children.end(),
+                    [&ExcludedSiblings, &Children](const Feature *C) {
+                      return !C->isOptional() &&
+                             ExcludedSiblings.lookup(C) == Children.size() - 1;
+                    })) {
       Transactions.addRelationship(
           Relationship::RelationshipKind::RK_ALTERNATIVE, F);
     }
@@ -390,13 +619,59 @@ FeatureModelXmlParser::detectXMLAlternatives(FeatureModel &FM) {
   return Transactions.commit();
 }
 
+namespace {
+
+/// Passes every non-empty line written to it on to a callback, e.g., to turn
+/// the output of nested parsers into diagnostics.
+class LineForwardingStream : public llvm::raw_ostream {
+public:
+  explicit LineForwardingStream(
+      llvm::function_ref<void(llvm::StringRef)> Forward)
+      : Forward(Forward) {
+    SetUnbuffered();
+  }
+  ~LineForwardingStream() override {
+    if (!Pending.empty()) {
+      Forward(Pending);
+    }
+  }
+
+private:
+  void write_impl(const char *Ptr, size_t Size) override {
+    Written += Size;
+    llvm::StringRef Rest(Ptr, Size);
+    for (size_t Pos; (Pos = Rest.find('\n')) != llvm::StringRef::npos;
+         Rest = Rest.drop_front(Pos + 1)) {
+      Pending.append(Rest.begin(), Rest.begin() + Pos);
+      if (!Pending.empty()) {
+        Forward(Pending);
+        Pending.clear();
+      }
+    }
+    Pending.append(Rest.begin(), Rest.end());
+  }
+
+  [[nodiscard]] uint64_t current_pos() const override { return Written; }
+
+  llvm::function_ref<void(llvm::StringRef)> Forward;
+  std::string Pending;
+  uint64_t Written = 0;
+};
+
+} // namespace
+
 std::unique_ptr<FeatureModel> FeatureModelXmlParser::buildFeatureModel() {
+  // Constraint, step function, and integer parsing as well as the consistency
+  // checks of the builder print their errors, which become diagnostics here.
+  LineForwardingStream Errors([this](llvm::StringRef Line) { report(Line); });
+  ScopedErrorStream Redirect(Errors);
+
   auto Doc = parseDoc();
   if (!Doc || !parseVm(xmlDocGetRootElement(Doc.get()))) {
     return nullptr;
   }
 
-  auto FM = FMB.buildFeatureModel();
+  auto FM = FMB.buildFeatureModel(Errors);
   if (FM) {
     detectXMLAlternatives(*FM);
   }
@@ -404,41 +679,123 @@ std::unique_ptr<FeatureModel> FeatureModelXmlParser::buildFeatureModel() {
   return FM;
 }
 
-FeatureModelParser::UniqueXmlDtd FeatureModelXmlParser::createDtd() {
-  UniqueXmlDtd Dtd(xmlIOParseDTD(nullptr,
-                                 xmlParserInputBufferCreateMem(
-                                     XmlConstants::DtdRaw.c_str(),
-                                     checkedNarrowingSignConversion(
-                                         XmlConstants::DtdRaw.length()),
-                                     XML_CHAR_ENCODING_UTF8),
-                                 XML_CHAR_ENCODING_UTF8),
-                   xmlFreeDtd);
-  xmlCleanupParser();
+namespace {
+
+/// Parses \p Raw into a DTD and builds the automata of all element content
+/// models up front. Otherwise, libxml2 builds them lazily during the first
+/// validation, which would make validating against a shared DTD racy.
+xmlDtd *compileDtd(const std::string &Raw) {
+  xmlDtd *Dtd = xmlIOParseDTD(
+      nullptr,
+      xmlParserInputBufferCreateMem(Raw.c_str(),
+                                    checkedNarrowingSignConversion(
+                                        Raw.length()),
+                                    XML_CHAR_ENCODING_UTF8),
+      XML_CHAR_ENCODING_UTF8);
   assert(Dtd && "Failed to parse DTD.");
+#ifdef LIBXML_REGEXP_ENABLED
+  if (Dtd && Dtd->elements) {
+    std::unique_ptr<xmlValidCtxt, void (*)(xmlValidCtxtPtr)> VCtxt(
+        xmlNewValidCtxt(), xmlFreeValidCtxt);
+    xmlHashScan(
+        static_cast<xmlHashTablePtr>(Dtd->elements),
+        [](void *Payload, void *Data, const xmlChar * /*Name*/) {
+          xmlValidBuildContentModel(static_cast<xmlValidCtxtPtr>(Data),
+                                    static_cast<xmlElementPtr>(Payload));
+        },
+        VCtxt.get());
+  }
+#endif
+  return Dtd;
+}
+
+/// Redirects the errors of libxml2 on the current thread to \p Diagnostics
+/// while in scope, if set, and restores the previous handler afterwards.
+class DiagnosticCollector {
+public:
+  explicit DiagnosticCollector(FeatureModelDiagnostics *Diagnostics)
+      : Active(Diagnostics), PreviousHandler(xmlStructuredError),
+        PreviousContext(xmlStructuredErrorContext) {
+    if (Active) {
+      xmlSetStructuredErrorFunc(Diagnostics, [](void *Data, auto *E) {
+        static_cast<FeatureModelDiagnostics *>(Data)->push_back(
+            {static_cast<unsigned>(std::max(E->line, 0)),
+             llvm::StringRef(E->message).rtrim().str()});
+      });
+    }
+  }
+  DiagnosticCollector(const DiagnosticCollector &) = delete;
+  DiagnosticCollector &operator=(const DiagnosticCollector &) = delete;
+  ~DiagnosticCollector() {
+    if (Active) {
+      xmlSetStructuredErrorFunc(PreviousContext, PreviousHandler);
+    }
+  }
+
+private:
+  bool Active;
+  xmlStructuredErrorFunc PreviousHandler;
+  void *PreviousContext;
+};
+
+} // namespace
+
+xmlDtd *FeatureModelXmlParser::getDtd() {
+  // Never freed, parsers may still run during static destruction.
+  static xmlDtd *const Dtd = compileDtd(XmlConstants::DtdRaw);
   return Dtd;
 }
 
 FeatureModelParser::UniqueXmlDoc FeatureModelXmlParser::parseDoc() {
   std::unique_ptr<xmlParserCtxt, void (*)(xmlParserCtxtPtr)> Ctxt(
       xmlNewParserCtxt(), xmlFreeParserCtxt);
+  DiagnosticCollector Collector(Diagnostics);
   UniqueXmlDoc Doc(
-      xmlCtxtReadMemory(Ctxt.get(), Xml.c_str(),
-                        checkedNarrowingSignConversion(Xml.length()), nullptr,
-                        nullptr, XML_PARSE_NOBLANKS),
+      xmlCtxtReadMemory(Ctxt.get(), getXml().data(),
+                        checkedNarrowingSignConversion(getXml().size()),
+                        nullptr, nullptr, XML_PARSE_NOBLANKS),
       xmlFreeDoc);
-  xmlCleanupParser();
   if (Doc && Ctxt->valid) {
-    xmlValidateDtd(&Ctxt->vctxt, Doc.get(), createDtd().get());
-    if (Ctxt->vctxt.valid) {
+    if (TrustedInput && hasValidXmlChecksum(getXml())) {
       return Doc;
     }
-    llvm::errs() << "Failed to validate DTD.\n";
+    // A standalone context reports the lines of the offending nodes and,
+    // without handlers of its own, uses the thread wide error handler.
+    std::unique_ptr<xmlValidCtxt, void (*)(xmlValidCtxtPtr)> VCtxt(
+        xmlNewValidCtxt(), xmlFreeValidCtxt);
+    if (xmlValidateDtd(VCtxt.get(), Doc.get(), getDtd())) {
+      return Doc;
+    }
+    report("Failed to validate DTD.");
   } else {
-    llvm::errs() << "Failed to parse / validate XML.\n";
+    report("Failed to parse / validate XML.");
   }
   return {nullptr, nullptr};
 }
 
+void FeatureModelXmlParser::report(const llvm::Twine &Message, unsigned Line) {
+  if (Diagnostics) {
+    Diagnostics->push_back({Line, Message.str()});
+  } else {
+    llvm::errs() << Message << '\n';
+  }
+}
+
+Result<FeatureModelDiagnostics, std::unique_ptr<FeatureModel>>
+FeatureModelXmlParser::buildVerifiedFeatureModel() {
+  FeatureModelDiagnostics Collected;
+  Diagnostics = &Collected;
+  auto FM = buildFeatureModel();
+  Diagnostics = nullptr;
+  if (!FM) {
+    if (Collected.empty()) {
+      Collected.push_back({0, "Could not build feature model."});
+    }
+    return Error(std::move(Collected));
+  }
+  return FM;
+}
+
 Result<FTErrorCode> FeatureModelXmlParser::verifyFeatureModel() {
   if (!parseDoc().get()) {
     return Error(ERROR);
@@ -446,6 +803,368 @@ Result<FTErrorCode> FeatureModelXmlParser::verifyFeatureModel() {
   return Ok();
 }
 
+//===----------------------------------------------------------------------===//
+//                      FeatureModelXmlStreamParser Class
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// \brief SAX callbacks that feed a feature model in XML into a builder.
+class XmlStreamHandler {
+public:
+  explicit XmlStreamHandler(FeatureModelBuilder &FMB) : FMB(FMB) {}
+
+  Result<FTErrorCode> parse(llvm::StringRef Xml);
+
+  /// Reads the file at \p Path chunk by chunk, so at most one chunk of the
+  /// input is resident at a time.
+  Result<FTErrorCode> parseFile(llvm::StringRef Path);
+
+private:
+  /// Size of the chunks passed to libxml2.
+  static constexpr size_t ChunkSize = 64 * 1024;
+
+  /// Feeds the chunks returned by \p NextChunk to libxml2 until it returns
+  /// an empty chunk, or \c std::nullopt if the input could not be read.
+  Result<FTErrorCode> parseChunks(
+      llvm::function_ref<std::optional<llvm::StringRef>()> NextChunk);
+
+  static void onStartElement(void *Ctx, const xmlChar *LocalName,
+                             const xmlChar * /*Prefix*/,
+                             const xmlChar * /*URI*/, int /*NbNamespaces*/,
+                             const xmlChar ** /*Namespaces*/, int NbAttributes,
+                             int /*NbDefaulted*/, const xmlChar **Attributes) {
+    static_cast<XmlStreamHandler *>(Ctx)->startElement(
+        toStringRef(LocalName),
+        llvm::makeArrayRef(Attributes, 5 * NbAttributes));
+  }
+
+  static void onEndElement(void *Ctx, const xmlChar * /*LocalName*/,
+                           const xmlChar * /*Prefix*/,
+                           const xmlChar * /*URI*/) {
+    static_cast<XmlStreamHandler *>(Ctx)->endElement();
+  }
+
+  static void onCharacters(void *Ctx, const xmlChar *Ch, int Len) {
+    auto *Handler = static_cast<XmlStreamHandler *>(Ctx);
+    Handler->Text.append(reinterpret_cast<const char *>(Ch), Len);
+  }
+
+  /// Searches an attribute in the SAX2 attribute array, which stores
+  /// localname, prefix, URI, value, and end of value per attribute.
+  static std::optional<llvm::StringRef>
+  getAttribute(llvm::ArrayRef<const xmlChar *> Attributes,
+               const xmlChar *Name) {
+    for (size_t I = 0; I + 4 < Attributes.size(); I += 5) {
+      if (!xmlStrcmp(Attributes[I], Name)) {
+        return llvm::StringRef(
+            reinterpret_cast<const char *>(Attributes[I + 3]),
+            Attributes[I + 4] - Attributes[I + 3]);
+      }
+    }
+    return std::nullopt;
+  }
+
+  void startElement(llvm::StringRef Name,
+                    llvm::ArrayRef<const xmlChar *> Attributes);
+  void endElement();
+  void fail(const llvm::Twine &Message);
+
+  [[nodiscard]] unsigned line() const {
+    return Ctxt && Ctxt->input ? Ctxt->input->line : 0;
+  }
+
+  FeatureModelBuilder &FMB;
+  xmlParserCtxtPtr Ctxt{nullptr};
+  bool Failed{false};
+  bool SeenVm{false};
+  llvm::SmallVector<XmlElement, 8> Open;
+  /// Text of the innermost open element.
+  std::string Text;
+
+  // State of the current configuration option.
+  XmlOption Option;
+  bool OptionNamed{false};
+
+  // State of the current source range.
+  struct {
+    fs::path Path;
+    std::optional<FeatureSourceRange::FeatureSourceLocation> Start;
+    std::optional<FeatureSourceRange::FeatureSourceLocation> End;
+    FeatureSourceRange::Category Category{
+        FeatureSourceRange::Category::necessary};
+    std::optional<FeatureSourceRange::FeatureMemberOffset> MemberOffset;
+    std::optional<FeatureSourceRange::FeatureRevisionRange> RevisionRange;
+    std::string Introduced;
+    std::string Removed;
+    unsigned Line{0};
+    unsigned Column{0};
+  } Range;
+
+  // Attributes of the current mixed constraint.
+  std::optional<std::string> Req;
+  std::optional<std::string> ExprKind;
+};
+
+Result<FTErrorCode> XmlStreamHandler::parse(llvm::StringRef Xml) {
+  return parseChunks([Xml]() mutable -> std::optional<llvm::StringRef> {
+    auto Chunk = Xml.take_front(ChunkSize);
+    Xml = Xml.drop_front(Chunk.size());
+    return Chunk;
+  });
+}
+
+Result<FTErrorCode> XmlStreamHandler::parseFile(llvm::StringRef Path) {
+  auto File = llvm::sys::fs::openNativeFileForRead(Path);
+  if (!File) {
+    errorStream() << "Failed to open '" << Path
+                  << "': " << llvm::toString(File.takeError()) << '\n';
+    return Error(ERROR);
+  }
+  std::vector<char> Chunk(ChunkSize);
+  auto Result =
+      parseChunks([&File, &Chunk, Path]() -> std::optional<llvm::StringRef> {
+        auto Read = llvm::sys::fs::readNativeFile(
+            *File, llvm::MutableArrayRef<char>(Chunk));
+        if (!Read) {
+          errorStream() << "Failed to read '" << Path
+                        << "': " << llvm::toString(Read.takeError()) << '\n';
+          return std::nullopt;
+        }
+        return llvm::StringRef(Chunk.data(), *Read);
+      });
+  llvm::sys::fs::closeFile(*File);
+  return Result;
+}
+
+Result<FTErrorCode> XmlStreamHandler::parseChunks(
+    llvm::function_ref<std::optional<llvm::StringRef>()> NextChunk) {
+  xmlSAXHandler Handler;
+  memset(&Handler, 0, sizeof(Handler));
+  Handler.initialized = XML_SAX2_MAGIC;
+  Handler.startElementNs = onStartElement;
+  Handler.endElementNs = onEndElement;
+  Handler.characters = onCharacters;
+  Handler.cdataBlock = onCharacters;
+
+  std::unique_ptr<xmlParserCtxt, void (*)(xmlParserCtxtPtr)> Context(
+      xmlCreatePushParserCtxt(&Handler, this, nullptr, 0, nullptr),
+      xmlFreeParserCtxt);
+  if (!Context) {
+    return Error(ERROR);
+  }
+  Ctxt = Context.get();
+
+  bool ReadFailed = false;
+  while (!Failed) {
+    auto Chunk = NextChunk();
+    if (!Chunk) {
+      ReadFailed = true;
+      break;
+    }
+    if (Chunk->empty()) {
+      xmlParseChunk(Ctxt, nullptr, 0, 1);
+      break;
+    }
+    xmlParseChunk(Ctxt, Chunk->data(),
+                  checkedNarrowingSignConversion(Chunk->size()), 0);
+  }
+  bool WellFormed = Ctxt->wellFormed;
+  Ctxt = nullptr;
+
+  if (Failed || ReadFailed) {
+    return Error(ERROR);
+  }
+  if (!WellFormed || !SeenVm) {
+    errorStream() << "Failed to parse / validate XML.\n";
+    return Error(ERROR);
+  }
+  return Ok();
+}
+
+void XmlStreamHandler::fail(const llvm::Twine &Message) {
+  if (!Failed) {
+    errorStream() << Message << '\n';
+    Failed = true;
+  }
+  xmlStopParser(Ctxt);
+}
+
+void XmlStreamHandler::startElement(
+    llvm::StringRef Name, llvm::ArrayRef<const xmlChar *> Attributes) {
+  if (Failed) {
+    return;
+  }
+  XmlElement E = classifyElement(Name);
+  std::optional<XmlElement> Parent;
+  if (!Open.empty()) {
+    Parent = Open.back();
+  }
+  if (!isValidNesting(E, Parent)) {
+    fail(llvm::formatv("Unexpected element '{0}' in line {1}.", Name, line()));
+    return;
+  }
+  // The DTD enforces name to be the first element of a configurationOption.
+  if (Parent == XmlElement::CONFIGURATIONOPTION) {
+    if (!OptionNamed && E != XmlElement::NAME) {
+      fail(llvm::formatv("Expected name of configuration option in line {0}.",
+                         line()));
+      return;
+    }
+    OptionNamed = true;
+  }
+
+  switch (E) {
+  case XmlElement::VM: {
+    auto VmName = getAttribute(Attributes, XmlConstants::NAME);
+    if (!VmName) {
+      fail("Missing name of vm.");
+      return;
+    }
+    SeenVm = true;
+    FMB.setVmName(trim(*VmName));
+    auto Root = getAttribute(Attributes, XmlConstants::ROOT);
+    FMB.setPath(Root ? fs::path(trim(*Root)) : fs::current_path());
+    auto Commit = getAttribute(Attributes, XmlConstants::COMMIT);
+    FMB.setCommit(Commit ? trim(*Commit) : "");
+    break;
+  }
+  case XmlElement::CONFIGURATIONOPTION:
+    Option = XmlOption(Parent == XmlElement::NUMERICOPTIONS);
+    OptionNamed = false;
+    break;
+  case XmlElement::SOURCERANGE: {
+    Range = {};
+    if (auto Category = getAttribute(Attributes, XmlConstants::CATEGORY)) {
+      if (*Category == toStringRef(XmlConstants::INESSENTIAL)) {
+        Range.Category = FeatureSourceRange::Category::inessential;
+      } else if (*Category != toStringRef(XmlConstants::NECESSARY)) {
+        fail(llvm::formatv("Unknown category '{0}' in line {1}.", *Category,
+                           line()));
+        return;
+      }
+    }
+    break;
+  }
+  case XmlElement::START:
+  case XmlElement::END:
+    Range.Line = 0;
+    Range.Column = 0;
+    break;
+  case XmlElement::REVISIONRANGE:
+    Range.Introduced.clear();
+    Range.Removed.clear();
+    break;
+  case XmlElement::CONSTRAINT: {
+    Req.reset();
+    ExprKind.reset();
+    if (auto R = getAttribute(Attributes, XmlConstants::REQ)) {
+      Req = R->str();
+    }
+    if (auto K = getAttribute(Attributes, XmlConstants::EXPRKIND)) {
+      ExprKind = K->str();
+    }
+    break;
+  }
+  default:
+    break;
+  }
+
+  Open.push_back(E);
+  Text.clear();
+}
+
+void XmlStreamHandler::endElement() {
+  if (Failed || Open.empty()) {
+    return;
+  }
+  XmlElement E = Open.pop_back_val();
+  XmlElement Parent = Open.empty() ? XmlElement::UNKNOWN : Open.back();
+
+  switch (E) {
+  case XmlElement::CONFIGURATIONOPTION:
+    Option.build(FMB);
+    break;
+  case XmlElement::CONSTRAINT:
+    if (!addXmlConstraint(FMB, Parent, Text, line(), Req, ExprKind)) {
+      fail(llvm::formatv("Invalid constraint in line {0}.", line()));
+      return;
+    }
+    break;
+  case XmlElement::SOURCERANGE:
+    Option.addSourceRange(FeatureSourceRange(
+        std::move(Range.Path), std::move(Range.Start), std::move(Range.End),
+        Range.Category, std::move(Range.MemberOffset),
+        std::move(Range.RevisionRange)));
+    break;
+  case XmlElement::REVISIONRANGE:
+    if (Range.Removed.empty()) {
+      Range.RevisionRange.emplace(Range.Introduced);
+    } else {
+      Range.RevisionRange.emplace(Range.Introduced, Range.Removed);
+    }
+    break;
+  case XmlElement::INTRODUCED:
+    Range.Introduced = trim(Text);
+    break;
+  case XmlElement::REMOVED:
+    Range.Removed = trim(Text);
+    break;
+  case XmlElement::PATH:
+    Range.Path = fs::path(trim(Text));
+    break;
+  case XmlElement::MEMBEROFFSET:
+    Range.MemberOffset =
+        FeatureSourceRange::FeatureMemberOffset::createFeatureMemberOffset(
+            trim(Text));
+    break;
+  case XmlElement::START:
+    Range.Start.emplace(Range.Line, Range.Column);
+    break;
+  case XmlElement::END:
+    Range.End.emplace(Range.Line, Range.Column);
+    break;
+  case XmlElement::LINE:
+    Range.Line = atoi(Text.c_str());
+    break;
+  case XmlElement::COLUMN:
+    Range.Column = atoi(Text.c_str());
+    break;
+  default:
+    if (auto R = Option.addElement(FMB, E, Parent, Text, line()); !R) {
+      fail(R.getError());
+      return;
+    }
+    break;
+  }
+  Text.clear();
+}
+
+} // namespace
+
+Result<FTErrorCode> FeatureModelXmlStreamParser::parse(FeatureModelBuilder &B) {
+  XmlStreamHandler Handler(B);
+  return Path.empty() ? Handler.parse(getXml()) : Handler.parseFile(Path);
+}
+
+Result<FTErrorCode> FeatureModelXmlStreamParser::verifyFeatureModel() {
+  FeatureModelBuilder Discard;
+  return parse(Discard);
+}
+
+std::unique_ptr<FeatureModel> FeatureModelXmlStreamParser::buildFeatureModel() {
+  if (!parse(FMB)) {
+    return nullptr;
+  }
+
+  auto FM = FMB.buildFeatureModel();
+  if (FM) {
+    FeatureModelXmlParser::detectXMLAlternatives(*FM);
+  }
+
+  return FM;
+}
+
 //===----------------------------------------------------------------------===//
 //                        FeatureModelSxfmParser Class
 //===----------------------------------------------------------------------===//
@@ -458,17 +1177,8 @@ std::unique_ptr<FeatureModel> FeatureModelSxfmParser::buildFeatureModel() {
   return FMB.buildFeatureModel();
 }
 
-FeatureModelSxfmParser::UniqueXmlDtd FeatureModelSxfmParser::createDtd() {
-  UniqueXmlDtd Dtd(xmlIOParseDTD(nullptr,
-                                 xmlParserInputBufferCreateMem(
-                                     SxfmConstants::DtdRaw.c_str(),
-                                     checkedNarrowingSignConversion(
-                                         SxfmConstants::DtdRaw.length()),
-                                     XML_CHAR_ENCODING_UTF8),
-                                 XML_CHAR_ENCODING_UTF8),
-                   xmlFreeDtd);
-  xmlCleanupParser();
-  assert(Dtd && "Failed to parse DTD.");
+xmlDtd *FeatureModelSxfmParser::getDtd() {
+  static xmlDtd *const Dtd = compileDtd(SxfmConstants::DtdRaw);
   return Dtd;
 }
 
@@ -482,14 +1192,13 @@ FeatureModelSxfmParser::UniqueXmlDoc FeatureModelSxfmParser::parseDoc() {
                         checkedNarrowingSignConversion(Sxfm.length()), nullptr,
                         nullptr, XML_PARSE_NOBLANKS),
       xmlFreeDoc);
-  xmlCleanupParser();
 
   // In the following, the document is validated.
   // Therefore, (1) check whether it could be parsed
   if (Doc && Ctxt->valid) {
     // (2) validate the sxfm format by using the dtd (document type definition)
     // file
-    if (xmlValidateDtd(&Ctxt->vctxt, Doc.get(), createDtd().get())) {
+    if (xmlValidateDtd(&Ctxt->vctxt, Doc.get(), getDtd())) {
       // and (3) check the tree-like structure of the embedded feature model
       // as well as constraints
       return Doc;
@@ -540,203 +1249,205 @@ bool FeatureModelSxfmParser::parseVm(xmlNode *Node) {
 }
 
 bool FeatureModelSxfmParser::parseFeatureTree(xmlNode *FeatureTree) {
-  // Split the lines of the feature tree by new lines
-  {
-    std::stringstream Ss(reinterpret_cast<const char *>(
-        UniqueXmlChar(xmlNodeGetContent(FeatureTree), xmlFree).get()));
-    std::string To;
-    std::string Name;
-    bool Opt;
-    bool IsRoot;
-    int LastIndentationLevel = -1;
-    int RootIndentation = -1;
-    int OrGroupCounter = 0;
-    std::unordered_map<int, std::string> IndentationToParentMapping;
-
-    // This map is used for the or group mapping
-    // Each entry represents an or group as a tuple where the first value is
-    // the name of the parent, the second is the relationship kind, and the
-    // third a vector consisting of the name of the children
-    std::unordered_map<int,
-                       std::tuple<std::string, Relationship::RelationshipKind>>
-        OrGroupMapping;
-
-    if (FeatureTree == nullptr) {
-      llvm::errs() << "Failed to read in feature tree. Is it empty?\n";
-      return false;
-    }
-
-    while (std::getline(Ss, To)) {
-      Opt = false;
-      IsRoot = false;
+  if (FeatureTree == nullptr) {
+    llvm::errs() << "Failed to read in feature tree. Is it empty?\n";
+    return false;
+  }
 
-      if (To.empty() || std::all_of(To.begin(), To.end(), isspace)) {
-        continue;
-      }
+  // Scan the feature tree in place if it consists of a single text node, which
+  // is the common case. Otherwise, libxml has to concatenate the content.
+  UniqueXmlChar Content(nullptr, xmlFree);
+  const xmlChar *Raw = nullptr;
+  if (xmlNode *Text = FeatureTree->children;
+      Text && !Text->next &&
+      (Text->type == XML_TEXT_NODE || Text->type == XML_CDATA_SECTION_NODE)) {
+    Raw = Text->content;
+  } else {
+    Content.reset(xmlNodeGetContent(FeatureTree));
+    Raw = Content.get();
+  }
+  llvm::StringRef Remaining(Raw ? reinterpret_cast<const char *>(Raw) : "");
+
+  std::string GroupName;
+  int LastIndentationLevel = -1;
+  int RootIndentation = -1;
+  int OrGroupCounter = 0;
+
+  // The parent of each feature is the last feature seen one indentation level
+  // above, so both stacks are indexed by the indentation level.
+  llvm::SmallVector<std::string, 16> Parents;
+
+  // Each entry represents an open or group at its indentation level as a tuple
+  // where the first value is the name of the parent and the second is the
+  // relationship kind.
+  llvm::SmallVector<
+      std::optional<std::tuple<std::string, Relationship::RelationshipKind>>,
+      16>
+      OrGroups;
+
+  while (!Remaining.empty()) {
+    llvm::StringRef Line;
+    std::tie(Line, Remaining) = Remaining.split('\n');
+    bool Opt = false;
+    bool IsRoot = false;
+
+    if (Line.trim().empty()) {
+      continue;
+    }
 
-      // For every line, count the indentation
-      // not more than 1 additional indentations are allowed to the original one
-      // However, we may have arbitrarily less indentations
-      if ((To.find(':', 0)) == std::string::npos) {
-        llvm::errs() << "Colon is missing in line" << To << "\n";
-        return false;
-      }
+    // For every line, count the indentation
+    // not more than 1 additional indentations are allowed to the original one
+    // However, we may have arbitrarily less indentations
+    size_t ColonPos = Line.find(':');
+    if (ColonPos == llvm::StringRef::npos) {
+      llvm::errs() << "Colon is missing in line" << Line << "\n";
+      return false;
+    }
 
-      llvm::StringRef ToStringRef(To);
-      llvm::StringRef IndentationString =
-          ToStringRef.substr(0, ToStringRef.find(':'));
-      int CurrentIndentationLevel =
-          checkedNarrowingSignConversion(IndentationString.count(Indentation));
-      int Diff = CurrentIndentationLevel - LastIndentationLevel;
+    int CurrentIndentationLevel = checkedNarrowingSignConversion(
+        Line.substr(0, ColonPos).count(Indentation));
+    int Diff = CurrentIndentationLevel - LastIndentationLevel;
 
-      // Remember the root indentation for later checks
-      if (LastIndentationLevel == -1) {
-        RootIndentation = CurrentIndentationLevel;
-      }
+    // Remember the root indentation for later checks
+    if (LastIndentationLevel == -1) {
+      RootIndentation = CurrentIndentationLevel;
+    }
 
-      if ((LastIndentationLevel != -1) && Diff > 1) {
-        llvm::errs() << "Indentation error in feature tree in line " << To
-                     << "\n";
-        return false;
-      }
+    if ((LastIndentationLevel != -1) && Diff > 1) {
+      llvm::errs() << "Indentation error in feature tree in line " << Line
+                   << "\n";
+      return false;
+    }
 
-      // Move pointer to first character after indentation
-      // The first character has to be a colon followed by the type of
-      // the feature (m for mandatory, o for optional, a for alternative)
-      std::string::size_type Pos =
-          CurrentIndentationLevel * Indentation.length() + 2;
-      std::optional<std::tuple<int, int>> Cardinalities;
-
-      switch (To.at(Pos - 1)) {
-      case 'r':
-        IsRoot = true;
-        break;
-      case 'm':
-        break;
-      case 'o':
-        // Code for optional
-        Opt = true;
-        break;
-      case 'g':
-        // Code for an or group with different cardinalities
-        Opt = false;
-        // Extract the cardinality
-        Cardinalities = extractCardinality(To);
-        if (!Cardinalities.has_value()) {
-          return false;
-        }
-        break;
-      case ' ':
-        // Code for alternative child
-        Pos--;
-        break;
-      default:
-        llvm::errs()
-            << "Wrong indentation or unsupported type of configuration option:'"
-            << To << "'\n";
+    // Move pointer to first character after indentation
+    // The first character has to be a colon followed by the type of
+    // the feature (m for mandatory, o for optional, a for alternative)
+    size_t Pos = CurrentIndentationLevel * Indentation.length() + 2;
+    std::optional<std::tuple<int, int>> Cardinalities;
+
+    switch (Pos - 1 < Line.size() ? Line[Pos - 1] : '\0') {
+    case 'r':
+      IsRoot = true;
+      break;
+    case 'm':
+      break;
+    case 'o':
+      // Code for optional
+      Opt = true;
+      break;
+    case 'g':
+      // Code for an or group with different cardinalities
+      Opt = false;
+      // Extract the cardinality
+      Cardinalities = extractCardinality(Line);
+      if (!Cardinalities.has_value()) {
         return false;
       }
-      // Extract the name
-      Name =
-          ToStringRef.substr(Pos + 1, ToStringRef.find(' ', Pos + 1) - Pos - 1)
-              .str();
-
-      // Remove the cardinality
-      if (Name.find_first_of('[') != std::string::npos) {
-        Name = ToStringRef
-                   .substr(Pos + 1, ToStringRef.find('[', Pos + 1) - Pos - 1)
-                   .str();
-
-        if (Name.empty()) {
-          // In this case, the name could also be after the cardinality.
-          // According to the examples provided by S.P.L.O.T., this is a valid
-          // format.
-          auto Remainder =
-              ToStringRef.substr(Pos + 1, ToStringRef.size() - Pos - 1);
-          auto Tokens = Remainder.split(' ');
-          if (!Tokens.second.empty()) {
-            Name = Tokens.second.str();
-          }
-        }
-      }
+      break;
+    case ' ':
+      // Code for alternative child
+      Pos--;
+      break;
+    default:
+      llvm::errs()
+          << "Wrong indentation or unsupported type of configuration option:'"
+          << Line << "'\n";
+      return false;
+    }
+    // Extract the name
+    llvm::StringRef Name =
+        Line.substr(Pos + 1, Line.find(' ', Pos + 1) - Pos - 1);
 
-      // Note that we ignore the ID and use the name of the feature
-      // as unique identifier.
-      if (Name.find_first_of('(') != std::string::npos) {
-        Name = Name.substr(0, Name.find('(', 0));
-      }
+    // Remove the cardinality
+    if (Name.contains('[')) {
+      Name = Line.substr(Pos + 1, Line.find('[', Pos + 1) - Pos - 1);
 
-      // Search for identifier
-      std::regex Regex(R"(\([a-zA-Z\d_]*\))");
-      std::string CurrentLine = ToStringRef.str();
-      for (std::sregex_iterator Match = std::sregex_iterator(
-               CurrentLine.begin(), CurrentLine.end(), Regex);
-           Match != std::sregex_iterator(); Match++) {
-        std::string Identifier = (*Match).str();
-        Identifier = Identifier.substr(1, Identifier.size() - 2);
-        IdentifierMap[Identifier] = Name;
-        if (Identifier != Name && Name.find(Identifier) != std::string::npos) {
-          llvm::errs() << "Name must not contain ID:'" << Name << "'\n";
-          return false;
+      if (Name.empty()) {
+        // In this case, the name could also be after the cardinality.
+        // According to the examples provided by S.P.L.O.T., this is a valid
+        // format.
+        auto Tokens = Line.substr(Pos + 1).split(' ');
+        if (!Tokens.second.empty()) {
+          Name = Tokens.second;
         }
       }
+    }
 
-      // If there is no name, provide an artificial one
-      if (Name.empty()) {
-        OrGroupCounter++;
-        Name = "group_" + std::to_string(OrGroupCounter);
-      }
+    // Note that we ignore the ID and use the name of the feature
+    // as unique identifier.
+    Name = Name.take_until([](char C) { return C == '('; });
 
-      // Create the feature
-      if (IsRoot) {
-        FMB.makeRoot(Name);
-      } else {
-        FMB.makeFeature<BinaryFeature>(Name, Opt);
+    // Search for identifiers, i.e., parenthesized runs of word characters
+    for (size_t Open = Line.find('('); Open != llvm::StringRef::npos;
+         Open = Line.find('(', Open + 1)) {
+      size_t Close = Line.find_if_not(
+          [](char C) { return llvm::isAlnum(C) || C == '_'; }, Open + 1);
+      if (Close == llvm::StringRef::npos || Line[Close] != ')') {
+        continue;
       }
-      IndentationToParentMapping[CurrentIndentationLevel] = Name;
-
-      // Add parent from the upper indentation level if there is one
-      if (LastIndentationLevel != -1 &&
-          CurrentIndentationLevel == RootIndentation) {
-        llvm::errs() << "Only one feature can be root and have the same "
-                        "indentation as root.\n";
+      llvm::StringRef Identifier = Line.slice(Open + 1, Close);
+      IdentifierMap[Identifier.str()] = Name.str();
+      if (Identifier != Name && Name.contains(Identifier)) {
+        llvm::errs() << "Name must not contain ID:'" << Name << "'\n";
         return false;
       }
+      Open = Close;
+    }
 
-      if (LastIndentationLevel != -1) {
-        auto Parent =
-            IndentationToParentMapping.find(CurrentIndentationLevel - 1);
-        assert(Parent != IndentationToParentMapping.end());
-        FMB.addEdge(Parent->second, Name);
-      }
+    // If there is no name, provide an artificial one
+    if (Name.empty()) {
+      GroupName = "group_" + std::to_string(++OrGroupCounter);
+      Name = GroupName;
+    }
 
-      // Add the or group to the feature model if it is completely parsed
-      auto OrGroup = OrGroupMapping.find(CurrentIndentationLevel);
-      if (OrGroup != OrGroupMapping.end()) {
-        FMB.emplaceRelationship(std::get<1>(OrGroup->second),
-                                std::get<0>(OrGroup->second));
-        OrGroupMapping.erase(CurrentIndentationLevel);
-      }
+    // Create the feature
+    if (IsRoot) {
+      FMB.makeRoot(Name.str());
+    } else {
+      FMB.makeFeature<BinaryFeature>(Name.str(), Opt);
+    }
+    if (Parents.size() <= static_cast<size_t>(CurrentIndentationLevel)) {
+      Parents.resize(CurrentIndentationLevel + 1);
+      OrGroups.resize(CurrentIndentationLevel + 1);
+    }
+    Parents[CurrentIndentationLevel] = Name.str();
 
-      // Remember the new or group parent if there is one
-      if (Cardinalities.has_value()) {
-        Relationship::RelationshipKind GroupKind =
-            Relationship::RelationshipKind::RK_ALTERNATIVE;
-        if (std::get<1>(Cardinalities.value()) == SxfmConstants::WILDCARD) {
-          GroupKind = Relationship::RelationshipKind::RK_OR;
-        }
-        OrGroupMapping[CurrentIndentationLevel] =
-            std::tuple<std::string, Relationship::RelationshipKind>(Name,
-                                                                    GroupKind);
-      }
+    // Add parent from the upper indentation level if there is one
+    if (LastIndentationLevel != -1 &&
+        CurrentIndentationLevel == RootIndentation) {
+      llvm::errs() << "Only one feature can be root and have the same "
+                      "indentation as root.\n";
+      return false;
+    }
+
+    if (LastIndentationLevel != -1) {
+      assert(CurrentIndentationLevel > 0);
+      FMB.addEdge(Parents[CurrentIndentationLevel - 1], Name.str());
+    }
+
+    // Add the or group to the feature model if it is completely parsed
+    if (auto &OrGroup = OrGroups[CurrentIndentationLevel]) {
+      FMB.emplaceRelationship(std::get<1>(*OrGroup), std::get<0>(*OrGroup));
+      OrGroup.reset();
+    }
 
-      LastIndentationLevel = CurrentIndentationLevel;
+    // Remember the new or group parent if there is one
+    if (Cardinalities.has_value()) {
+      Relationship::RelationshipKind GroupKind =
+          Relationship::RelationshipKind::RK_ALTERNATIVE;
+      if (std::get<1>(Cardinalities.value()) == SxfmConstants::WILDCARD) {
+        GroupKind = Relationship::RelationshipKind::RK_OR;
+      }
+      OrGroups[CurrentIndentationLevel] = {Name.str(), GroupKind};
     }
 
-    // Add the remaining or groups
-    for (auto &OrGroup : OrGroupMapping) {
-      FMB.emplaceRelationship(std::get<1>(OrGroup.second),
-                              std::get<0>(OrGroup.second));
+    LastIndentationLevel = CurrentIndentationLevel;
+  }
+
+  // Add the remaining or groups
+  for (auto &OrGroup : OrGroups) {
+    if (OrGroup) {
+      FMB.emplaceRelationship(std::get<1>(*OrGroup), std::get<0>(*OrGroup));
     }
   }
 
@@ -754,13 +1465,6 @@ bool FeatureModelSxfmParser::parseConstraints(xmlNode *Constraints) {
       UniqueXmlChar(xmlNodeGetContent(Constraints), xmlFree).get()));
   std::string To;
 
-  // Prepare the identifiers for later replacement
-  std::vector<std::string> Keys;
-  Keys.reserve(IdentifierMap.size());
-  std::for_each(IdentifierMap.begin(), IdentifierMap.end(),
-                [&Keys](const auto &Entry) { Keys.push_back(Entry.first); });
-  std::sort(Keys.begin(), Keys.end(), std::greater<std::string>{});
-
   while (std::getline(Ss, To)) {
     // Ignore if a line is empty
     if (To.empty() || std::all_of(To.begin(), To.end(), isspace)) {
@@ -780,20 +1484,25 @@ bool FeatureModelSxfmParser::parseConstraints(xmlNode *Constraints) {
 
     auto Pos = ToStringRef.find(':');
     ToStringRef = ToStringRef.substr(Pos + 1, ToStringRef.size() - Pos - 1);
-    std::string CnfFormula = trim(ToStringRef);
+    llvm::StringRef Formula = ToStringRef.trim();
 
     // In the following lines, we replace all identifiers by the real feature
-    // name
-    for (auto &Key : Keys) {
-      std::string Value = IdentifierMap[Key];
-      if (Value == Key) {
+    // name. Identifiers are looked up token by token, which keeps this linear
+    // in the length of the constraint instead of the number of identifiers.
+    std::string CnfFormula;
+    CnfFormula.reserve(Formula.size());
+    auto IsIdentifierChar = [](char C) { return llvm::isAlnum(C) || C == '_'; };
+    while (!Formula.empty()) {
+      llvm::StringRef Token = Formula.take_while(IsIdentifierChar);
+      if (Token.empty()) {
+        CnfFormula += Formula.front();
+        Formula = Formula.drop_front();
         continue;
       }
-      auto FoundPos = CnfFormula.find(Key);
-      while (FoundPos != std::string::npos) {
-        CnfFormula = CnfFormula.replace(FoundPos, Key.length(), Value);
-        FoundPos = CnfFormula.find(Key);
-      }
+      auto Identifier = IdentifierMap.find(Token.str());
+      CnfFormula +=
+          Identifier != IdentifierMap.end() ? Identifier->second : Token.str();
+      Formula = Formula.drop_front(Token.size());
     }
 
     // Replace 'or' by '|' and 'and' by '&'
@@ -809,7 +1518,10 @@ bool FeatureModelSxfmParser::parseConstraints(xmlNode *Constraints) {
       }
     }
 
-    if (auto Constraint = ConstraintParser(CnfFormula).buildConstraint()) {
+    if (auto Constraint = ConstraintParser(CnfFormula)
+                              .buildConstraint([this](llvm::StringRef Name) {
+                                return FMB.getFeature(Name);
+                              })) {
       FMB.addConstraint(std::make_unique<FeatureModel::BooleanConstraint>(
           std::move(Constraint)));
     }
@@ -878,4 +1590,332 @@ FeatureModelSxfmParser::parseCardinality(llvm::StringRef CardinalityString) {
   return Result;
 }
 
+//===----------------------------------------------------------------------===//
+//                        FeatureModelBinaryParser Class
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// Interprets the next \p Count records at \p Cursor and moves past them.
+template <typename RecordTy>
+llvm::ArrayRef<RecordTy> takeRecords(const char *&Cursor, uint32_t Count) {
+  llvm::ArrayRef<RecordTy> Records(reinterpret_cast<const RecordTy *>(Cursor),
+                                   Count);
+  Cursor += sizeof(RecordTy) * Count;
+  return Records;
+}
+
+} // namespace
+
+bool FeatureModelBinaryParser::isBinaryFeatureModel(llvm::StringRef Data) {
+  return Data.startswith(
+      llvm::StringRef(binary::Magic, sizeof(binary::Magic)));
+}
+
+void FeatureModelBinaryParser::report(const llvm::Twine &Message) {
+  if (Diagnostics) {
+    Diagnostics->push_back({0, Message.str()});
+  } else {
+    llvm::errs() << Message << '\n';
+  }
+}
+
+Result<FTErrorCode> FeatureModelBinaryParser::verifyFeatureModel() {
+  if (!buildFeatureModel()) {
+    return Error(ERROR);
+  }
+  return Ok();
+}
+
+Result<FeatureModelDiagnostics, std::unique_ptr<FeatureModel>>
+FeatureModelBinaryParser::buildVerifiedFeatureModel() {
+  FeatureModelDiagnostics Collected;
+  Diagnostics = &Collected;
+  auto FM = buildFeatureModel();
+  Diagnostics = nullptr;
+  if (!FM) {
+    if (Collected.empty()) {
+      Collected.push_back({0, "Could not build feature model."});
+    }
+    return Error(std::move(Collected));
+  }
+  return FM;
+}
+
+std::unique_ptr<FeatureModel> FeatureModelBinaryParser::buildFeatureModel() {
+  auto Fail = [this](const llvm::Twine &Message) {
+    report("Invalid binary feature model: " + Message);
+    return nullptr;
+  };
+
+  llvm::StringRef Input = getData();
+  if (Input.size() < sizeof(binary::FileHeader) ||
+      !isBinaryFeatureModel(Input)) {
+    return Fail("missing header.");
+  }
+  const auto &Header =
+      *reinterpret_cast<const binary::FileHeader *>(Input.data());
+  if (Header.Version != binary::Version) {
+    return Fail(llvm::formatv("version {0} is not supported, expected {1}.",
+                              uint32_t(Header.Version), binary::Version));
+  }
+
+  // All counts are 32 bit, so the expected size cannot overflow.
+  uint64_t Size = sizeof(binary::FileHeader) +
+                  sizeof(binary::FeatureRecord) * Header.NumFeatures +
+                  sizeof(binary::LocationRecord) * Header.NumLocations +
+                  sizeof(binary::little64_t) * Header.NumValues +
+                  sizeof(binary::ConstraintRecord) * Header.NumConstraints +
+                  sizeof(binary::ConstraintNode) * Header.NumConstraintNodes +
+                  Header.StringTableSize;
+  if (Size != Input.size()) {
+    return Fail("size does not match header.");
+  }
+
+  const char *Cursor = Input.data() + sizeof(binary::FileHeader);
+  auto Features =
+      takeRecords<binary::FeatureRecord>(Cursor, Header.NumFeatures);
+  auto Locations =
+      takeRecords<binary::LocationRecord>(Cursor, Header.NumLocations);
+  auto Values = takeRecords<binary::little64_t>(Cursor, Header.NumValues);
+  auto Constraints =
+      takeRecords<binary::ConstraintRecord>(Cursor, Header.NumConstraints);
+  auto Nodes =
+      takeRecords<binary::ConstraintNode>(Cursor, Header.NumConstraintNodes);
+  llvm::StringRef Strings(Cursor, Header.StringTableSize);
+
+  bool ValidStrings = true;
+  auto GetString = [&Strings, &ValidStrings](const binary::StringRecord &R) {
+    if (uint64_t(R.Offset) + R.Size > Strings.size()) {
+      ValidStrings = false;
+      return llvm::StringRef();
+    }
+    return Strings.substr(R.Offset, R.Size);
+  };
+
+  auto FM = std::make_unique<FeatureModel>(
+      GetString(Header.Name).str(), nullptr, GetString(Header.Path).str(),
+      GetString(Header.Commit).str());
+
+  //===--------------------------------------------------------------------===//
+  // Features
+
+  if (Features.empty()) {
+    return Fail("missing root feature.");
+  }
+  std::vector<Feature *> Decoded(Features.size());
+  // Children of a feature are attached to its relationship, if it has one.
+  std::vector<FeatureTreeNode *> ChildParents(Features.size());
+  size_t NextLocation = 0;
+  size_t NextValue = 0;
+  for (size_t I = 0; I < Features.size(); ++I) {
+    const auto &R = Features[I];
+    if (R.NumLocations > Locations.size() - NextLocation ||
+        R.NumValues > Values.size() - NextValue) {
+      return Fail("feature refers to missing records.");
+    }
+    std::string Name = GetString(R.Name).str();
+
+    std::unique_ptr<Feature> F;
+    switch (static_cast<Feature::FeatureKind>(R.Kind)) {
+    case Feature::FeatureKind::FK_ROOT:
+      F = std::make_unique<RootFeature>(std::move(Name));
+      break;
+    case Feature::FeatureKind::FK_BINARY:
+      F = std::make_unique<BinaryFeature>(std::move(Name));
+      break;
+    case Feature::FeatureKind::FK_UNKNOWN:
+      F = std::make_unique<Feature>(std::move(Name));
+      break;
+    case Feature::FeatureKind::FK_NUMERIC: {
+      NumericFeature::ValuesVariantType NumericValues;
+      auto Slice = Values.slice(NextValue, R.NumValues);
+      if (R.Values == binary::VK_RANGE && R.NumValues == 2) {
+        NumericValues =
+            NumericFeature::ValueRangeType(Slice.front(), Slice.back());
+      } else if (R.Values == binary::VK_LIST) {
+        NumericValues =
+            NumericFeature::ValueListType(Slice.begin(), Slice.end());
+      } else {
+        return Fail("numeric feature without values.");
+      }
+      NextValue += R.NumValues;
+
+      std::unique_ptr<StepFunction> Step;
+      if (R.Step > binary::SK_EXPONENTIATION) {
+        return Fail("unknown step function.");
+      }
+      if (R.Step != binary::SK_NONE) {
+        StepFunction::OperandVariantType Variable(
+            GetString(R.StepVariable).str());
+        StepFunction::OperandVariantType Constant(
+            llvm::BitsToDouble(R.StepConstant));
+        auto Op = static_cast<StepFunction::StepOperation>(R.Step - 1);
+        Step = R.StepVariableFirst
+                   ? std::make_unique<StepFunction>(Variable, Op, Constant)
+                   : std::make_unique<StepFunction>(Constant, Op, Variable);
+      }
+      F = std::make_unique<NumericFeature>(std::move(Name), NumericValues,
+                                           false,
+                                           std::vector<FeatureSourceRange>(),
+                                           "", std::move(Step));
+      break;
+    }
+    default:
+      return Fail("unknown feature kind.");
+    }
+    if (!llvm::isa<NumericFeature>(*F) &&
+        (R.Values != binary::VK_NONE || R.NumValues || R.Step)) {
+      return Fail("values of non-numeric feature '" + F->getName() + "'.");
+    }
+
+    F->Opt = R.Flags & binary::FF_OPTIONAL;
+    F->OutputString = GetString(R.OutputString).str();
+    F->Locations.reserve(R.NumLocations);
+    for (const auto &L : Locations.slice(NextLocation, R.NumLocations)) {
+      std::optional<FeatureSourceRange::FeatureSourceLocation> Start;
+      std::optional<FeatureSourceRange::FeatureSourceLocation> End;
+      std::optional<FeatureSourceRange::FeatureMemberOffset> MemberOffset;
+      std::optional<FeatureSourceRange::FeatureRevisionRange> Revisions;
+      if (L.Flags & binary::LF_START) {
+        Start.emplace(L.StartLine, L.StartColumn);
+      }
+      if (L.Flags & binary::LF_END) {
+        End.emplace(L.EndLine, L.EndColumn);
+      }
+      if (L.Flags & binary::LF_MEMBER_OFFSET) {
+        MemberOffset =
+            FeatureSourceRange::FeatureMemberOffset::createFeatureMemberOffset(
+                GetString(L.MemberOffset));
+        if (!MemberOffset) {
+          return Fail("malformed member offset.");
+        }
+      }
+      if (L.Flags & binary::LF_REVISION_RANGE) {
+        Revisions =
+            L.Flags & binary::LF_REMOVING_COMMIT
+                ? FeatureSourceRange::FeatureRevisionRange(
+                      GetString(L.Introduced).str(), GetString(L.Removed).str())
+                : FeatureSourceRange::FeatureRevisionRange(
+                      GetString(L.Introduced).str());
+      }
+      if (L.Category > static_cast<uint8_t>(
+                           FeatureSourceRange::Category::inessential)) {
+        return Fail("unknown location category.");
+      }
+      F->Locations.emplace_back(
+          GetString(L.Path).str(), std::move(Start), std::move(End),
+          static_cast<FeatureSourceRange::Category>(L.Category),
+          std::move(MemberOffset), std::move(Revisions));
+    }
+    NextLocation += R.NumLocations;
+
+    // Link the feature into the tree, parents are always decoded first.
+    Feature *Inserted = FM->addFeature(std::move(F));
+    if (!Inserted) {
+      return Fail("duplicate feature '" + GetString(R.Name) + "'.");
+    }
+    if (I == 0) {
+      if (R.Parent != binary::NoIndex || !llvm::isa<RootFeature>(Inserted)) {
+        return Fail("first feature is not the root.");
+      }
+      FM->Root = llvm::cast<RootFeature>(Inserted);
+    } else {
+      if (R.Parent >= I || llvm::isa<RootFeature>(Inserted)) {
+        return Fail("feature '" + Inserted->getName() +
+                    "' is not below the root.");
+      }
+      FeatureTreeNode *P = ChildParents[R.Parent];
+      Inserted->Parent = P;
+      P->Children.push_back(Inserted);
+    }
+
+    ChildParents[I] = Inserted;
+    if (R.Group > binary::GK_OR) {
+      return Fail("unknown relationship kind.");
+    }
+    if (R.Group != binary::GK_NONE) {
+      auto *Group = FM->addRelationship(std::make_unique<Relationship>(
+          R.Group == binary::GK_OR
+              ? Relationship::RelationshipKind::RK_OR
+              : Relationship::RelationshipKind::RK_ALTERNATIVE));
+      Group->Parent = Inserted;
+      Inserted->Children.push_back(Group);
+      ChildParents[I] = Group;
+    }
+    Decoded[I] = Inserted;
+  }
+  if (NextLocation != Locations.size() || NextValue != Values.size()) {
+    return Fail("unreferenced location or value records.");
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Constraints
+
+  size_t NextNode = 0;
+  llvm::SmallVector<PrimaryFeatureConstraint *, 16> Leaves;
+  for (const auto &C : Constraints) {
+    if (C.NumNodes > Nodes.size() - NextNode) {
+      return Fail("constraint refers to missing nodes.");
+    }
+    FlatConstraint Flat;
+    for (const auto &N : Nodes.slice(NextNode, C.NumNodes)) {
+      auto Kind = static_cast<Constraint::ConstraintKind>(uint32_t(N.Kind));
+      if (Kind == Constraint::ConstraintKind::CK_FEATURE) {
+        if (N.Operand < 0 || N.Operand >= int64_t(Decoded.size())) {
+          return Fail("constraint refers to unknown feature.");
+        }
+        Flat.pushFeature(Decoded[N.Operand]);
+      } else if (Kind == Constraint::ConstraintKind::CK_INTEGER) {
+        Flat.pushInteger(N.Operand);
+      } else if (!Flat.pushOperator(Kind)) {
+        return Fail("malformed constraint.");
+      }
+    }
+    NextNode += C.NumNodes;
+    if (!Flat.isComplete()) {
+      return Fail("malformed constraint.");
+    }
+    Leaves.clear();
+    auto Root = Flat.toConstraint(&Leaves);
+
+    switch (C.Kind) {
+    case binary::CK_BOOLEAN:
+      FM->addConstraint(std::make_unique<FeatureModel::BooleanConstraint>(
+          std::move(Root)));
+      break;
+    case binary::CK_NON_BOOLEAN:
+      FM->addConstraint(std::make_unique<FeatureModel::NonBooleanConstraint>(
+          std::move(Root)));
+      break;
+    case binary::CK_MIXED:
+      if (C.Req >
+              static_cast<uint8_t>(FeatureModel::MixedConstraint::Req::NONE) ||
+          C.ExprKind > static_cast<uint8_t>(
+                           FeatureModel::MixedConstraint::ExprKind::NEG)) {
+        return Fail("unknown mixed constraint kind.");
+      }
+      FM->addConstraint(std::make_unique<FeatureModel::MixedConstraint>(
+          std::move(Root),
+          static_cast<FeatureModel::MixedConstraint::Req>(C.Req),
+          static_cast<FeatureModel::MixedConstraint::ExprKind>(C.ExprKind)));
+      break;
+    default:
+      return Fail("unknown constraint kind.");
+    }
+    // Features refer to their constraints once the tree is complete.
+    for (auto *Leaf : Leaves) {
+      Leaf->getFeature()->addConstraint(Leaf);
+    }
+  }
+  if (NextNode != Nodes.size()) {
+    return Fail("unreferenced constraint nodes.");
+  }
+
+  if (!ValidStrings) {
+    return Fail("string out of bounds.");
+  }
+  return FM;
+}
+
 } // namespace vara::feature
@@ -1,9 +1,17 @@
 #include "vara/Feature/FeatureModelWriter.h"
 #include "vara/Feature/FeatureModel.h"
+#include "vara/Feature/FlatConstraint.h"
 #include "vara/Feature/OrderedFeatureVector.h"
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringMap.h>
 #include <llvm/Support/Casting.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Support/raw_ostream.h>
 
+#include "BinaryFormat.h"
+#include "XmlChecksum.h"
 #include "XmlConstants.h"
 
 #include "libxml/xmlwriter.h"
@@ -23,6 +31,21 @@ static constexpr xmlChar INDENTATIONSTRING[] = "  ";
 static constexpr char ENCODING[] = "UTF-8";
 
 int FeatureModelXmlWriter::writeFeatureModel(std::string Path) {
+  if (WithChecksum) {
+    // The checksum needs the whole document, so write it to memory first.
+    auto Str = writeFeatureModel();
+    if (!Str) {
+      return -1;
+    }
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Path, EC);
+    if (EC) {
+      return -1;
+    }
+    OS << *Str;
+    return OS.has_error() ? -1 : static_cast<int>(Str->size());
+  }
+
   int RC;
   std::unique_ptr<xmlTextWriter, void (*)(xmlTextWriterPtr)> Writer(
       xmlNewTextWriterFilename(Path.data(), 0), &xmlFreeTextWriter);
@@ -65,6 +88,9 @@ std::optional<std::string> FeatureModelXmlWriter::writeFeatureModel() {
   int Buffersize;
   xmlDocDumpMemoryEnc(*DocPtrPtr, XmlBuffPtr.get(), &Buffersize, ENCODING);
   std::string Str(reinterpret_cast<char *>(*XmlBuffPtr), Buffersize);
+  if (WithChecksum) {
+    Str += createXmlChecksum(Str);
+  }
 
   return Str;
 }
@@ -521,4 +547,279 @@ int FeatureModelXmlWriter::writeSourceRange(xmlTextWriterPtr Writer,
   return RC;
 }
 
+//===----------------------------------------------------------------------===//
+//                         FeatureModelBinaryWriter
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// Collects the records of a feature model in the binary format.
+class BinaryModelEncoder {
+public:
+  explicit BinaryModelEncoder(const FeatureModel &FM) : FM(FM) {}
+
+  bool encode();
+  void emit(llvm::raw_ostream &OS) const;
+
+private:
+  binary::StringRecord addString(llvm::StringRef Str);
+  bool encodeFeature(Feature &F);
+  void encodeLocation(FeatureSourceRange &Location);
+  bool encodeConstraint(Constraint &C, binary::ConstraintKind Kind,
+                        uint8_t Req = 0, uint8_t ExprKind = 0);
+
+  const FeatureModel &FM;
+  binary::StringRecord Name{};
+  binary::StringRecord Path{};
+  binary::StringRecord Commit{};
+  llvm::DenseMap<const Feature *, uint32_t> Indices;
+  /// Equal strings, e.g., paths of locations, are stored once.
+  llvm::StringMap<uint32_t> StringOffsets;
+  std::string Strings;
+  std::vector<binary::FeatureRecord> Features;
+  std::vector<binary::LocationRecord> Locations;
+  std::vector<binary::little64_t> Values;
+  std::vector<binary::ConstraintRecord> Constraints;
+  std::vector<binary::ConstraintNode> Nodes;
+};
+
+binary::StringRecord BinaryModelEncoder::addString(llvm::StringRef Str) {
+  auto [Entry, Inserted] = StringOffsets.try_emplace(Str, Strings.size());
+  if (Inserted) {
+    Strings.append(Str.begin(), Str.end());
+  }
+  binary::StringRecord R{};
+  R.Offset = Entry->getValue();
+  R.Size = Str.size();
+  return R;
+}
+
+bool BinaryModelEncoder::encode() {
+  Name = addString(FM.getName());
+  Path = addString(FM.getPath().string());
+  Commit = addString(FM.getCommit());
+
+  // Features are stored in pre-order, so parents precede their children.
+  std::vector<Feature *> Ordered(FM.begin(), FM.end());
+  if (Ordered.size() != FM.size()) {
+    llvm::errs() << "Feature model contains features outside of its tree.\n";
+    return false;
+  }
+  Indices.reserve(Ordered.size());
+  for (unsigned I = 0; I < Ordered.size(); ++I) {
+    Indices[Ordered[I]] = I;
+  }
+  for (auto *F : Ordered) {
+    if (!encodeFeature(*F)) {
+      return false;
+    }
+  }
+
+  for (const auto &C : FM.booleanConstraints()) {
+    if (!encodeConstraint(*C->constraint(), binary::CK_BOOLEAN)) {
+      return false;
+    }
+  }
+  for (const auto &C : FM.nonBooleanConstraints()) {
+    if (!encodeConstraint(*C->constraint(), binary::CK_NON_BOOLEAN)) {
+      return false;
+    }
+  }
+  for (const auto &C : FM.mixedConstraints()) {
+    if (!encodeConstraint(*C->constraint(), binary::CK_MIXED,
+                          static_cast<uint8_t>(C->req()),
+                          static_cast<uint8_t>(C->exprKind()))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BinaryModelEncoder::encodeFeature(Feature &F) {
+  binary::FeatureRecord R{};
+  R.Name = addString(F.getName());
+  R.OutputString = addString(F.getOutputString());
+  R.Parent = binary::NoIndex;
+  if (auto *P = F.getParentFeature()) {
+    R.Parent = Indices.lookup(P);
+  }
+  R.Kind = static_cast<uint8_t>(F.getKind());
+  R.Flags = F.isOptional() ? binary::FF_OPTIONAL : 0;
+
+  // A relationship is stored as the group kind of its parent, which requires
+  // it to be the only child.
+  for (auto *Child : F.children()) {
+    auto *Group = llvm::dyn_cast<Relationship>(Child);
+    if (!Group) {
+      continue;
+    }
+    if (llvm::size(F.children()) != 1 ||
+        !llvm::all_of(Group->children(), [](FeatureTreeNode *N) {
+          return llvm::isa<Feature>(N);
+        })) {
+      llvm::errs() << "Relationship of feature '" << F.getName()
+                   << "' cannot be represented in the binary format.\n";
+      return false;
+    }
+    R.Group = Group->getKind() == Relationship::RelationshipKind::RK_OR
+                  ? binary::GK_OR
+                  : binary::GK_ALTERNATIVE;
+  }
+
+  if (auto *NF = llvm::dyn_cast<NumericFeature>(&F)) {
+    auto ValueVariant = NF->getValues();
+    if (auto *Range =
+            std::get_if<NumericFeature::ValueRangeType>(&ValueVariant)) {
+      R.Values = binary::VK_RANGE;
+      Values.emplace_back(Range->first);
+      Values.emplace_back(Range->second);
+      R.NumValues = 2;
+    } else {
+      const auto &List = std::get<NumericFeature::ValueListType>(ValueVariant);
+      R.Values = binary::VK_LIST;
+      Values.insert(Values.end(), List.begin(), List.end());
+      R.NumValues = List.size();
+    }
+
+    if (const auto *Step = NF->getStepFunction()) {
+      bool VariableFirst = std::holds_alternative<std::string>(Step->getLHS());
+      const auto &Variable = VariableFirst ? Step->getLHS() : Step->getRHS();
+      const auto &Constant = VariableFirst ? Step->getRHS() : Step->getLHS();
+      if (!std::holds_alternative<std::string>(Variable) ||
+          !std::holds_alternative<double>(Constant)) {
+        llvm::errs() << "Step function of feature '" << F.getName()
+                     << "' cannot be represented in the binary format.\n";
+        return false;
+      }
+      R.Step = binary::SK_ADDITION + static_cast<uint8_t>(Step->getOperation());
+      R.StepVariableFirst = VariableFirst;
+      R.StepVariable = addString(std::get<std::string>(Variable));
+      R.StepConstant = llvm::DoubleToBits(std::get<double>(Constant));
+    }
+  }
+
+  for (auto &Location : F.getLocations()) {
+    encodeLocation(Location);
+    R.NumLocations = R.NumLocations + 1;
+  }
+
+  Features.push_back(R);
+  return true;
+}
+
+void BinaryModelEncoder::encodeLocation(FeatureSourceRange &Location) {
+  binary::LocationRecord L{};
+  L.Path = addString(Location.getPath().string());
+  L.Category = static_cast<uint8_t>(Location.getCategory());
+  if (auto *Start = Location.getStart()) {
+    L.Flags |= binary::LF_START;
+    L.StartLine = Start->getLineNumber();
+    L.StartColumn = Start->getColumnOffset();
+  }
+  if (auto *End = Location.getEnd()) {
+    L.Flags |= binary::LF_END;
+    L.EndLine = End->getLineNumber();
+    L.EndColumn = End->getColumnOffset();
+  }
+  if (auto *MemberOffset = Location.getMemberOffset()) {
+    L.Flags |= binary::LF_MEMBER_OFFSET;
+    L.MemberOffset = addString(MemberOffset->toString());
+  }
+  if (auto *Revisions = Location.revisionRange()) {
+    L.Flags |= binary::LF_REVISION_RANGE;
+    L.Introduced = addString(Revisions->introducingCommit());
+    if (Revisions->hasRemovingCommit()) {
+      L.Flags |= binary::LF_REMOVING_COMMIT;
+      L.Removed = addString(Revisions->removingCommit());
+    }
+  }
+  Locations.push_back(L);
+}
+
+bool BinaryModelEncoder::encodeConstraint(Constraint &C,
+                                          binary::ConstraintKind Kind,
+                                          uint8_t Req, uint8_t ExprKind) {
+  auto Flat = FlatConstraint::fromConstraint(C);
+  for (const auto &N : Flat.nodes()) {
+    binary::ConstraintNode Node{};
+    Node.Kind = static_cast<uint32_t>(N.Kind);
+    if (N.Kind == Constraint::ConstraintKind::CK_FEATURE) {
+      auto Index = Indices.find(N.getFeature());
+      if (Index == Indices.end()) {
+        llvm::errs() << "Constraint refers to feature '"
+                     << N.getFeature()->getName()
+                     << "' that is not part of the model.\n";
+        return false;
+      }
+      Node.Operand = Index->second;
+    } else if (N.Kind == Constraint::ConstraintKind::CK_INTEGER) {
+      Node.Operand = N.getValue();
+    }
+    Nodes.push_back(Node);
+  }
+  binary::ConstraintRecord R{};
+  R.Kind = Kind;
+  R.Req = Req;
+  R.ExprKind = ExprKind;
+  R.NumNodes = Flat.size();
+  Constraints.push_back(R);
+  return true;
+}
+
+template <typename RecordTy>
+void writeRecords(llvm::raw_ostream &OS, const std::vector<RecordTy> &Records) {
+  OS.write(reinterpret_cast<const char *>(Records.data()),
+           Records.size() * sizeof(RecordTy));
+}
+
+void BinaryModelEncoder::emit(llvm::raw_ostream &OS) const {
+  binary::FileHeader Header{};
+  std::copy(std::begin(binary::Magic), std::end(binary::Magic), Header.Magic);
+  Header.Version = binary::Version;
+  Header.Name = Name;
+  Header.Path = Path;
+  Header.Commit = Commit;
+  Header.NumFeatures = Features.size();
+  Header.NumLocations = Locations.size();
+  Header.NumValues = Values.size();
+  Header.NumConstraints = Constraints.size();
+  Header.NumConstraintNodes = Nodes.size();
+  Header.StringTableSize = Strings.size();
+
+  OS.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+  writeRecords(OS, Features);
+  writeRecords(OS, Locations);
+  writeRecords(OS, Values);
+  writeRecords(OS, Constraints);
+  writeRecords(OS, Nodes);
+  OS << Strings;
+}
+
+} // namespace
+
+int FeatureModelBinaryWriter::writeFeatureModel(std::string Path) {
+  auto Data = writeFeatureModel();
+  if (!Data) {
+    return -1;
+  }
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC);
+  if (EC) {
+    return -1;
+  }
+  OS << *Data;
+  return OS.has_error() ? -1 : static_cast<int>(Data->size());
+}
+
+std::optional<std::string> FeatureModelBinaryWriter::writeFeatureModel() {
+  BinaryModelEncoder Encoder(FM);
+  if (!Encoder.encode()) {
+    return std::nullopt;
+  }
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  Encoder.emit(OS);
+  return std::move(OS.str());
+}
+
 } // namespace vara::feature
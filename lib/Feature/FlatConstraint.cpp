@@ -0,0 +1,300 @@
+#include "vara/Feature/FlatConstraint.h"
+#include "vara/Feature/Feature.h"
+
+#include "llvm/Support/ErrorHandling.h"
+
+#include <functional>
+
+namespace vara::feature {
+
+namespace {
+
+using ConstraintStack = llvm::SmallVectorImpl<std::unique_ptr<Constraint>>;
+
+template <typename ConstraintTy>
+void combineOperands(ConstraintStack &Stack) {
+  if constexpr (std::is_base_of_v<UnaryConstraint, ConstraintTy>) {
+    auto Operand = Stack.pop_back_val();
+    Stack.push_back(std::make_unique<ConstraintTy>(std::move(Operand)));
+  } else {
+    auto RightOperand = Stack.pop_back_val();
+    auto LeftOperand = Stack.pop_back_val();
+    Stack.push_back(std::make_unique<ConstraintTy>(std::move(LeftOperand),
+                                                   std::move(RightOperand)));
+  }
+}
+
+/// Replaces the operands on top of \p Stack by an operator node of \p Kind.
+void combineOperands(Constraint::ConstraintKind Kind, ConstraintStack &Stack) {
+  switch (Kind) {
+  case Constraint::ConstraintKind::CK_ADDITION:
+    return combineOperands<AdditionConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_AND:
+    return combineOperands<AndConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_DIVISION:
+    return combineOperands<DivisionConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_EQUAL:
+    return combineOperands<EqualConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_EQUIVALENCE:
+    return combineOperands<EquivalenceConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_EXCLUDES:
+    return combineOperands<ExcludesConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_GREATER:
+    return combineOperands<GreaterConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_GREATER_EQUAL:
+    return combineOperands<GreaterEqualConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_IMPLIES:
+    return combineOperands<ImpliesConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_LESS:
+    return combineOperands<LessConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_LESS_EQUAL:
+    return combineOperands<LessEqualConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_MULTIPLICATION:
+    return combineOperands<MultiplicationConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_NEG:
+    return combineOperands<NegConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_NOT:
+    return combineOperands<NotConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_NOT_EQUAL:
+    return combineOperands<NotEqualConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_OR:
+    return combineOperands<OrConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_SUBTRACTION:
+    return combineOperands<SubtractionConstraint>(Stack);
+  case Constraint::ConstraintKind::CK_XOR:
+    return combineOperands<XorConstraint>(Stack);
+  default:
+    llvm_unreachable("Not an operator.");
+  }
+}
+
+/// Appends the nodes of a constraint tree in post-order.
+class ConstraintFlattener : public ConstraintVisitor {
+public:
+  explicit ConstraintFlattener(FlatConstraint &Flat) : Flat(Flat) {}
+
+  bool visit(BinaryConstraint *C) override {
+    return ConstraintVisitor::visit(C) && Flat.pushOperator(C->getKind());
+  }
+
+  bool visit(UnaryConstraint *C) override {
+    return ConstraintVisitor::visit(C) && Flat.pushOperator(C->getKind());
+  }
+
+  bool visit(PrimaryIntegerConstraint *C) override {
+    Flat.pushInteger(C->getValue());
+    return true;
+  }
+
+  bool visit(PrimaryFeatureConstraint *C) override {
+    Flat.pushFeature(C->getFeature());
+    return true;
+  }
+
+private:
+  FlatConstraint &Flat;
+};
+
+/// Arithmetic on the two's complement representation, which wraps around
+/// instead of overflowing.
+template <typename OpTy>
+int64_t wrapping(int64_t LHS, int64_t RHS, OpTy Op) {
+  return static_cast<int64_t>(
+      Op(static_cast<uint64_t>(LHS), static_cast<uint64_t>(RHS)));
+}
+
+} // namespace
+
+FlatConstraint FlatConstraint::fromConstraint(Constraint &C) {
+  FlatConstraint Flat;
+  ConstraintFlattener V(Flat);
+  [[maybe_unused]] bool Flattened = C.accept(V);
+  assert(Flattened && Flat.isComplete() && "Malformed constraint tree.");
+  return Flat;
+}
+
+std::unique_ptr<Constraint> FlatConstraint::toConstraint(
+    llvm::SmallVectorImpl<PrimaryFeatureConstraint *> *Leaves) const {
+  assert(isComplete() && "Cannot rebuild an incomplete constraint.");
+  llvm::SmallVector<std::unique_ptr<Constraint>, 16> Stack;
+  for (const Node &N : Nodes) {
+    switch (N.Kind) {
+    case Constraint::ConstraintKind::CK_FEATURE: {
+      auto Leaf = std::make_unique<PrimaryFeatureConstraint>(N.F);
+      if (Leaves) {
+        Leaves->push_back(Leaf.get());
+      }
+      Stack.push_back(std::move(Leaf));
+      break;
+    }
+    case Constraint::ConstraintKind::CK_INTEGER:
+      Stack.push_back(std::make_unique<PrimaryIntegerConstraint>(N.Value));
+      break;
+    default:
+      combineOperands(N.Kind, Stack);
+    }
+  }
+  return Stack.pop_back_val();
+}
+
+std::optional<unsigned>
+FlatConstraint::getArity(Constraint::ConstraintKind Kind) {
+  switch (Kind) {
+  case Constraint::ConstraintKind::CK_FEATURE:
+  case Constraint::ConstraintKind::CK_INTEGER:
+    return 0;
+  case Constraint::ConstraintKind::CK_NEG:
+  case Constraint::ConstraintKind::CK_NOT:
+    return 1;
+  case Constraint::ConstraintKind::CK_ADDITION:
+  case Constraint::ConstraintKind::CK_AND:
+  case Constraint::ConstraintKind::CK_DIVISION:
+  case Constraint::ConstraintKind::CK_EQUAL:
+  case Constraint::ConstraintKind::CK_EQUIVALENCE:
+  case Constraint::ConstraintKind::CK_EXCLUDES:
+  case Constraint::ConstraintKind::CK_GREATER:
+  case Constraint::ConstraintKind::CK_GREATER_EQUAL:
+  case Constraint::ConstraintKind::CK_IMPLIES:
+  case Constraint::ConstraintKind::CK_LESS:
+  case Constraint::ConstraintKind::CK_LESS_EQUAL:
+  case Constraint::ConstraintKind::CK_MULTIPLICATION:
+  case Constraint::ConstraintKind::CK_NOT_EQUAL:
+  case Constraint::ConstraintKind::CK_OR:
+  case Constraint::ConstraintKind::CK_SUBTRACTION:
+  case Constraint::ConstraintKind::CK_XOR:
+    return 2;
+  case Constraint::ConstraintKind::CK_BINARY:
+  case Constraint::ConstraintKind::CK_PRIMARY:
+  case Constraint::ConstraintKind::CK_UNARY:
+    return std::nullopt;
+  }
+  // Kinds read from untrusted input may be outside of the enumeration.
+  return std::nullopt;
+}
+
+void FlatConstraint::pushFeature(Feature *F) {
+  Node N;
+  N.Kind = Constraint::ConstraintKind::CK_FEATURE;
+  N.F = F;
+  Roots.push_back(Nodes.size());
+  Nodes.push_back(N);
+}
+
+void FlatConstraint::pushInteger(int64_t Value) {
+  Node N;
+  N.Kind = Constraint::ConstraintKind::CK_INTEGER;
+  N.Value = Value;
+  Roots.push_back(Nodes.size());
+  Nodes.push_back(N);
+}
+
+bool FlatConstraint::pushOperator(Constraint::ConstraintKind Kind) {
+  auto Arity = getArity(Kind);
+  if (!Arity || *Arity == 0 || Roots.size() < *Arity) {
+    return false;
+  }
+  Node N;
+  N.Kind = Kind;
+  N.Value = 0;
+  Roots.pop_back();
+  if (*Arity == 2) {
+    N.LeftOperand = Roots.pop_back_val();
+  }
+  Roots.push_back(Nodes.size());
+  Nodes.push_back(N);
+  return true;
+}
+
+void FlatConstraint::remapFeatures(
+    llvm::function_ref<Feature *(Feature *)> Map) {
+  for (Node &N : Nodes) {
+    if (N.Kind == Constraint::ConstraintKind::CK_FEATURE) {
+      N.F = Map(N.F);
+    }
+  }
+}
+
+std::optional<int64_t> FlatConstraint::evaluate(
+    llvm::function_ref<int64_t(const Feature &)> ValueOf) const {
+  assert(isComplete() && "Cannot evaluate an incomplete constraint.");
+  llvm::SmallVector<int64_t, 16> Stack;
+  for (const Node &N : Nodes) {
+    switch (N.Kind) {
+    case Constraint::ConstraintKind::CK_FEATURE:
+      Stack.push_back(ValueOf(*N.F));
+      continue;
+    case Constraint::ConstraintKind::CK_INTEGER:
+      Stack.push_back(N.Value);
+      continue;
+    case Constraint::ConstraintKind::CK_NOT:
+      Stack.back() = Stack.back() == 0;
+      continue;
+    case Constraint::ConstraintKind::CK_NEG:
+      Stack.back() = wrapping(0, Stack.back(), std::minus<>());
+      continue;
+    default:
+      break;
+    }
+
+    int64_t RHS = Stack.pop_back_val();
+    int64_t &LHS = Stack.back();
+    switch (N.Kind) {
+    case Constraint::ConstraintKind::CK_ADDITION:
+      LHS = wrapping(LHS, RHS, std::plus<>());
+      break;
+    case Constraint::ConstraintKind::CK_SUBTRACTION:
+      LHS = wrapping(LHS, RHS, std::minus<>());
+      break;
+    case Constraint::ConstraintKind::CK_MULTIPLICATION:
+      LHS = wrapping(LHS, RHS, std::multiplies<>());
+      break;
+    case Constraint::ConstraintKind::CK_DIVISION:
+      if (RHS == 0 || (LHS == INT64_MIN && RHS == -1)) {
+        return std::nullopt;
+      }
+      LHS /= RHS;
+      break;
+    case Constraint::ConstraintKind::CK_AND:
+      LHS = LHS && RHS;
+      break;
+    case Constraint::ConstraintKind::CK_OR:
+      LHS = LHS || RHS;
+      break;
+    case Constraint::ConstraintKind::CK_XOR:
+      LHS = (LHS != 0) != (RHS != 0);
+      break;
+    case Constraint::ConstraintKind::CK_IMPLIES:
+      LHS = !LHS || RHS;
+      break;
+    case Constraint::ConstraintKind::CK_EXCLUDES:
+      LHS = !(LHS && RHS);
+      break;
+    case Constraint::ConstraintKind::CK_EQUIVALENCE:
+      LHS = (LHS != 0) == (RHS != 0);
+      break;
+    case Constraint::ConstraintKind::CK_EQUAL:
+      LHS = LHS == RHS;
+      break;
+    case Constraint::ConstraintKind::CK_NOT_EQUAL:
+      LHS = LHS != RHS;
+      break;
+    case Constraint::ConstraintKind::CK_LESS:
+      LHS = LHS < RHS;
+      break;
+    case Constraint::ConstraintKind::CK_LESS_EQUAL:
+      LHS = LHS <= RHS;
+      break;
+    case Constraint::ConstraintKind::CK_GREATER:
+      LHS = LHS > RHS;
+      break;
+    case Constraint::ConstraintKind::CK_GREATER_EQUAL:
+      LHS = LHS >= RHS;
+      break;
+    default:
+      llvm_unreachable("Not a binary operator.");
+    }
+  }
+  return Stack.back();
+}
+
+} // namespace vara::feature
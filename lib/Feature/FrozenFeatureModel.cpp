@@ -0,0 +1,97 @@
+#include "vara/Feature/FrozenFeatureModel.h"
+
+#include "llvm/Support/Casting.h"
+
+#include <algorithm>
+
+namespace vara::feature {
+
+//===----------------------------------------------------------------------===//
+//                          FrozenFeatureModel
+//===----------------------------------------------------------------------===//
+
+FrozenFeatureModel::FrozenFeatureModel(std::unique_ptr<FeatureModel> Model)
+    : FM(std::move(Model)) {
+  assert(FM && "Cannot freeze missing feature model.");
+
+  // Iterating the model populates its lazy caches, so const accesses to the
+  // model remain read only from here on.
+  Features.assign(FM->begin(), FM->end());
+  unsigned N = Features.size();
+  Indices.reserve(N);
+  for (unsigned I = 0; I < N; ++I) {
+    Indices[Features[I]] = I;
+  }
+
+  Parents.assign(N, NoIndex);
+  Depths.assign(N, 0);
+  ParentRelationships.assign(N, nullptr);
+  ChildOffsets.assign(N + 1, 0);
+  for (unsigned I = 0; I < N; ++I) {
+    ParentRelationships[I] =
+        llvm::dyn_cast_or_null<Relationship>(Features[I]->getParent());
+    if (const auto *P = Features[I]->getParentFeature()) {
+      Parents[I] = getIndex(*P);
+    }
+    // Parents precede their children in pre-order.
+    if (Parents[I] != NoIndex) {
+      Depths[I] = Depths[Parents[I]] + 1;
+      ++ChildOffsets[Parents[I] + 1];
+    }
+  }
+  for (unsigned I = 0; I < N; ++I) {
+    ChildOffsets[I + 1] += ChildOffsets[I];
+  }
+
+  // Filling in pre-order keeps the children ordered like the model.
+  Children.resize(ChildOffsets[N]);
+  std::vector<unsigned> Fill(ChildOffsets.begin(), ChildOffsets.end() - 1);
+  for (unsigned I = 0; I < N; ++I) {
+    if (Parents[I] != NoIndex) {
+      Children[Fill[Parents[I]]++] = Features[I];
+    }
+  }
+
+  SubtreeEnds.resize(N);
+  for (unsigned I = N; I-- > 0;) {
+    SubtreeEnds[I] = std::max(SubtreeEnds[I], I + 1);
+    if (Parents[I] != NoIndex) {
+      SubtreeEnds[Parents[I]] =
+          std::max(SubtreeEnds[Parents[I]], SubtreeEnds[I]);
+    }
+  }
+}
+
+const Feature *
+FrozenFeatureModel::getLowestCommonAncestor(const Feature &LHS,
+                                            const Feature &RHS) const {
+  unsigned L = getIndex(LHS);
+  unsigned R = getIndex(RHS);
+  if (L == NoIndex || R == NoIndex) {
+    return nullptr;
+  }
+  while (Depths[L] > Depths[R]) {
+    L = Parents[L];
+  }
+  while (Depths[R] > Depths[L]) {
+    R = Parents[R];
+  }
+  while (L != R) {
+    L = Parents[L];
+    R = Parents[R];
+    if (L == NoIndex || R == NoIndex) {
+      return nullptr;
+    }
+  }
+  return Features[L];
+}
+
+std::shared_ptr<const FrozenFeatureModel>
+freeze(std::unique_ptr<FeatureModel> FM) {
+  if (!FM) {
+    return nullptr;
+  }
+  return std::make_shared<const FrozenFeatureModel>(std::move(FM));
+}
+
+} // namespace vara::feature
@@ -0,0 +1,36 @@
+#ifndef VARA_FEATURE_XMLCHECKSUM_H
+#define VARA_FEATURE_XMLCHECKSUM_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/xxhash.h"
+
+#include <string>
+
+namespace vara::feature {
+
+/// Trailing comment that marks documents written by \a FeatureModelXmlWriter.
+/// The checksum covers all bytes of the document in front of the comment.
+static constexpr char XmlChecksumPrefix[] = "<!-- vara-checksum: ";
+static constexpr char XmlChecksumSuffix[] = " -->\n";
+
+/// Renders the checksum comment for the document \p Xml.
+inline std::string createXmlChecksum(llvm::StringRef Xml) {
+  return llvm::formatv("{0}{1:x-16}{2}", XmlChecksumPrefix, llvm::xxHash64(Xml),
+                       XmlChecksumSuffix)
+      .str();
+}
+
+/// Checks whether \p Xml ends with a checksum comment that matches the rest of
+/// the document, i.e., whether it was written unchanged by our writer.
+inline bool hasValidXmlChecksum(llvm::StringRef Xml) {
+  size_t Pos = Xml.rfind(XmlChecksumPrefix);
+  if (Pos == llvm::StringRef::npos) {
+    return false;
+  }
+  return Xml.substr(Pos) == createXmlChecksum(Xml.substr(0, Pos));
+}
+
+} // namespace vara::feature
+
+#endif // VARA_FEATURE_XMLCHECKSUM_H
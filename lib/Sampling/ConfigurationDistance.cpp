@@ -0,0 +1,246 @@
+#include "vara/Sampling/ConfigurationDistance.h"
+
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace vara::sampling {
+
+unsigned hammingDistance(llvm::ArrayRef<uint64_t> LHS,
+                         llvm::ArrayRef<uint64_t> RHS) {
+  assert(LHS.size() == RHS.size() && "Packed configurations do not match.");
+  unsigned Distance = 0;
+  for (size_t I = 0; I < LHS.size(); ++I) {
+    Distance += llvm::countPopulation(LHS[I] ^ RHS[I]);
+  }
+  return Distance;
+}
+
+double numericDistance(llvm::ArrayRef<double> LHS,
+                       llvm::ArrayRef<double> RHS) {
+  assert(LHS.size() == RHS.size() && "Packed configurations do not match.");
+  double Distance = 0;
+  for (size_t I = 0; I < LHS.size(); ++I) {
+    Distance += std::abs(LHS[I] - RHS[I]);
+  }
+  return Distance;
+}
+
+//===----------------------------------------------------------------------===//
+//                        ConfigurationEncoding Class
+//===----------------------------------------------------------------------===//
+
+ConfigurationEncoding::ConfigurationEncoding(const feature::FeatureModel &FM) {
+  for (const auto *F : FM.features()) {
+    if (llvm::isa<feature::BinaryFeature>(F)) {
+      addBinaryOption(F->getName());
+    } else if (const auto *NF = llvm::dyn_cast<feature::NumericFeature>(F)) {
+      auto Values = NF->getValues();
+      if (const auto *Range =
+              std::get_if<feature::NumericFeature::ValueRangeType>(&Values)) {
+        addNumericOption(F->getName(), Range->first, Range->second);
+      } else {
+        const auto &List =
+            std::get<feature::NumericFeature::ValueListType>(Values);
+        if (List.empty()) {
+          continue;
+        }
+        auto [Min, Max] = std::minmax_element(List.begin(), List.end());
+        addNumericOption(F->getName(), *Min, *Max);
+      }
+    }
+  }
+}
+
+ConfigurationEncoding ConfigurationEncoding::fromConfigurations(
+    llvm::ArrayRef<std::unique_ptr<feature::Configuration>> Configs) {
+  llvm::StringMap<bool> BinaryOptions;
+  llvm::StringMap<std::pair<int64_t, int64_t>> NumericOptions;
+  for (const auto &Config : Configs) {
+    for (const auto &Entry : *Config) {
+      const auto &Option = *Entry.second;
+      if (Option.isBool()) {
+        BinaryOptions.try_emplace(Option.name(), true);
+      } else if (auto Value = Option.intValue()) {
+        auto [Range, Inserted] =
+            NumericOptions.try_emplace(Option.name(), *Value, *Value);
+        if (!Inserted) {
+          Range->second.first = std::min(Range->second.first, *Value);
+          Range->second.second = std::max(Range->second.second, *Value);
+        }
+      }
+    }
+  }
+
+  // StringMap iteration order is unspecified, sort names to get a
+  // deterministic layout.
+  std::vector<llvm::StringRef> Names;
+  for (const auto &Entry : BinaryOptions) {
+    Names.push_back(Entry.first());
+  }
+  for (const auto &Entry : NumericOptions) {
+    Names.push_back(Entry.first());
+  }
+  std::sort(Names.begin(), Names.end());
+
+  ConfigurationEncoding Encoding;
+  for (const auto Name : Names) {
+    // Options holding both booleans and integers are treated as numeric.
+    if (auto Search = NumericOptions.find(Name);
+        Search != NumericOptions.end()) {
+      Encoding.addNumericOption(Name, Search->second.first,
+                                Search->second.second);
+    } else {
+      Encoding.addBinaryOption(Name);
+    }
+  }
+  return Encoding;
+}
+
+void ConfigurationEncoding::addBinaryOption(llvm::StringRef Name) {
+  if (Slots.try_emplace(Name, OptionSlot{false, NumBinary, 0, 1}).second) {
+    ++NumBinary;
+  }
+}
+
+void ConfigurationEncoding::addNumericOption(llvm::StringRef Name, int64_t Min,
+                                             int64_t Max) {
+  assert(Min <= Max && "Invalid numeric range.");
+  if (Slots.try_emplace(Name, OptionSlot{true, NumNumeric, Min, Max}).second) {
+    ++NumNumeric;
+  }
+}
+
+PackedConfiguration
+ConfigurationEncoding::pack(const feature::Configuration &Config) const {
+  PackedConfiguration Packed;
+  Packed.Bits.resize(getNumWords());
+  Packed.Numerics.resize(getNumNumericOptions());
+  pack(Config, Packed.Bits.data(), Packed.Numerics.data());
+  return Packed;
+}
+
+void ConfigurationEncoding::pack(const feature::Configuration &Config,
+                                 uint64_t *Bits, double *Numerics) const {
+  std::fill_n(Bits, getNumWords(), 0);
+  std::fill_n(Numerics, getNumNumericOptions(), 0);
+  for (const auto &Entry : Config) {
+    auto Search = Slots.find(Entry.first());
+    if (Search == Slots.end()) {
+      continue;
+    }
+    const OptionSlot &Slot = Search->second;
+    const auto &Option = *Entry.second;
+    int64_t Value = 0;
+    if (auto BoolValue = Option.boolValue()) {
+      Value = *BoolValue;
+    } else if (auto IntValue = Option.intValue()) {
+      Value = *IntValue;
+    }
+
+    if (Slot.IsNumeric) {
+      Value = std::clamp(Value, Slot.Min, Slot.Max);
+      Numerics[Slot.Index] =
+          Slot.Max == Slot.Min
+              ? 0
+              : static_cast<double>(Value - Slot.Min) / (Slot.Max - Slot.Min);
+    } else if (Value != 0) {
+      Bits[Slot.Index / 64] |= uint64_t(1) << (Slot.Index % 64);
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+//                        NearestNeighbourIndex Class
+//===----------------------------------------------------------------------===//
+
+size_t NearestNeighbourIndex::insert(const feature::Configuration &Config) {
+  Bits.resize(Bits.size() + Encoding.getNumWords());
+  Numerics.resize(Numerics.size() + Encoding.getNumNumericOptions());
+  Encoding.pack(Config, Bits.data() + Size * Encoding.getNumWords(),
+                Numerics.data() + Size * Encoding.getNumNumericOptions());
+  return Size++;
+}
+
+double NearestNeighbourIndex::distance(size_t LHS, size_t RHS) const {
+  assert(LHS < Size && RHS < Size && "Index out of range.");
+  return hammingDistance(bits(LHS), bits(RHS)) +
+         numericDistance(numerics(LHS), numerics(RHS));
+}
+
+std::vector<NearestNeighbourIndex::Neighbour>
+NearestNeighbourIndex::nearest(const feature::Configuration &Config,
+                               size_t K) const {
+  if (K == 0) {
+    return {};
+  }
+  PackedConfiguration Query = Encoding.pack(Config);
+
+  auto Farther = [](const Neighbour &LHS, const Neighbour &RHS) {
+    return LHS.Distance < RHS.Distance;
+  };
+  // Max-heap over the best K candidates, the farthest candidate is on top.
+  std::priority_queue<Neighbour, std::vector<Neighbour>, decltype(Farther)>
+      Best(Farther);
+  for (size_t I = 0; I < Size; ++I) {
+    double Distance = hammingDistance(Query.Bits, bits(I));
+    // Binary options alone already exceed the current bound.
+    if (Best.size() == K && Distance >= Best.top().Distance) {
+      continue;
+    }
+    Distance += numericDistance(Query.Numerics, numerics(I));
+    if (Best.size() < K) {
+      Best.push({I, Distance});
+    } else if (Distance < Best.top().Distance) {
+      Best.pop();
+      Best.push({I, Distance});
+    }
+  }
+
+  std::vector<Neighbour> Neighbours(Best.size());
+  for (auto It = Neighbours.rbegin(); It != Neighbours.rend(); ++It) {
+    *It = Best.top();
+    Best.pop();
+  }
+  return Neighbours;
+}
+
+std::vector<size_t> NearestNeighbourIndex::selectDiverse(size_t N) const {
+  std::vector<size_t> Selected;
+  if (N == 0 || Size == 0) {
+    return Selected;
+  }
+  N = std::min(N, Size);
+  Selected.reserve(N);
+
+  // Distance of every configuration to its closest selected configuration.
+  std::vector<double> MinDistance(Size, std::numeric_limits<double>::max());
+  std::vector<bool> IsSelected(Size, false);
+  size_t Next = 0;
+  while (true) {
+    Selected.push_back(Next);
+    IsSelected[Next] = true;
+    if (Selected.size() == N) {
+      break;
+    }
+    size_t Last = Next;
+    double Farthest = -1;
+    for (size_t I = 0; I < Size; ++I) {
+      if (IsSelected[I]) {
+        continue;
+      }
+      MinDistance[I] = std::min(MinDistance[I], distance(Last, I));
+      if (MinDistance[I] > Farthest) {
+        Farthest = MinDistance[I];
+        Next = I;
+      }
+    }
+  }
+  return Selected;
+}
+
+} // namespace vara::sampling
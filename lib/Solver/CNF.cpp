@@ -0,0 +1,402 @@
+#include "vara/Solver/CNF.h"
+
+#include "vara/Feature/Constraint.h"
+#include "vara/Feature/FlatConstraint.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+
+#include <cstdint>
+#include <optional>
+
+namespace vara::solver {
+
+namespace {
+
+using Literal = CNF::Literal;
+
+/// Requires that at most one of \p Members holds. Small groups are encoded
+/// pairwise, larger ones by a chain of variables Seen_i <-> Seen_i-1 | M_i
+/// that needs only a linear number of clauses.
+void requireAtMostOne(CNF &Formula, llvm::ArrayRef<Literal> Members) {
+  if (Members.size() <= 6) {
+    for (size_t I = 0; I < Members.size(); ++I) {
+      for (size_t J = I + 1; J < Members.size(); ++J) {
+        Formula.addClause({-Members[I], -Members[J]});
+      }
+    }
+    return;
+  }
+
+  Literal Seen = Members.front();
+  for (size_t I = 1; I < Members.size(); ++I) {
+    Formula.addClause({-Seen, -Members[I]});
+    if (I + 1 == Members.size()) {
+      break;
+    }
+    Literal Next = Formula.addVariable();
+    Formula.addClause({-Seen, Next});
+    Formula.addClause({-Members[I], Next});
+    Formula.addClause({-Next, Seen, Members[I]});
+    Seen = Next;
+  }
+}
+
+/// \brief Encodes boolean constraints into clauses of a formula that already
+/// contains a variable for each referenced feature.
+///
+/// Every subformula gets a variable that is equivalent to it, and identical
+/// subformulas share their variable. Constraints are encoded from their flat
+/// form, where the operands of the node at index I are at \a LeftOperand and
+/// I - 1.
+class TseitinEncoder {
+public:
+  using Kind = feature::Constraint::ConstraintKind;
+
+  explicit TseitinEncoder(CNF &Formula) : Formula(Formula) {}
+
+  /// Adds clauses that require \p C to hold. Conjunctions and disjunctions on
+  /// top are encoded directly without introducing variables.
+  bool require(const feature::FlatConstraint &C) {
+    assert(!C.empty());
+    return require(C, C.size() - 1);
+  }
+
+private:
+  enum DefinitionKind { DK_AND, DK_EQUIVALENCE };
+
+  bool require(const feature::FlatConstraint &C, uint32_t I) {
+    if (C[I].Kind == Kind::CK_AND) {
+      return require(C, C[I].LeftOperand) && require(C, I - 1);
+    }
+    llvm::SmallVector<Literal, 8> Clause;
+    if (!collectDisjuncts(C, I, Clause)) {
+      return false;
+    }
+    Formula.addClause(Clause);
+    return true;
+  }
+
+  bool collectDisjuncts(const feature::FlatConstraint &C, uint32_t I,
+                        llvm::SmallVectorImpl<Literal> &Clause) {
+    switch (C[I].Kind) {
+    case Kind::CK_OR:
+      return collectDisjuncts(C, C[I].LeftOperand, Clause) &&
+             collectDisjuncts(C, I - 1, Clause);
+    case Kind::CK_IMPLIES: {
+      auto Premise = encode(C, C[I].LeftOperand);
+      if (!Premise) {
+        return false;
+      }
+      Clause.push_back(-*Premise);
+      return collectDisjuncts(C, I - 1, Clause);
+    }
+    case Kind::CK_EXCLUDES: {
+      auto LHS = encode(C, C[I].LeftOperand);
+      auto RHS = encode(C, I - 1);
+      if (!LHS || !RHS) {
+        return false;
+      }
+      Clause.append({-*LHS, -*RHS});
+      return true;
+    }
+    default:
+      break;
+    }
+    auto L = encode(C, I);
+    if (!L) {
+      return false;
+    }
+    Clause.push_back(*L);
+    return true;
+  }
+
+  /// \returns a literal equivalent to the subformula rooted at \p I or
+  /// \c std::nullopt if it is not boolean
+  std::optional<Literal> encode(const feature::FlatConstraint &C, uint32_t I) {
+    const auto &N = C[I];
+    switch (N.Kind) {
+    case Kind::CK_FEATURE: {
+      auto L = static_cast<Literal>(
+          Formula.getVariable(N.getFeature()->getName()));
+      return L ? std::optional<Literal>(L) : std::nullopt;
+    }
+    case Kind::CK_NOT: {
+      auto Operand = encode(C, I - 1);
+      return Operand ? std::optional<Literal>(-*Operand) : std::nullopt;
+    }
+    case Kind::CK_AND:
+    case Kind::CK_OR:
+    case Kind::CK_IMPLIES:
+    case Kind::CK_EXCLUDES:
+    case Kind::CK_EQUIVALENCE:
+    case Kind::CK_XOR:
+      break;
+    default:
+      return std::nullopt;
+    }
+
+    auto LHS = encode(C, N.LeftOperand);
+    auto RHS = encode(C, I - 1);
+    if (!LHS || !RHS) {
+      return std::nullopt;
+    }
+    switch (N.Kind) {
+    case Kind::CK_AND:
+      return defineAnd(*LHS, *RHS);
+    case Kind::CK_OR:
+      return -defineAnd(-*LHS, -*RHS);
+    case Kind::CK_IMPLIES:
+      return -defineAnd(*LHS, -*RHS);
+    case Kind::CK_EXCLUDES:
+      return -defineAnd(*LHS, *RHS);
+    case Kind::CK_EQUIVALENCE:
+      return defineEquivalence(*LHS, *RHS);
+    default:
+      return -defineEquivalence(*LHS, *RHS);
+    }
+  }
+
+  Literal lookupDefinition(DefinitionKind Kind, Literal A, Literal B,
+                           bool &Inserted) {
+    if (A > B) {
+      std::swap(A, B);
+    }
+    auto [It, New] = Definitions.try_emplace(
+        std::make_pair(static_cast<int>(Kind), std::make_pair(A, B)), 0);
+    if (New) {
+      It->second = static_cast<Literal>(Formula.addVariable());
+    }
+    Inserted = New;
+    return It->second;
+  }
+
+  /// \returns a variable equivalent to A & B
+  Literal defineAnd(Literal A, Literal B) {
+    if (A == B) {
+      return A;
+    }
+    bool Inserted;
+    Literal X = lookupDefinition(DK_AND, A, B, Inserted);
+    if (Inserted) {
+      Formula.addClause({-X, A});
+      Formula.addClause({-X, B});
+      Formula.addClause({X, -A, -B});
+    }
+    return X;
+  }
+
+  /// \returns a variable equivalent to A <-> B
+  Literal defineEquivalence(Literal A, Literal B) {
+    bool Inserted;
+    Literal X = lookupDefinition(DK_EQUIVALENCE, A, B, Inserted);
+    if (Inserted) {
+      Formula.addClause({-X, -A, B});
+      Formula.addClause({-X, A, -B});
+      Formula.addClause({X, A, B});
+      Formula.addClause({X, -A, -B});
+    }
+    return X;
+  }
+
+  CNF &Formula;
+  llvm::DenseMap<std::pair<int, std::pair<Literal, Literal>>, Literal>
+      Definitions;
+};
+
+} // namespace
+
+//===----------------------------------------------------------------------===//
+//                                 CNF Class
+//===----------------------------------------------------------------------===//
+
+unsigned CNF::addVariable(llvm::StringRef Name) {
+  unsigned Variable = Names.size() + 1;
+  if (!Name.empty() && !Variables.try_emplace(Name, Variable).second) {
+    return 0;
+  }
+  Names.push_back(Name.str());
+  return Variable;
+}
+
+void CNF::addClause(llvm::ArrayRef<Literal> Clause) {
+  Literals.insert(Literals.end(), Clause.begin(), Clause.end());
+  ClauseEnds.push_back(Literals.size());
+}
+
+Result<SolverErrorCode, std::unique_ptr<CNF>>
+CNF::compile(const feature::FeatureModel &FM) {
+  auto Formula = std::make_unique<CNF>();
+  for (const auto *F : FM.features()) {
+    switch (F->getKind()) {
+    case feature::Feature::FeatureKind::FK_ROOT:
+    case feature::Feature::FeatureKind::FK_BINARY:
+      Formula->addVariable(F->getName());
+      break;
+    case feature::Feature::FeatureKind::FK_NUMERIC:
+      break;
+    case feature::Feature::FeatureKind::FK_UNKNOWN:
+      return Error(NOT_SUPPORTED);
+    }
+  }
+  auto VariableOf = [&Formula](const feature::FeatureTreeNode *N) {
+    const auto *F = llvm::dyn_cast_or_null<feature::Feature>(N);
+    return F ? static_cast<Literal>(Formula->getVariable(F->getName())) : 0;
+  };
+
+  // Members of groups are constrained by their relationship instead of being
+  // mandatory, see SolverFactory.
+  llvm::DenseSet<const feature::FeatureTreeNode *> GroupMembers;
+  for (const auto &R : FM.relationships()) {
+    for (const auto *Child : R->children()) {
+      GroupMembers.insert(Child);
+    }
+  }
+
+  for (const auto *F : FM.features()) {
+    Literal Variable = VariableOf(F);
+    if (!Variable) {
+      continue;
+    }
+    if (llvm::isa<feature::RootFeature>(F)) {
+      Formula->addClause({Variable});
+      continue;
+    }
+    Literal Parent = VariableOf(F->getParentFeature());
+    if (!Parent) {
+      return Error(PARENT_NOT_PRESENT);
+    }
+    Formula->addClause({-Variable, Parent});
+    if (!F->isOptional() && !GroupMembers.count(F)) {
+      Formula->addClause({-Parent, Variable});
+    }
+  }
+
+  for (const auto &R : FM.relationships()) {
+    Literal Parent = VariableOf(R->getParent());
+    if (!Parent) {
+      return Error(PARENT_NOT_PRESENT);
+    }
+    llvm::SmallVector<Literal, 8> Clause{-Parent};
+    for (const auto *Child : R->children()) {
+      Literal Member = VariableOf(Child);
+      if (!Member) {
+        return Error(NOT_SUPPORTED);
+      }
+      Clause.push_back(Member);
+    }
+    Formula->addClause(Clause);
+    if (R->getKind() ==
+        feature::Relationship::RelationshipKind::RK_ALTERNATIVE) {
+      requireAtMostOne(*Formula, llvm::makeArrayRef(Clause).drop_front());
+    }
+  }
+
+  TseitinEncoder Encoder(*Formula);
+  for (const auto &C : FM.booleanConstraints()) {
+    if (!Encoder.require(
+            feature::FlatConstraint::fromConstraint(*C->constraint()))) {
+      return Error(NOT_SUPPORTED);
+    }
+  }
+  return Formula;
+}
+
+void CNF::writeDimacs(llvm::raw_ostream &OS) const {
+  for (unsigned Variable = 1; Variable <= getNumVariables(); ++Variable) {
+    if (!getName(Variable).empty()) {
+      OS << "c " << Variable << ' ' << getName(Variable) << '\n';
+    }
+  }
+  OS << "p cnf " << getNumVariables() << ' ' << getNumClauses() << '\n';
+  for (size_t I = 0; I < getNumClauses(); ++I) {
+    for (Literal L : getClause(I)) {
+      OS << L << ' ';
+    }
+    OS << "0\n";
+  }
+}
+
+Result<SolverErrorCode, std::unique_ptr<CNF>>
+CNF::parseDimacs(llvm::StringRef Dimacs) {
+  std::vector<std::pair<unsigned long long, llvm::StringRef>> Named;
+  std::optional<std::pair<unsigned long long, unsigned long long>> Problem;
+  auto Formula = std::make_unique<CNF>();
+  llvm::SmallVector<Literal, 16> Clause;
+
+  while (!Dimacs.empty()) {
+    llvm::StringRef Line;
+    std::tie(Line, Dimacs) = Dimacs.split('\n');
+    Line = Line.rtrim("\r");
+    llvm::StringRef Rest = Line.ltrim();
+    if (Rest.empty()) {
+      continue;
+    }
+
+    if (Rest.front() == 'c') {
+      // Variable names, other comments are skipped.
+      Rest = Rest.drop_front().ltrim(' ');
+      unsigned long long Variable;
+      if (!llvm::consumeUnsignedInteger(Rest, 10, Variable) &&
+          Rest.consume_front(" ") && !Rest.empty()) {
+        Named.emplace_back(Variable, Rest);
+      }
+      continue;
+    }
+    if (Rest.front() == '%') {
+      // End marker of the SATLIB benchmarks.
+      break;
+    }
+    if (Rest.front() == 'p') {
+      llvm::SmallVector<llvm::StringRef, 4> Fields;
+      Rest.split(Fields, ' ', -1, /*KeepEmpty=*/false);
+      unsigned long long NumVariables;
+      unsigned long long NumClauses;
+      if (Problem || Fields.size() != 4 || Fields[1] != "cnf" ||
+          llvm::getAsUnsignedInteger(Fields[2], 10, NumVariables) ||
+          llvm::getAsUnsignedInteger(Fields[3], 10, NumClauses) ||
+          NumVariables >= INT32_MAX) {
+        return Error(MALFORMED_INPUT);
+      }
+      Problem.emplace(NumVariables, NumClauses);
+      Formula->Names.resize(NumVariables);
+      continue;
+    }
+    if (!Problem) {
+      return Error(MALFORMED_INPUT);
+    }
+
+    for (Rest = Rest.ltrim(); !Rest.empty(); Rest = Rest.ltrim()) {
+      long long L;
+      auto NumVariables = static_cast<long long>(Problem->first);
+      if (llvm::consumeSignedInteger(Rest, 10, L) || L > NumVariables ||
+          L < -NumVariables) {
+        return Error(MALFORMED_INPUT);
+      }
+      if (L == 0) {
+        Formula->addClause(Clause);
+        Clause.clear();
+      } else {
+        Clause.push_back(static_cast<Literal>(L));
+      }
+    }
+  }
+
+  if (!Problem || !Clause.empty() ||
+      Formula->getNumClauses() != Problem->second) {
+    return Error(MALFORMED_INPUT);
+  }
+  for (auto [Variable, Name] : Named) {
+    if (Variable == 0 || Variable > Problem->first ||
+        !Formula->Names[Variable - 1].empty() ||
+        !Formula->Variables.try_emplace(Name, Variable).second) {
+      return Error(MALFORMED_INPUT);
+    }
+    Formula->Names[Variable - 1] = Name.str();
+  }
+  return Formula;
+}
+
+} // namespace vara::solver
@@ -1,4 +1,5 @@
 #include "vara/Solver/SolverFactory.h"
+#include "vara/Feature/ConstraintSimplifier.h"
 #include "vara/Solver/Z3Solver.h"
 
 namespace vara::solver {
@@ -26,12 +27,18 @@ SolverFactory::applyModelOnSolver(const feature::FeatureModel &Model,
                   std::find(V.begin(), V.end(), F->getName().str()) != V.end());
   }
 
-  // Iterate over all constraints
+  // Iterate over all constraints, constraints that always hold in the model
+  // are left out
+  feature::ConstraintSimplifier Simplifier(&Model);
   for (const auto &C : Model.booleanConstraints()) {
-    S->addConstraint(*C->constraint());
+    if (auto Simplified = Simplifier.simplify(*C->constraint())) {
+      S->addConstraint(*Simplified);
+    }
   }
   for (const auto &C : Model.nonBooleanConstraints()) {
-    S->addConstraint(*C->constraint());
+    if (auto Simplified = Simplifier.simplify(*C->constraint())) {
+      S->addConstraint(*Simplified);
+    }
   }
   for (const auto &C : Model.mixedConstraints()) {
     S->addMixedConstraint(*C->constraint(), C->exprKind(), C->req());
@@ -1,5 +1,6 @@
 #include "vara/Solver/Z3Solver.h"
 
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ErrorHandling.h"
 
 #include "z3++.h"
@@ -146,11 +147,7 @@ Z3Solver::addRelationship(const feature::Relationship &R) {
 Result<SolverErrorCode>
 Z3Solver::addConstraint(feature::Constraint &ConstraintToAdd) {
   Z3SolverConstraintVisitor SCV(this);
-  const bool Succ = SCV.addConstraint(&ConstraintToAdd);
-  if (!Succ) {
-    return SolverErrorCode::NOT_SUPPORTED;
-  }
-  return Ok();
+  return addUniqueConstraint(ConstraintToAdd, 0, SCV, false, true);
 }
 
 Result<SolverErrorCode> Z3Solver::addMixedConstraint(
@@ -158,13 +155,54 @@ Result<SolverErrorCode> Z3Solver::addMixedConstraint(
     feature::FeatureModel::MixedConstraint::ExprKind ExprKind,
     feature::FeatureModel::MixedConstraint::Req Req) {
   Z3SolverConstraintVisitor SCV(this, true);
-  const bool Succ = SCV.addConstraint(
-      &ConstraintToAdd,
-      ExprKind == feature::FeatureModel::MixedConstraint::ExprKind::NEG,
-      Req == feature::FeatureModel::MixedConstraint::Req::ALL);
-  if (!Succ) {
+  const bool NegateExpr =
+      ExprKind == feature::FeatureModel::MixedConstraint::ExprKind::NEG;
+  const bool RequireAll =
+      Req == feature::FeatureModel::MixedConstraint::Req::ALL;
+  // Mixed constraints are encoded differently for each combination of
+  // attributes, plain constraints use variant 0.
+  const unsigned Variant = 1 + unsigned(NegateExpr) + 2 * unsigned(RequireAll);
+  return addUniqueConstraint(ConstraintToAdd, Variant, SCV, NegateExpr,
+                             RequireAll);
+}
+
+Result<SolverErrorCode> Z3Solver::addUniqueConstraint(
+    feature::Constraint &C, unsigned Variant, Z3SolverConstraintVisitor &SCV,
+    bool NegateExpr, bool RequireAll) {
+  auto Flat = feature::FlatConstraint::fromConstraint(C);
+  auto Key = std::make_pair(Constraints.intern(Flat), Variant);
+  if (AddedConstraints.count(Key)) {
+    return Ok();
+  }
+  if (!SCV.addConstraint(Flat, NegateExpr, RequireAll)) {
     return SolverErrorCode::NOT_SUPPORTED;
   }
+  AddedConstraints.insert(Key);
+  return Ok();
+}
+
+Result<SolverErrorCode> Z3Solver::addCNF(const CNF &Formula) {
+  z3::expr_vector Variables(Context);
+  for (unsigned V = 1; V <= Formula.getNumVariables(); ++V) {
+    llvm::StringRef Name = Formula.getName(V);
+    if (Name.empty()) {
+      Variables.push_back(z3::to_expr(
+          Context, Z3_mk_fresh_const(Context, "cnf", Context.bool_sort())));
+      continue;
+    }
+    if (auto R = addFeature(Name.str()); !R) {
+      return R;
+    }
+    Variables.push_back(*OptionToVariableMapping[Name]);
+  }
+
+  for (size_t I = 0; I < Formula.getNumClauses(); ++I) {
+    z3::expr_vector Clause(Context);
+    for (CNF::Literal L : Formula.getClause(I)) {
+      Clause.push_back(L > 0 ? Variables[L - 1] : !Variables[-L - 1]);
+    }
+    Solver->add(z3::mk_or(Clause));
+  }
   return Ok();
 }
 
@@ -251,7 +289,13 @@ Z3Solver::getCurrentConfiguration() {
 bool Z3SolverConstraintVisitor::addConstraint(vara::feature::Constraint *C,
                                               bool NegateExpr,
                                               bool RequireAll) {
-  if (C->accept(*this)) {
+  return addConstraint(feature::FlatConstraint::fromConstraint(*C), NegateExpr,
+                       RequireAll);
+}
+
+bool Z3SolverConstraintVisitor::addConstraint(
+    const feature::FlatConstraint &C, bool NegateExpr, bool RequireAll) {
+  if (encode(C)) {
     if (NegateExpr) {
       Z3ConstraintExpression = !Z3ConstraintExpression;
     }
@@ -266,106 +310,16 @@ bool Z3SolverConstraintVisitor::addConstraint(vara::feature::Constraint *C,
 }
 
 bool Z3SolverConstraintVisitor::visit(vara::feature::BinaryConstraint *C) {
-
-  const bool LHS = C->getLeftOperand()->accept(*this);
-  const z3::expr Left = Z3ConstraintExpression;
-  const bool RHS = C->getRightOperand()->accept(*this);
-  if (!LHS || !RHS) {
-    return false;
-  }
-  switch (C->getKind()) {
-  case feature::Constraint::ConstraintKind::CK_ADDITION:
-    Z3ConstraintExpression = Left + Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_AND:
-    Z3ConstraintExpression = Left && Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_DIVISION:
-    Z3ConstraintExpression = Left / Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_EQUAL:
-    Z3ConstraintExpression = Left == Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_EQUIVALENCE:
-    Z3ConstraintExpression = z3::implies(Left, Z3ConstraintExpression) &&
-                             z3::implies(Z3ConstraintExpression, Left);
-    break;
-  case feature::Constraint::ConstraintKind::CK_EXCLUDES:
-    Z3ConstraintExpression = z3::implies(Left, !Z3ConstraintExpression);
-    break;
-  case feature::Constraint::ConstraintKind::CK_GREATER:
-    Z3ConstraintExpression = Left > Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_GREATER_EQUAL:
-    Z3ConstraintExpression = Left >= Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_IMPLIES:
-    Z3ConstraintExpression = z3::implies(Left, Z3ConstraintExpression);
-    break;
-  case feature::Constraint::ConstraintKind::CK_LESS:
-    Z3ConstraintExpression = Left < Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_LESS_EQUAL:
-    Z3ConstraintExpression = Left <= Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_MULTIPLICATION:
-    Z3ConstraintExpression = Left * Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_NOT_EQUAL:
-    Z3ConstraintExpression = Left != Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_OR:
-    Z3ConstraintExpression = Left || Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_SUBTRACTION:
-    Z3ConstraintExpression = Left - Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_XOR:
-    Z3ConstraintExpression = z3::implies(Left, !Z3ConstraintExpression) &&
-                             z3::implies(Z3ConstraintExpression, !Left);
-    break;
-  default:
-    llvm_unreachable(
-        "Unimplemented binary constraint in Z3SolverConstraintVisitor "
-        "detected!");
-    return false;
-  }
-  return true;
+  return encode(feature::FlatConstraint::fromConstraint(*C));
 }
 
 bool Z3SolverConstraintVisitor::visit(vara::feature::UnaryConstraint *C) {
-  if (!C->getOperand()->accept(*this)) {
-    return false;
-  }
-  switch (C->getKind()) {
-  case feature::Constraint::ConstraintKind::CK_NEG:
-    Z3ConstraintExpression = -Z3ConstraintExpression;
-    break;
-  case feature::Constraint::ConstraintKind::CK_NOT:
-    Z3ConstraintExpression = !Z3ConstraintExpression;
-    break;
-  default:
-    return false;
-  }
-  return true;
+  return encode(feature::FlatConstraint::fromConstraint(*C));
 }
 
 bool Z3SolverConstraintVisitor::visit(
     vara::feature::PrimaryFeatureConstraint *C) {
-  if (C->getFeature()->getKind() ==
-      vara::feature::Feature::FeatureKind::FK_NUMERIC) {
-    Z3ConstraintExpression =
-        S->Context.int_const(C->getFeature()->getName().str().c_str());
-  } else {
-    Z3ConstraintExpression =
-        S->Context.bool_const(C->getFeature()->getName().str().c_str());
-    if (MixedConstraint) {
-      VariableConstraint = VariableConstraint || !Z3ConstraintExpression;
-      Z3ConstraintExpression = z3::to_expr(
-          S->Context, Z3_mk_ite(S->Context, Z3ConstraintExpression,
-                                S->Context.int_val(1), S->Context.int_val(0)));
-    }
-  }
+  Z3ConstraintExpression = encodeFeature(*C->getFeature());
   return true;
 }
 
@@ -375,4 +329,108 @@ bool Z3SolverConstraintVisitor::visit(
   return true;
 }
 
+z3::expr
+Z3SolverConstraintVisitor::encodeFeature(const feature::Feature &F) {
+  if (F.getKind() == vara::feature::Feature::FeatureKind::FK_NUMERIC) {
+    return S->Context.int_const(F.getName().str().c_str());
+  }
+  z3::expr Variable = S->Context.bool_const(F.getName().str().c_str());
+  if (!MixedConstraint) {
+    return Variable;
+  }
+  VariableConstraint = VariableConstraint || !Variable;
+  return z3::to_expr(S->Context,
+                     Z3_mk_ite(S->Context, Variable, S->Context.int_val(1),
+                               S->Context.int_val(0)));
+}
+
+bool Z3SolverConstraintVisitor::encode(const feature::FlatConstraint &C) {
+  using Kind = feature::Constraint::ConstraintKind;
+
+  // Operands precede their operator, so one pass over the nodes with a stack
+  // of the encoded operands builds the expression bottom-up.
+  llvm::SmallVector<z3::expr, 16> Stack;
+  for (const auto &N : C.nodes()) {
+    switch (N.Kind) {
+    case Kind::CK_FEATURE:
+      Stack.push_back(encodeFeature(*N.getFeature()));
+      continue;
+    case Kind::CK_INTEGER:
+      Stack.push_back(S->Context.int_val(N.getValue()));
+      continue;
+    case Kind::CK_NEG:
+      Stack.back() = -Stack.back();
+      continue;
+    case Kind::CK_NOT:
+      Stack.back() = !Stack.back();
+      continue;
+    default:
+      break;
+    }
+
+    const z3::expr Right = Stack.pop_back_val();
+    z3::expr &Left = Stack.back();
+    switch (N.Kind) {
+    case Kind::CK_ADDITION:
+      Left = Left + Right;
+      break;
+    case Kind::CK_AND:
+      Left = Left && Right;
+      break;
+    case Kind::CK_DIVISION:
+      Left = Left / Right;
+      break;
+    case Kind::CK_EQUAL:
+      Left = Left == Right;
+      break;
+    case Kind::CK_EQUIVALENCE:
+      Left = z3::implies(Left, Right) && z3::implies(Right, Left);
+      break;
+    case Kind::CK_EXCLUDES:
+      Left = z3::implies(Left, !Right);
+      break;
+    case Kind::CK_GREATER:
+      Left = Left > Right;
+      break;
+    case Kind::CK_GREATER_EQUAL:
+      Left = Left >= Right;
+      break;
+    case Kind::CK_IMPLIES:
+      Left = z3::implies(Left, Right);
+      break;
+    case Kind::CK_LESS:
+      Left = Left < Right;
+      break;
+    case Kind::CK_LESS_EQUAL:
+      Left = Left <= Right;
+      break;
+    case Kind::CK_MULTIPLICATION:
+      Left = Left * Right;
+      break;
+    case Kind::CK_NOT_EQUAL:
+      Left = Left != Right;
+      break;
+    case Kind::CK_OR:
+      Left = Left || Right;
+      break;
+    case Kind::CK_SUBTRACTION:
+      Left = Left - Right;
+      break;
+    case Kind::CK_XOR:
+      Left = Left ^ Right;
+      break;
+    default:
+      llvm_unreachable(
+          "Unimplemented binary constraint in Z3SolverConstraintVisitor "
+          "detected!");
+      return false;
+    }
+  }
+  if (Stack.size() != 1) {
+    return false;
+  }
+  Z3ConstraintExpression = Stack.back();
+  return true;
+}
+
 } // namespace vara::solver
@@ -60,18 +60,15 @@ int main(int Argc, char **Argv) {
     return 1;
   }
 
-  if (!vara::feature::verifyFeatureModel(FileName.getValue())) {
+  auto Loaded = vara::feature::loadFeatureModel(FileName.getValue(), {});
+  if (!Loaded) {
+    for (const auto &D : Loaded.getError()) {
+      llvm::errs() << FileName << ':' << D << '\n';
+    }
     llvm::errs() << "error: Invalid feature model.\n";
     return 1;
   }
-
-  std::unique_ptr<vara::feature::FeatureModel> FM =
-      vara::feature::loadFeatureModel(FileName.getValue());
-
-  if (!FM) {
-    llvm::errs() << "error: Could not build feature model.\n";
-    return 1;
-  }
+  std::unique_ptr<vara::feature::FeatureModel> FM = Loaded.extractValue();
 
   if (ConfigurationGenerationOption.getValue() ==
           ConfigurationGenerationChoice::SAMPLE_SET &&
@@ -1,7 +1,9 @@
+#include "vara/Feature/ConstraintSimplifier.h"
 #include "vara/Feature/FeatureModel.h"
 
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Errc.h"
+#include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Program.h"
@@ -11,9 +13,10 @@
 static llvm::cl::OptionCategory
     FMViewerCategory("Feature model viewer options");
 
-static llvm::cl::opt<std::string> FileName(llvm::cl::Positional,
-                                           llvm::cl::desc("file"),
-                                           llvm::cl::cat(FMViewerCategory));
+static llvm::cl::list<std::string>
+    FileNames(llvm::cl::Positional,
+              llvm::cl::desc("file, several files are only verified"),
+              llvm::cl::cat(FMViewerCategory));
 
 static llvm::cl::opt<bool> Xml("xml",
                                llvm::cl::desc("Use XML format (default)."),
@@ -39,6 +42,102 @@ static llvm::cl::opt<bool>
     Dump("dump", llvm::cl::desc("Dump feature model to stdout and exit."),
          llvm::cl::init(false), llvm::cl::cat(FMViewerCategory));
 
+static llvm::cl::opt<bool> MemStats(
+    "memstats",
+    llvm::cl::desc("Print approximate memory usage of the model and exit."),
+    llvm::cl::init(false), llvm::cl::cat(FMViewerCategory));
+
+static llvm::cl::opt<bool> SimplifyStats(
+    "simplify-stats",
+    llvm::cl::desc("Print how much constraint simplification reduces the "
+                   "model and exit."),
+    llvm::cl::init(false), llvm::cl::cat(FMViewerCategory));
+
+static llvm::cl::opt<unsigned>
+    Threads("j",
+            llvm::cl::desc("Number of threads to verify several files with, "
+                           "0 uses all hardware threads."),
+            llvm::cl::init(0), llvm::cl::cat(FMViewerCategory));
+
+static void printMemoryUsage(const vara::feature::FeatureModel &FM) {
+  auto Usage = FM.memoryUsage();
+  auto Row = [](llvm::StringRef Name, size_t Bytes) {
+    llvm::outs() << llvm::formatv("  {0,-18} {1,12} B\n", Name, Bytes);
+  };
+  auto KindRow = [](llvm::StringRef Name,
+                    const vara::feature::FeatureModel::MemoryUsage::
+                        FeatureKindUsage &KindUsage) {
+    llvm::outs() << llvm::formatv("    {0,-16} {1,12} B  ({2} features)\n",
+                                  Name, KindUsage.Bytes, KindUsage.Count);
+  };
+
+  llvm::outs() << "Memory usage of '" << FM.getName() << "' (approximate):\n";
+  Row("features", Usage.features());
+  KindRow("binary", Usage.BinaryFeatures);
+  KindRow("numeric", Usage.NumericFeatures);
+  KindRow("root", Usage.RootFeatures);
+  KindRow("unknown", Usage.UnknownFeatures);
+  Row("source ranges", Usage.SourceRanges);
+  Row("constraints", Usage.Constraints);
+  Row("relationships", Usage.Relationships);
+  Row("feature map", Usage.FeatureMap);
+  Row("caches", Usage.Caches);
+  Row("metadata", Usage.Metadata);
+  Row("total", Usage.total());
+}
+
+static void printSimplification(const vara::feature::FeatureModel &FM) {
+  vara::feature::ConstraintSimplifier Simplifier(&FM);
+  for (const auto &C : FM.booleanConstraints()) {
+    (void)Simplifier.simplify(*C->constraint());
+  }
+  for (const auto &C : FM.nonBooleanConstraints()) {
+    (void)Simplifier.simplify(*C->constraint());
+  }
+  const auto &R = Simplifier.getReport();
+  llvm::outs() << "Constraint simplification of '" << FM.getName() << "':\n";
+  llvm::outs() << llvm::formatv("  {0,-18} {1,8} -> {2,8}\n", "constraints",
+                                R.NumConstraints,
+                                R.NumConstraints - R.NumRemovedConstraints);
+  llvm::outs() << llvm::formatv("  {0,-18} {1,8} -> {2,8}\n", "nodes",
+                                R.NumNodes, R.NumSimplifiedNodes);
+}
+
+static void
+printDiagnostics(llvm::StringRef FileName,
+                 const vara::feature::FeatureModelDiagnostics &Diagnostics) {
+  for (const auto &D : Diagnostics) {
+    llvm::errs() << FileName << ':' << D << '\n';
+  }
+}
+
+/// Loads all files concurrently and reports the outcome per file.
+static int verifyFeatureModels() {
+  if (Dump || MemStats || SimplifyStats || !Out.empty()) {
+    llvm::errs() << "error: Several files can only be verified.\n";
+    return 1;
+  }
+
+  auto Results = vara::feature::loadFeatureModels(FileNames, Threads);
+  unsigned Failed = 0;
+  for (size_t I = 0; I < Results.size(); ++I) {
+    if (Results[I]) {
+      llvm::outs() << FileNames[I] << ": ok\n";
+    } else {
+      printDiagnostics(FileNames[I], Results[I].getError());
+      llvm::outs() << FileNames[I] << ": invalid\n";
+      ++Failed;
+    }
+  }
+  if (Failed) {
+    llvm::errs() << llvm::formatv("error: {0} of {1} feature models are "
+                                  "invalid.\n",
+                                  Failed, Results.size());
+    return 1;
+  }
+  return 0;
+}
+
 int main(int Argc, char **Argv) {
   llvm::InitLLVM X(Argc, Argv);
   llvm::cl::HideUnrelatedOptions(FMViewerCategory);
@@ -47,26 +146,32 @@ int main(int Argc, char **Argv) {
   const char *Overview = R"(View feature model as graph.)";
 
   llvm::cl::ParseCommandLineOptions(Argc, Argv, Overview, nullptr, FlagsEnvVar);
-  if (FileName.empty()) {
+  if (FileNames.empty()) {
     llvm::errs() << "error: Expected file.\n";
     return 1;
   }
+  if (FileNames.size() > 1) {
+    return verifyFeatureModels();
+  }
 
-  if (Verify && !vara::feature::verifyFeatureModel(FileName.getValue())) {
+  const std::string &FileName = FileNames.front();
+  auto Loaded = vara::feature::loadFeatureModel(FileName, {});
+  if (!Loaded) {
+    printDiagnostics(FileName, Loaded.getError());
     llvm::errs() << "error: Invalid feature model.\n";
     return 1;
   }
-
-  std::unique_ptr<vara::feature::FeatureModel> FM =
-      vara::feature::loadFeatureModel(FileName.getValue());
-
-  if (!FM) {
-    llvm::errs() << "error: Could not build feature model.\n";
-    return 1;
+  std::unique_ptr<vara::feature::FeatureModel> FM = Loaded.extractValue();
+  if (Verify) {
+    return 0;
   }
 
   if (Dump) {
     FM->dump();
+  } else if (MemStats) {
+    printMemoryUsage(*FM);
+  } else if (SimplifyStats) {
+    printSimplification(*FM);
   } else if (!Out.empty()) {
     llvm::errs() << "Writing '" << Out << "'...";
     llvm::WriteGraph(FM.get(), llvm::Twine(FM->getName()), false, "",
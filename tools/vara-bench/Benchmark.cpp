@@ -0,0 +1,575 @@
+#include "vara/Configuration/Configuration.h"
+#include "vara/Feature/ConstraintParser.h"
+#include "vara/Feature/FeatureModel.h"
+#include "vara/Feature/FeatureModelParser.h"
+#include "vara/Feature/FeatureModelWriter.h"
+#ifdef VARA_FEATURE_USE_Z3_SOLVER
+#include "vara/Solver/CNF.h"
+#include "vara/Solver/SolverFactory.h"
+#endif
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <chrono>
+#include <deque>
+#include <random>
+#include <regex>
+
+static llvm::cl::OptionCategory BenchCategory("Benchmark options");
+
+static llvm::cl::opt<std::string>
+    FileName(llvm::cl::Positional, llvm::cl::desc("Path to the feature model"),
+             llvm::cl::cat(BenchCategory));
+
+enum class BenchmarkChoice : unsigned {
+  CONFIG_JSON,
+  XML_LOAD,
+  VALUE_LIST,
+  SXFM_LOAD,
+  CNF_LOAD,
+  CONSTRAINT_PARSE,
+  TREE_WALK,
+};
+
+static llvm::cl::opt<BenchmarkChoice> Benchmark(
+    "bench", llvm::cl::desc("The benchmark to run."),
+    llvm::cl::values(clEnumValN(BenchmarkChoice::CONFIG_JSON, "config-json",
+                                "Configuration json serialisation and parsing "
+                                "(llvm::json DOM vs. streaming)."),
+                     clEnumValN(BenchmarkChoice::XML_LOAD, "xml-load",
+                                "Loading xml feature models (validated DOM, "
+                                "trusted DOM, streaming and binary)."),
+                     clEnumValN(BenchmarkChoice::VALUE_LIST, "value-list",
+                                "Scanning numeric value lists (std::regex vs. "
+                                "linear scanner)."),
+#ifdef VARA_FEATURE_USE_Z3_SOLVER
+                     clEnumValN(BenchmarkChoice::CNF_LOAD, "cnf-load",
+                                "Setting up a solver from xml vs. from a "
+                                "cached DIMACS compilation."),
+#endif
+                     clEnumValN(BenchmarkChoice::SXFM_LOAD, "sxfm-load",
+                                "Loading large generated sxfm feature "
+                                "models."),
+                     clEnumValN(BenchmarkChoice::CONSTRAINT_PARSE,
+                                "constraint-parse",
+                                "Lexing and parsing the constraints of the "
+                                "feature model."),
+                     clEnumValN(BenchmarkChoice::TREE_WALK, "tree-walk",
+                                "Walking the trees of large generated "
+                                "feature models.")),
+    llvm::cl::init(BenchmarkChoice::CONFIG_JSON), llvm::cl::cat(BenchCategory));
+
+static llvm::cl::opt<unsigned>
+    Iterations("n", llvm::cl::desc("Number of iterations per measurement."),
+               llvm::cl::init(10000), llvm::cl::cat(BenchCategory));
+
+static llvm::cl::opt<unsigned>
+    Seed("seed", llvm::cl::desc("Seed for generated inputs."),
+         llvm::cl::init(42), llvm::cl::cat(BenchCategory));
+
+//===----------------------------------------------------------------------===//
+//                              Helpers
+//===----------------------------------------------------------------------===//
+
+/// Runs Body Iterations times and prints the mean time per iteration.
+template <typename BodyTy>
+static void measure(llvm::StringRef Name, BodyTy Body) {
+  auto Start = std::chrono::steady_clock::now();
+  for (unsigned I = 0; I < Iterations; ++I) {
+    Body(I);
+  }
+  std::chrono::duration<double, std::micro> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+  llvm::outs() << llvm::formatv("{0,-40} {1,12:f3} us/iter\n", Name,
+                                Elapsed.count() / Iterations);
+}
+
+/// Prevents the compiler from optimizing away a benchmarked result.
+template <typename T>
+static void doNotOptimize(const T &Value) {
+  asm volatile("" : : "r,m"(Value) : "memory");
+}
+
+//===----------------------------------------------------------------------===//
+//                          Configuration json
+//===----------------------------------------------------------------------===//
+
+/// Creates a random configuration assigning a value to every feature.
+static std::unique_ptr<vara::feature::Configuration>
+createRandomConfiguration(const vara::feature::FeatureModel &FM,
+                          std::mt19937 &Rng) {
+  auto Config = std::make_unique<vara::feature::Configuration>();
+  for (const auto *F : FM.features()) {
+    if (const auto *NF = llvm::dyn_cast<vara::feature::NumericFeature>(F)) {
+      auto Values = NF->getValues();
+      int64_t Value;
+      if (const auto *Range = std::get_if<
+              vara::feature::NumericFeature::ValueRangeType>(&Values)) {
+        Value = std::uniform_int_distribution<int64_t>(Range->first,
+                                                       Range->second)(Rng);
+      } else {
+        const auto &List =
+            std::get<vara::feature::NumericFeature::ValueListType>(Values);
+        Value = List.empty() ? 0 : List[Rng() % List.size()];
+      }
+      Config->setConfigurationOption(F->getName(), std::to_string(Value));
+    } else {
+      Config->setConfigurationOption(F->getName(),
+                                     Rng() % 2 ? "true" : "false");
+    }
+  }
+  return Config;
+}
+
+/// Serialisation through an intermediate llvm::json document.
+static std::string
+dumpWithJsonDom(const vara::feature::Configuration &Config) {
+  llvm::json::Object Obj{};
+  for (const auto &Entry : Config) {
+    Obj[std::string(Entry.first())] = Entry.second->asString();
+  }
+  std::string Dumped;
+  llvm::raw_string_ostream OS(Dumped);
+  OS << llvm::json::Value(std::move(Obj));
+  return OS.str();
+}
+
+static int benchmarkConfigurationJson(const vara::feature::FeatureModel &FM) {
+  std::mt19937 Rng(Seed);
+  std::vector<std::unique_ptr<vara::feature::Configuration>> Configs;
+  std::vector<std::string> Strings;
+  for (unsigned I = 0; I < 64; ++I) {
+    Configs.push_back(createRandomConfiguration(FM, Rng));
+    Strings.push_back(Configs.back()->dumpToString());
+  }
+  llvm::outs() << "Configurations with " << Configs.front()->size()
+               << " options\n";
+
+  measure("write: llvm::json DOM", [&](unsigned I) {
+    doNotOptimize(dumpWithJsonDom(*Configs[I % Configs.size()]));
+  });
+  measure("write: dumpToString", [&](unsigned I) {
+    doNotOptimize(Configs[I % Configs.size()]->dumpToString());
+  });
+  std::string Buffer;
+  llvm::raw_string_ostream OS(Buffer);
+  measure("write: writeJson (reused stream)", [&](unsigned I) {
+    Buffer.clear();
+    Configs[I % Configs.size()]->writeJson(OS);
+    OS.flush();
+    doNotOptimize(Buffer);
+  });
+
+  measure("read: llvm::json DOM", [&](unsigned I) {
+    doNotOptimize(vara::feature::Configuration::createConfigurationFromString(
+        Strings[I % Strings.size()]));
+  });
+  measure("read: single pass with feature model", [&](unsigned I) {
+    doNotOptimize(vara::feature::Configuration::createConfigurationFromString(
+        Strings[I % Strings.size()], FM));
+  });
+  return 0;
+}
+
+//===----------------------------------------------------------------------===//
+//                          Xml loading
+//===----------------------------------------------------------------------===//
+
+static int benchmarkXmlLoad(const vara::feature::FeatureModel &FM) {
+  auto FS = llvm::MemoryBuffer::getFileAsStream(FileName);
+  if (!FS) {
+    llvm::errs() << "error: Could not read file.\n";
+    return 1;
+  }
+  std::string Xml = FS.get()->getBuffer().str();
+  auto Checked = vara::feature::FeatureModelXmlWriter(FM, true)
+                     .writeFeatureModel();
+  auto Binary = vara::feature::FeatureModelBinaryWriter(FM).writeFeatureModel();
+  if (!Checked || !Binary) {
+    llvm::errs() << "error: Could not write feature model.\n";
+    return 1;
+  }
+  llvm::outs() << "Feature model with " << FM.size() << " features\n";
+
+  measure("load: DOM, DTD validated", [&](unsigned) {
+    doNotOptimize(
+        vara::feature::FeatureModelXmlParser(Xml).buildFeatureModel());
+  });
+  measure("load: DOM, trusted checksum", [&](unsigned) {
+    doNotOptimize(vara::feature::FeatureModelXmlParser(*Checked, true)
+                      .buildFeatureModel());
+  });
+  measure("load: loadFeatureModel, mapped file", [&](unsigned) {
+    doNotOptimize(vara::feature::loadFeatureModel(FileName.getValue()));
+  });
+  measure("load: streaming", [&](unsigned) {
+    doNotOptimize(
+        vara::feature::FeatureModelXmlStreamParser(Xml).buildFeatureModel());
+  });
+  measure("load: streaming, read in chunks", [&](unsigned) {
+    auto P = vara::feature::FeatureModelXmlStreamParser::fromFile(
+        FileName.getValue());
+    doNotOptimize(P->buildFeatureModel());
+  });
+  measure("load: binary", [&](unsigned) {
+    doNotOptimize(
+        vara::feature::FeatureModelBinaryParser(*Binary).buildFeatureModel());
+  });
+  return 0;
+}
+
+//===----------------------------------------------------------------------===//
+//                          Numeric value lists
+//===----------------------------------------------------------------------===//
+
+/// The former regex based scanning of value lists, kept as baseline.
+static std::vector<int64_t> parseIntegerListWithRegex(const std::string &Str) {
+  std::vector<int64_t> Values;
+  const std::regex Regex(R"(-?\d+)");
+  std::smatch Matches;
+  for (std::string Suffix = Str; regex_search(Suffix, Matches, Regex);
+       Suffix = Matches.suffix()) {
+    Values.emplace_back(vara::feature::parseInteger(Matches.str()));
+  }
+  return Values;
+}
+
+/// Creates a feature model with a single numeric feature listing \p Values.
+static std::string createValueListModel(const std::string &Values) {
+  return llvm::formatv(
+             "<vm name=\"ValueList\">\n"
+             "<binaryOptions>\n<configurationOption>\n<name>root</name>\n"
+             "<optional>False</optional>\n</configurationOption>\n"
+             "</binaryOptions>\n<numericOptions>\n<configurationOption>\n"
+             "<name>N</name>\n<parent>root</parent>\n"
+             "<optional>False</optional>\n<values>{0}</values>\n"
+             "</configurationOption>\n</numericOptions>\n</vm>\n",
+             Values)
+      .str();
+}
+
+static int benchmarkValueList() {
+  std::mt19937 Rng(Seed);
+  std::uniform_int_distribution<int64_t> Dist(-1000000, 1000000);
+  for (unsigned Size : {100U, 1000U, 10000U}) {
+    std::string Values;
+    for (unsigned I = 0; I < Size; ++I) {
+      Values += (I ? ";" : "") + std::to_string(Dist(Rng));
+    }
+    std::string Xml = createValueListModel(Values);
+
+    // The regex baseline is quadratic, only measure it on short lists.
+    if (Size <= 1000) {
+      measure(llvm::formatv("scan {0} values: std::regex", Size).str(),
+              [&](unsigned) {
+                doNotOptimize(parseIntegerListWithRegex(Values));
+              });
+    }
+    measure(llvm::formatv("scan {0} values: parseIntegerList", Size).str(),
+            [&](unsigned) {
+              doNotOptimize(vara::feature::parseIntegerList(Values));
+            });
+    measure(llvm::formatv("load {0} values: DOM", Size).str(), [&](unsigned) {
+      doNotOptimize(
+          vara::feature::FeatureModelXmlParser(Xml).buildFeatureModel());
+    });
+    measure(llvm::formatv("load {0} values: streaming", Size).str(),
+            [&](unsigned) {
+              doNotOptimize(vara::feature::FeatureModelXmlStreamParser(Xml)
+                                .buildFeatureModel());
+            });
+  }
+  return 0;
+}
+
+//===----------------------------------------------------------------------===//
+//                          Sxfm loading
+//===----------------------------------------------------------------------===//
+
+/// Creates a random S.P.L.O.T. style feature model with \p Size features below
+/// the root, mixing mandatory, optional and grouped features.
+static std::string createSxfmModel(unsigned Size, std::mt19937 &Rng) {
+  constexpr unsigned MaxDepth = 12;
+  std::string Tree = ":r root (id_root)\n";
+  std::vector<bool> IsGroup{false};
+  unsigned Level = 0;
+  std::vector<unsigned> Named;
+  for (unsigned I = 0; I < Size || IsGroup[Level]; ++I) {
+    // An or group needs at least one child, so descend after opening one.
+    Level = IsGroup[Level] ? Level + 1
+                           : 1 + Rng() % std::min(Level + 1, MaxDepth);
+    IsGroup.resize(Level + 1);
+    Tree.append(Level, '\t');
+    if (IsGroup[Level - 1]) {
+      Tree += ":";
+    } else if (unsigned Kind = Rng() % 10; Kind == 0 && Level < MaxDepth) {
+      Tree += llvm::formatv(":g [1,{0}]\n", Rng() % 2 ? "1" : "*").str();
+      IsGroup[Level] = true;
+      continue;
+    } else {
+      Tree += Kind % 2 ? ":o" : ":m";
+    }
+    IsGroup[Level] = false;
+    Named.push_back(I);
+    Tree += llvm::formatv(" f{0} (id_{0})\n", I).str();
+  }
+
+  std::string Constraints;
+  for (unsigned I = 0; I < Size / 100; ++I) {
+    Constraints += llvm::formatv("c{0}: ~id_{1} or id_{2}\n", I,
+                                 Named[Rng() % Named.size()],
+                                 Named[Rng() % Named.size()])
+                       .str();
+  }
+  return llvm::formatv("<feature_model name=\"Generated\">\n"
+                       "<feature_tree>\n{0}</feature_tree>\n"
+                       "<constraints>\n{1}</constraints>\n"
+                       "</feature_model>\n",
+                       Tree, Constraints)
+      .str();
+}
+
+static int benchmarkSxfmLoad() {
+  std::mt19937 Rng(Seed);
+  for (unsigned Size : {1000U, 10000U, 50000U}) {
+    std::string Sxfm = createSxfmModel(Size, Rng);
+    auto FM = vara::feature::FeatureModelSxfmParser(Sxfm).buildFeatureModel();
+    if (!FM) {
+      llvm::errs() << "error: Could not build generated sxfm model.\n";
+      return 1;
+    }
+    auto Xml = vara::feature::FeatureModelXmlWriter(*FM).writeFeatureModel();
+    auto Binary =
+        vara::feature::FeatureModelBinaryWriter(*FM).writeFeatureModel();
+    if (!Xml || !Binary) {
+      llvm::errs() << "error: Could not write feature model.\n";
+      return 1;
+    }
+
+    measure(llvm::formatv("load {0} features: sxfm", FM->size()).str(),
+            [&](unsigned) {
+              doNotOptimize(vara::feature::FeatureModelSxfmParser(Sxfm)
+                                .buildFeatureModel());
+            });
+    measure(llvm::formatv("load {0} features: xml, DOM", FM->size()).str(),
+            [&](unsigned) {
+              doNotOptimize(vara::feature::FeatureModelXmlParser(*Xml)
+                                .buildFeatureModel());
+            });
+    measure(llvm::formatv("load {0} features: binary", FM->size()).str(),
+            [&](unsigned) {
+              doNotOptimize(vara::feature::FeatureModelBinaryParser(*Binary)
+                                .buildFeatureModel());
+            });
+  }
+  return 0;
+}
+
+//===----------------------------------------------------------------------===//
+//                          Tree walking
+//===----------------------------------------------------------------------===//
+
+static int benchmarkTreeWalk() {
+  std::mt19937 Rng(Seed);
+  for (unsigned Size : {1000U, 10000U, 50000U}) {
+    auto FM = vara::feature::FeatureModelSxfmParser(createSxfmModel(Size, Rng))
+                  .buildFeatureModel();
+    if (!FM) {
+      llvm::errs() << "error: Could not build generated sxfm model.\n";
+      return 1;
+    }
+
+    measure(llvm::formatv("walk {0} features: children", FM->size()).str(),
+            [&](unsigned) {
+              size_t Visited = 0;
+              llvm::SmallVector<vara::feature::FeatureTreeNode *, 64> Stack{
+                  FM->getRoot()};
+              while (!Stack.empty()) {
+                auto *N = Stack.pop_back_val();
+                ++Visited;
+                Stack.append(N->begin(), N->end());
+              }
+              doNotOptimize(Visited);
+            });
+    measure(
+        llvm::formatv("walk {0} features: getChildren", FM->size()).str(),
+        [&](unsigned) {
+          size_t Visited = 0;
+          llvm::SmallVector<vara::feature::Feature *, 64> Stack{FM->getRoot()};
+          while (!Stack.empty()) {
+            auto *F = Stack.pop_back_val();
+            ++Visited;
+            for (auto *C : F->getChildren<vara::feature::Feature>()) {
+              Stack.push_back(C);
+            }
+          }
+          doNotOptimize(Visited);
+        });
+    measure(llvm::formatv("walk {0} features: parents", FM->size()).str(),
+            [&](unsigned) {
+              size_t Depth = 0;
+              for (auto *F : FM->features()) {
+                for (auto *P = F->getParent(); P; P = P->getParent()) {
+                  ++Depth;
+                }
+              }
+              doNotOptimize(Depth);
+            });
+  }
+  return 0;
+}
+
+#ifdef VARA_FEATURE_USE_Z3_SOLVER
+//===----------------------------------------------------------------------===//
+//                          CNF loading
+//===----------------------------------------------------------------------===//
+
+static int benchmarkCnfLoad(const vara::feature::FeatureModel &FM) {
+  auto Formula = vara::solver::CNF::compile(FM);
+  if (!Formula) {
+    llvm::errs() << "error: Could not compile feature model.\n";
+    return 1;
+  }
+  std::string Dimacs;
+  llvm::raw_string_ostream OS(Dimacs);
+  Formula.extractValue()->writeDimacs(OS);
+  OS.flush();
+
+  measure("solver: xml model", [&](unsigned) {
+    auto Loaded = vara::feature::loadFeatureModel(FileName.getValue());
+    doNotOptimize(vara::solver::SolverFactory::initializeSolver(
+                      *Loaded, vara::solver::SolverType::Z3)
+                      ->hasValidConfigurations());
+  });
+  measure("solver: dimacs", [&](unsigned) {
+    auto Loaded = vara::solver::CNF::parseDimacs(Dimacs);
+    doNotOptimize(vara::solver::SolverFactory::initializeSolver(
+                      *Loaded.extractValue(), vara::solver::SolverType::Z3)
+                      .extractValue()
+                      ->hasValidConfigurations());
+  });
+  return 0;
+}
+#endif
+
+//===----------------------------------------------------------------------===//
+//                          Constraint parsing
+//===----------------------------------------------------------------------===//
+
+/// Token list owning a copy of every value, like the former eager lexer, kept
+/// as baseline.
+static std::deque<std::pair<vara::feature::ConstraintToken::ConstraintTokenKind,
+                            std::string>>
+tokenizeOwning(llvm::StringRef Cnt) {
+  std::deque<std::pair<vara::feature::ConstraintToken::ConstraintTokenKind,
+                       std::string>>
+      TokenList;
+  vara::feature::ConstraintLexer L(Cnt);
+  for (const auto &Token : L.tokenize()) {
+    TokenList.emplace_back(Token.getKind(),
+                           Token.getValue().value_or("").str());
+  }
+  return TokenList;
+}
+
+static int benchmarkConstraintParse(const vara::feature::FeatureModel &FM) {
+  std::vector<std::string> Constraints;
+  for (const auto *C : FM.booleanConstraints()) {
+    Constraints.push_back(C->toString());
+  }
+  for (const auto *C : FM.nonBooleanConstraints()) {
+    Constraints.push_back(C->toString());
+  }
+  for (const auto *C : FM.mixedConstraints()) {
+    Constraints.push_back(C->toString());
+  }
+  if (Constraints.empty()) {
+    llvm::errs() << "error: Feature model has no constraints.\n";
+    return 1;
+  }
+  size_t Size = 0;
+  for (const auto &C : Constraints) {
+    Size += C.size();
+  }
+  llvm::outs() << "Parsing " << Constraints.size() << " constraints with "
+               << Size << " characters per iteration\n";
+
+  measure("lex: owning token list", [&](unsigned) {
+    for (const auto &C : Constraints) {
+      doNotOptimize(tokenizeOwning(C));
+    }
+  });
+  measure("lex: lazy", [&](unsigned) {
+    for (const auto &C : Constraints) {
+      using TokenKind = vara::feature::ConstraintToken::ConstraintTokenKind;
+      vara::feature::ConstraintLexer L(C);
+      for (auto Kind = L.next().getKind();
+           Kind != TokenKind::END_OF_FILE && Kind != TokenKind::ERROR;
+           Kind = L.next().getKind()) {
+      }
+    }
+  });
+  measure("parse: placeholder features", [&](unsigned) {
+    for (const auto &C : Constraints) {
+      doNotOptimize(vara::feature::ConstraintParser(C).buildConstraint());
+    }
+  });
+  measure("parse: features of model", [&](unsigned) {
+    for (const auto &C : Constraints) {
+      doNotOptimize(vara::feature::ConstraintParser(C).buildConstraint(FM));
+    }
+  });
+  return 0;
+}
+
+int main(int Argc, char **Argv) {
+  llvm::InitLLVM X(Argc, Argv);
+  llvm::cl::HideUnrelatedOptions(BenchCategory);
+
+  const char *FlagsEnvVar = "VARA_BENCH_FLAGS";
+  const char *Overview = R"(Run vara-feature micro benchmarks.)";
+
+  llvm::cl::ParseCommandLineOptions(Argc, Argv, Overview, nullptr, FlagsEnvVar);
+  if (FileName.empty()) {
+    llvm::errs() << "error: Expected file.\n";
+    return 1;
+  }
+  if (Iterations == 0) {
+    llvm::errs() << "error: Expected at least one iteration.\n";
+    return 1;
+  }
+
+  std::unique_ptr<vara::feature::FeatureModel> FM =
+      vara::feature::loadFeatureModel(FileName.getValue());
+  if (!FM) {
+    llvm::errs() << "error: Could not build feature model.\n";
+    return 1;
+  }
+
+  switch (Benchmark.getValue()) {
+  case BenchmarkChoice::CONFIG_JSON:
+    return benchmarkConfigurationJson(*FM);
+  case BenchmarkChoice::XML_LOAD:
+    return benchmarkXmlLoad(*FM);
+  case BenchmarkChoice::VALUE_LIST:
+    return benchmarkValueList();
+  case BenchmarkChoice::SXFM_LOAD:
+    return benchmarkSxfmLoad();
+  case BenchmarkChoice::CNF_LOAD:
+#ifdef VARA_FEATURE_USE_Z3_SOLVER
+    return benchmarkCnfLoad(*FM);
+#else
+    llvm::errs() << "error: vara-bench was built without solver support.\n";
+    return 1;
+#endif
+  case BenchmarkChoice::CONSTRAINT_PARSE:
+    return benchmarkConstraintParse(*FM);
+  case BenchmarkChoice::TREE_WALK:
+    return benchmarkTreeWalk();
+  }
+  return 0;
+}
@@ -1,4 +1,5 @@
 #include "vara/Configuration/Configuration.h"
+#include "vara/Feature/FeatureModelBuilder.h"
 
 #include "gtest/gtest.h"
 
@@ -61,4 +62,80 @@ TEST(Configuration, iteratorTest) {
   Iterator++;
   EXPECT_EQ(Config.end(), Iterator);
 }
+
+TEST(Configuration, equalityAndHashTest) {
+  Configuration Config{};
+  Config.setConfigurationOption("foo", "1");
+  Config.setConfigurationOption("baz", "true");
+  Configuration Reordered{};
+  Reordered.setConfigurationOption("baz", "true");
+  Reordered.setConfigurationOption("foo", "1");
+  EXPECT_EQ(Config, Reordered);
+  EXPECT_EQ(Config.hash(), Reordered.hash());
+
+  Reordered.setConfigurationOption("foo", "2");
+  EXPECT_NE(Config, Reordered);
+  EXPECT_NE(Config.hash(), Reordered.hash());
+
+  Reordered.setConfigurationOption("foo", "1");
+  Reordered.setConfigurationOption("bar", "1");
+  EXPECT_NE(Config, Reordered);
+}
+
+TEST(Configuration, writeJsonEscapesStrings) {
+  Configuration Config{};
+  Config.setConfigurationOption("b", "say \"hi\"\n");
+  Config.setConfigurationOption("a", "-3");
+  std::string Out;
+  llvm::raw_string_ostream OS(Out);
+  Config.writeJson(OS);
+  EXPECT_EQ(R"({"a":"-3","b":"say \"hi\"\n"})", OS.str());
+
+  // DEL is not a control character for json and stays as is.
+  Configuration Del{};
+  Del.setConfigurationOption("c", "\x7f");
+  EXPECT_EQ("{\"c\":\"\x7f\"}", Del.dumpToString());
+}
+
+static std::unique_ptr<FeatureModel> buildJsonTestModel() {
+  FeatureModelBuilder B;
+  B.makeFeature<BinaryFeature>("foo");
+  B.makeFeature<NumericFeature>("baz", std::vector<int64_t>{1, 2});
+  return B.buildFeatureModel();
+}
+
+TEST(Configuration, schemaParsingTest) {
+  auto FM = buildJsonTestModel();
+  ASSERT_TRUE(FM);
+
+  auto Config = Configuration::createConfigurationFromString(
+      R"( { "baz" : "1", "fo\u006f":"true" } )", *FM);
+  ASSERT_TRUE(Config);
+  EXPECT_EQ(Config->size(), 2);
+  EXPECT_EQ("true", Config->configurationOptionValue("foo").value());
+  EXPECT_EQ(*Config, *Configuration::createConfigurationFromString(
+                         Config->dumpToString(), *FM));
+  EXPECT_TRUE(Configuration::createConfigurationFromString("{}", *FM));
+}
+
+TEST(Configuration, negativeSchemaParsingTest) {
+  auto FM = buildJsonTestModel();
+  ASSERT_TRUE(FM);
+
+  EXPECT_FALSE(
+      Configuration::createConfigurationFromString(R"({"bar":"true"})", *FM));
+  EXPECT_FALSE(
+      Configuration::createConfigurationFromString(R"({"foo":"1"})", *FM));
+  EXPECT_FALSE(
+      Configuration::createConfigurationFromString(R"({"baz":"x"})", *FM));
+  EXPECT_FALSE(
+      Configuration::createConfigurationFromString(R"({"baz":1})", *FM));
+  EXPECT_FALSE(
+      Configuration::createConfigurationFromString(R"({"baz":"0x1"})", *FM));
+  EXPECT_FALSE(
+      Configuration::createConfigurationFromString(R"({"baz":"1",})", *FM));
+  EXPECT_FALSE(
+      Configuration::createConfigurationFromString(R"({"baz":"1"} x)", *FM));
+  EXPECT_FALSE(Configuration::createConfigurationFromString(R"(["1"])", *FM));
+}
 } // namespace vara::feature
@@ -56,5 +56,12 @@ TEST(ConfigurationOption, negativeTests) {
   EXPECT_EQ("test", StringOption.stringValue().value());
   EXPECT_FALSE(StringOption.intValue().has_value());
   EXPECT_FALSE(StringOption.boolValue().has_value());
+
+  ConfigurationOption LeadingZeroOption("r", "010");
+  EXPECT_EQ(10, LeadingZeroOption.intValue().value());
+
+  ConfigurationOption HexOption("s", "0x10");
+  EXPECT_EQ("0x10", HexOption.stringValue().value());
+  EXPECT_FALSE(HexOption.intValue().has_value());
 }
 } // namespace vara::feature
@@ -0,0 +1,89 @@
+#include "vara/Configuration/ConfigurationSet.h"
+
+#include "gtest/gtest.h"
+
+namespace vara::feature {
+
+static std::unique_ptr<Configuration> createConfig(llvm::StringRef Foo,
+                                                   llvm::StringRef Bar) {
+  auto Config = std::make_unique<Configuration>();
+  Config->setConfigurationOption("foo", Foo);
+  Config->setConfigurationOption("bar", Bar);
+  return Config;
+}
+
+TEST(ConfigurationSet, insertDeduplicates) {
+  ConfigurationSet Set;
+  EXPECT_TRUE(Set.empty());
+  EXPECT_TRUE(Set.insert(createConfig("true", "1")));
+  EXPECT_TRUE(Set.insert(createConfig("false", "1")));
+  EXPECT_FALSE(Set.insert(createConfig("true", "1")));
+  EXPECT_EQ(Set.size(), 2);
+  EXPECT_TRUE(Set.contains(*createConfig("false", "1")));
+  EXPECT_FALSE(Set.contains(*createConfig("false", "2")));
+}
+
+TEST(ConfigurationSet, keepsInsertionOrder) {
+  std::vector<std::unique_ptr<Configuration>> Configs;
+  for (int I = 0; I < 100; ++I) {
+    Configs.push_back(createConfig("true", std::to_string(I % 50)));
+  }
+  ConfigurationSet Set(std::move(Configs));
+  EXPECT_EQ(Set.size(), 50);
+
+  int Expected = 0;
+  for (const auto *Config : Set) {
+    EXPECT_EQ(Config->configurationOptionValue("bar").value(),
+              std::to_string(Expected++));
+  }
+}
+
+TEST(ConfigurationSet, merge) {
+  ConfigurationSet Left;
+  Left.insert(createConfig("true", "1"));
+  Left.insert(createConfig("true", "2"));
+  ConfigurationSet Right;
+  Right.insert(createConfig("true", "2"));
+  Right.insert(createConfig("true", "3"));
+
+  Left.merge(std::move(Right));
+  EXPECT_EQ(Left.size(), 3);
+  EXPECT_TRUE(Left.contains(*createConfig("true", "3")));
+  EXPECT_TRUE(Right.empty());
+}
+
+TEST(ConfigurationSet, intersect) {
+  ConfigurationSet Left;
+  Left.insert(createConfig("true", "1"));
+  Left.insert(createConfig("true", "2"));
+  Left.insert(createConfig("true", "3"));
+  ConfigurationSet Right;
+  Right.insert(createConfig("true", "3"));
+  Right.insert(createConfig("true", "2"));
+
+  Left.intersect(Right);
+  EXPECT_EQ(Left.size(), 2);
+  EXPECT_FALSE(Left.contains(*createConfig("true", "1")));
+  EXPECT_TRUE(Left.contains(*createConfig("true", "2")));
+  EXPECT_TRUE(Left.contains(*createConfig("true", "3")));
+
+  Left.intersect(ConfigurationSet());
+  EXPECT_TRUE(Left.empty());
+}
+
+TEST(ConfigurationSet, subtract) {
+  ConfigurationSet Left;
+  Left.insert(createConfig("true", "1"));
+  Left.insert(createConfig("true", "2"));
+  Left.insert(createConfig("true", "3"));
+  ConfigurationSet Right;
+  Right.insert(createConfig("true", "2"));
+
+  Left.subtract(Right);
+  EXPECT_EQ(Left.size(), 2);
+  EXPECT_TRUE(Left.contains(*createConfig("true", "1")));
+  EXPECT_FALSE(Left.contains(*createConfig("true", "2")));
+  EXPECT_TRUE(Left.insert(createConfig("true", "2")));
+}
+
+} // namespace vara::feature
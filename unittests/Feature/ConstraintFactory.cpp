@@ -0,0 +1,97 @@
+#include "vara/Feature/ConstraintFactory.h"
+#include "vara/Feature/ConstraintParser.h"
+#include "vara/Feature/Feature.h"
+
+#include "gtest/gtest.h"
+
+namespace vara::feature {
+
+static std::unique_ptr<Constraint> parse(llvm::StringRef Str) {
+  auto C = ConstraintParser(Str.str()).buildConstraint();
+  assert(C);
+  return C;
+}
+
+TEST(ConstraintFactory, internEqualConstraints) {
+  ConstraintFactory CF;
+  auto First = CF.intern(*parse("A => B"));
+  auto Second = CF.intern(*parse("(A => B)"));
+  auto Other = CF.intern(*parse("B => A"));
+
+  EXPECT_EQ(First, Second);
+  EXPECT_NE(First, Other);
+  EXPECT_EQ(CF.size(), 4);
+
+  const auto &Stats = CF.getStatistics();
+  EXPECT_EQ(Stats.NumNodes, 9);
+  EXPECT_EQ(Stats.NumUniqueNodes, 4);
+  EXPECT_EQ(Stats.NumConstraints, 3);
+  EXPECT_EQ(Stats.NumDuplicateConstraints, 1);
+}
+
+TEST(ConstraintFactory, shareSubtrees) {
+  ConstraintFactory CF;
+  auto Root = CF.intern(*parse("((A & !B) => C) | ((A & !B) => (C = 3))"));
+  const auto &N = CF[Root];
+
+  ASSERT_EQ(N.Kind, Constraint::ConstraintKind::CK_OR);
+  EXPECT_EQ(CF[CF[N.LeftOperand].LeftOperand].Kind,
+            Constraint::ConstraintKind::CK_AND);
+  EXPECT_EQ(CF[N.LeftOperand].LeftOperand, CF[N.Operand].LeftOperand);
+  EXPECT_EQ(CF.getStatistics().NumDuplicateConstraints, 0);
+}
+
+TEST(ConstraintFactory, integers) {
+  ConstraintFactory CF;
+  auto Max = CF.makeInteger(INT64_MAX);
+  auto Min = CF.makeInteger(INT64_MIN);
+  auto MinusOne = CF.makeInteger(-1);
+
+  EXPECT_EQ(CF.makeInteger(INT64_MAX), Max);
+  EXPECT_NE(Max, Min);
+  EXPECT_NE(Min, MinusOne);
+  EXPECT_EQ(CF[Min].getValue(), INT64_MIN);
+  EXPECT_EQ(CF[MinusOne].getValue(), -1);
+}
+
+TEST(ConstraintFactory, toConstraint) {
+  ConstraintFactory CF;
+  BinaryFeature A("A");
+  BinaryFeature B("B");
+  auto NotA = CF.makeUnary(Constraint::ConstraintKind::CK_NOT,
+                           CF.makeFeature(A));
+  auto Root = CF.makeBinary(
+      Constraint::ConstraintKind::CK_AND, NotA,
+      CF.makeBinary(Constraint::ConstraintKind::CK_OR, NotA,
+                    CF.makeFeature(B)));
+
+  auto FeatureOf = [&A, &B](llvm::StringRef Name) -> Feature * {
+    return Name == "A" ? &A : &B;
+  };
+
+  EXPECT_EQ(CF.toFlatConstraint(Root, FeatureOf).size(), 7);
+  auto C = CF.toConstraint(Root, FeatureOf);
+  EXPECT_EQ(C->toString(), "(!A & (!A | B))");
+  EXPECT_EQ(CF.intern(*C), Root);
+  auto *Leaf = llvm::cast<PrimaryFeatureConstraint>(
+      llvm::cast<NotConstraint>(
+          llvm::cast<AndConstraint>(C.get())->getLeftOperand())
+          ->getOperand());
+  EXPECT_EQ(Leaf->getFeature(), &A);
+}
+
+TEST(ConstraintFactory, outliveInternedConstraints) {
+  ConstraintFactory CF;
+  auto Root = CF.intern(*parse("A | !A"));
+  EXPECT_EQ(CF[CF[Root].LeftOperand].getFeatureName(), "A");
+
+  BinaryFeature A("A");
+  auto C = CF.toConstraint(Root, [&A](llvm::StringRef) { return &A; });
+  EXPECT_EQ(C->toString(), "(A | !A)");
+  EXPECT_EQ(llvm::cast<PrimaryFeatureConstraint>(
+                llvm::cast<OrConstraint>(C.get())->getLeftOperand())
+                ->getFeature(),
+            &A);
+}
+
+} // namespace vara::feature
@@ -1,4 +1,5 @@
 #include "vara/Feature/ConstraintParser.h"
+#include "vara/Feature/FeatureModelBuilder.h"
 
 #include "gtest/gtest.h"
 
@@ -47,11 +48,37 @@ TEST(ConstraintLexer, scientific) {
             ConstraintToken::ConstraintTokenKind::END_OF_FILE);
 }
 
+TEST(ConstraintLexer, lazy) {
+  llvm::StringRef Cnt = "A => ? B";
+  ConstraintLexer L(Cnt);
+
+  auto Token = L.next();
+  EXPECT_EQ(Token.getKind(), ConstraintToken::ConstraintTokenKind::IDENTIFIER);
+  EXPECT_EQ(Token.getValue()->data(), Cnt.data());
+  EXPECT_EQ(L.next().getKind(),
+            ConstraintToken::ConstraintTokenKind::WHITESPACE);
+  EXPECT_EQ(L.next().getKind(), ConstraintToken::ConstraintTokenKind::IMPLIES);
+  EXPECT_EQ(L.next().getKind(),
+            ConstraintToken::ConstraintTokenKind::WHITESPACE);
+  for (int I = 0; I < 2; ++I) {
+    Token = L.next();
+    EXPECT_EQ(Token.getKind(), ConstraintToken::ConstraintTokenKind::ERROR);
+    EXPECT_EQ(Token.getValue()->data(), Cnt.data() + 5);
+  }
+
+  ConstraintLexer Empty("");
+  EXPECT_EQ(Empty.next().getKind(),
+            ConstraintToken::ConstraintTokenKind::END_OF_FILE);
+  EXPECT_EQ(Empty.next().getKind(),
+            ConstraintToken::ConstraintTokenKind::END_OF_FILE);
+}
+
 class ConstraintLexerTest : public ::testing::Test {
 protected:
   static void checkPrimary(ConstraintToken::ConstraintTokenKind Kind,
                            const std::string &Repr) {
-    auto TokenList = ConstraintLexer(Repr).tokenize();
+    ConstraintLexer L(Repr);
+    auto TokenList = L.tokenize();
     ASSERT_EQ(TokenList.size(), 2);
 
     EXPECT_EQ(TokenList[0].getKind(), Kind);
@@ -61,7 +88,8 @@ protected:
 
   static void checkUnary(ConstraintToken::ConstraintTokenKind Kind,
                          const std::string &Repr) {
-    auto TokenList = ConstraintLexer(Repr + "feature_A").tokenize();
+    ConstraintLexer L(Repr + "feature_A");
+    auto TokenList = L.tokenize();
     ASSERT_EQ(TokenList.size(), 3);
 
     EXPECT_EQ(TokenList[0].getKind(), Kind);
@@ -74,8 +102,8 @@ protected:
 
   static void checkBinary(ConstraintToken::ConstraintTokenKind Kind,
                           const std::string &Repr) {
-    auto TokenList =
-        ConstraintLexer("feature_A" + Repr + "feature_B").tokenize();
+    ConstraintLexer L("feature_A" + Repr + "feature_B");
+    auto TokenList = L.tokenize();
     ASSERT_EQ(TokenList.size(), 4);
 
     EXPECT_EQ(TokenList[0].getKind(),
@@ -177,6 +205,18 @@ TEST(ConstraintParser, doubleClamp) {
   EXPECT_EQ(C->toString(), std::to_string(std::numeric_limits<int64_t>::max()));
 }
 
+TEST(ConstraintParser, integerList) {
+  EXPECT_EQ(parseIntegerList("1, 2,-3 ;4"),
+            (std::vector<int64_t>{1, 2, -3, 4}));
+  EXPECT_EQ(parseIntegerList("5-3--2 - 1"),
+            (std::vector<int64_t>{5, -3, -2, 1}));
+  EXPECT_TRUE(parseIntegerList(" ,- ").empty());
+  EXPECT_EQ(parseIntegerList(
+                llvm::formatv("{0}0", std::numeric_limits<int64_t>::max())
+                    .str()),
+            (std::vector<int64_t>{std::numeric_limits<int64_t>::max()}));
+}
+
 TEST(ConstraintParser, decimalClamp) {
   auto C = ConstraintParser(
                llvm::formatv("{0}0", std::numeric_limits<int64_t>::max()))
@@ -187,6 +227,31 @@ TEST(ConstraintParser, decimalClamp) {
   EXPECT_EQ(C->toString(), std::to_string(std::numeric_limits<int64_t>::max()));
 }
 
+TEST(ConstraintParser, resolveFeatures) {
+  FeatureModelBuilder B;
+  B.makeFeature<BinaryFeature>("a");
+  B.makeFeature<NumericFeature>("n", std::vector<int64_t>{1, 2});
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  auto C = ConstraintParser("a => (n + 1 > x)").buildConstraint(*FM);
+  ASSERT_TRUE(C);
+  EXPECT_EQ(C->toString(), "(a => ((n + 1) > x))");
+
+  auto *Implies = llvm::cast<ImpliesConstraint>(C.get());
+  auto *A = llvm::cast<PrimaryFeatureConstraint>(Implies->getLeftOperand());
+  EXPECT_EQ(A->getFeature(), FM->getFeature("a"));
+  auto *Greater = llvm::cast<GreaterConstraint>(Implies->getRightOperand());
+  auto *Addition = llvm::cast<AdditionConstraint>(Greater->getLeftOperand());
+  EXPECT_EQ(llvm::cast<PrimaryFeatureConstraint>(Addition->getLeftOperand())
+                ->getFeature(),
+            FM->getFeature("n"));
+  auto *X = llvm::cast<PrimaryFeatureConstraint>(Greater->getRightOperand());
+  ASSERT_TRUE(X->getFeature());
+  EXPECT_EQ(X->getFeature()->getName(), "x");
+  EXPECT_FALSE(FM->getFeature("x"));
+}
+
 class ConstraintParserTest : public ::testing::Test {
 protected:
   static void checkPrimary(Constraint::ConstraintKind Kind,
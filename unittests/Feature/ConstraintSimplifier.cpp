@@ -0,0 +1,131 @@
+#include "vara/Feature/ConstraintSimplifier.h"
+#include "vara/Feature/ConstraintBuilder.h"
+#include "vara/Feature/ConstraintParser.h"
+#include "vara/Feature/FeatureModelBuilder.h"
+#include "vara/Feature/FlatConstraint.h"
+
+#include "llvm/ADT/StringMap.h"
+
+#include "gtest/gtest.h"
+
+namespace vara::feature {
+
+static std::unique_ptr<Constraint> parse(llvm::StringRef Str) {
+  auto C = ConstraintParser(Str.str()).buildConstraint();
+  assert(C);
+  return C;
+}
+
+/// \returns the simplified constraint as string, empty if it was removed
+static std::string simplify(llvm::StringRef Str,
+                            const FeatureModel *FM = nullptr) {
+  ConstraintSimplifier S(FM);
+  auto C = parse(Str);
+  auto Simplified = S.simplify(*C);
+  return Simplified ? Simplified->toString() : "";
+}
+
+TEST(ConstraintSimplifier, negationNormalForm) {
+  EXPECT_EQ(simplify("!!A"), "A");
+  EXPECT_EQ(simplify("!(A & (B | !C))"), "(!A | (!B & C))");
+  EXPECT_EQ(simplify("!(A => B)"), "(A & !B)");
+  EXPECT_EQ(simplify("!(A <=> !B)"), "(A <=> B)");
+  EXPECT_EQ(simplify("!(N > 3)"), "(N <= 3)");
+  EXPECT_EQ(simplify("~~N = M"), "(N = M)");
+}
+
+TEST(ConstraintSimplifier, flatten) {
+  EXPECT_EQ(simplify("(A & B) & (C & A)"), "((A & B) & C)");
+  EXPECT_EQ(simplify("A | (B | (A | B))"), "(A | B)");
+  EXPECT_EQ(simplify("A => (B | A)"), "");
+  EXPECT_EQ(simplify("A | (B | !A)"), "");
+  EXPECT_EQ(simplify("(A <=> A) & (B => B)"), "");
+}
+
+TEST(ConstraintSimplifier, constantFolding) {
+  EXPECT_EQ(simplify("N * (1 + 1) = 4"), "((N * 2) = 4)");
+  EXPECT_EQ(simplify("(N + 0) * 1 = N"), "");
+  EXPECT_EQ(simplify("(2 > 1) => A"), "A");
+  EXPECT_EQ(simplify("A & (3 < 1)"), "(A & (3 < 1))");
+}
+
+TEST(ConstraintSimplifier, foldWithSolverSemantics) {
+  // Values that do not fit into 64 bits are left to the solver.
+  EXPECT_EQ(simplify("9223372036854775807 + 1 = N"),
+            "((9223372036854775807 + 1) = N)");
+  EXPECT_EQ(simplify("~(0 - 9223372036854775807 - 1) = N"),
+            "(~-9223372036854775808 = N)");
+
+  // Solvers floor divisions, which differs from C++ for negative operands.
+  ConstraintSimplifier S;
+  ConstraintBuilder Positive;
+  Positive.constant(7).divide().constant(2).equal().feature("N");
+  EXPECT_EQ(S.simplify(*Positive.build())->toString(), "(3 = N)");
+  ConstraintBuilder Negative;
+  Negative.neg().constant(7).divide().constant(2).equal().feature("N");
+  EXPECT_EQ(S.simplify(*Negative.build())->toString(), "((-7 / 2) = N)");
+}
+
+TEST(ConstraintSimplifier, equivalence) {
+  llvm::StringMap<int64_t> Values;
+  auto ValueOf = [&Values](const Feature &F) {
+    return Values.lookup(F.getName());
+  };
+
+  for (const auto *Str :
+       {"!(A & (B | !C))", "(A => B) & !(B <=> !C)", "!(!(A | C) => (B & A))",
+        "(A | B) & (!A | C) & (C | B | A)", "!((A <=> B) <=> (C => A))"}) {
+    auto C = parse(Str);
+    ConstraintSimplifier S;
+    auto Simplified = S.simplify(*C);
+    auto Original = FlatConstraint::fromConstraint(*C);
+    for (int Assignment = 0; Assignment < 8; ++Assignment) {
+      Values["A"] = Assignment & 1;
+      Values["B"] = (Assignment >> 1) & 1;
+      Values["C"] = (Assignment >> 2) & 1;
+      bool Expected = *Original.evaluate(ValueOf) != 0;
+      bool Actual =
+          !Simplified ||
+          *FlatConstraint::fromConstraint(*Simplified).evaluate(ValueOf) != 0;
+      EXPECT_EQ(Expected, Actual) << Str << " with " << Assignment;
+    }
+  }
+}
+
+TEST(ConstraintSimplifier, featureTree) {
+  FeatureModelBuilder B;
+  B.makeRoot("root");
+  B.makeFeature<BinaryFeature>("a", true)->addEdge("root", "a");
+  B.makeFeature<BinaryFeature>("b", false)->addEdge("a", "b");
+  B.makeFeature<BinaryFeature>("c", true)->addEdge("a", "c");
+  B.makeFeature<BinaryFeature>("x", false)->addEdge("root", "x");
+  B.makeFeature<BinaryFeature>("x1", true)->addEdge("x", "x1");
+  B.makeFeature<BinaryFeature>("x2", true)->addEdge("x", "x2");
+  B.makeFeature<BinaryFeature>("y", true)->addEdge("x1", "y");
+  B.emplaceRelationship(Relationship::RelationshipKind::RK_ALTERNATIVE, "x");
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  EXPECT_EQ(simplify("b => a", FM.get()), "");
+  EXPECT_EQ(simplify("a => b", FM.get()), "");
+  EXPECT_EQ(simplify("a <=> b", FM.get()), "");
+  EXPECT_EQ(simplify("a => c", FM.get()), "(a => c)");
+  EXPECT_EQ(simplify("x1 => a", FM.get()), "(x1 => a)");
+  EXPECT_EQ(simplify("root & (a | !root)", FM.get()), "a");
+
+  ConstraintSimplifier S(FM.get());
+  ConstraintBuilder CB;
+  CB.feature("y").excludes().feature("x2");
+  EXPECT_FALSE(S.simplify(*CB.build()));
+  ConstraintBuilder Siblings;
+  Siblings.feature("x1").excludes().feature("y");
+  EXPECT_TRUE(S.simplify(*Siblings.build()));
+
+  const auto &R = S.getReport();
+  EXPECT_EQ(R.NumConstraints, 2);
+  EXPECT_EQ(R.NumRemovedConstraints, 1);
+  EXPECT_EQ(R.NumNodes, 6);
+  EXPECT_EQ(R.NumSimplifiedNodes, 3);
+}
+
+} // namespace vara::feature
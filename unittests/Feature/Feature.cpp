@@ -15,6 +15,18 @@ TEST(Feature, equal) {
   EXPECT_NE(A0, B);
 }
 
+TEST(Feature, foldedNameAndHash) {
+  BinaryFeature A0("FooBar");
+  BinaryFeature A1("foobar");
+  BinaryFeature B("Foo");
+
+  EXPECT_EQ(A0.getFoldedName(), "foobar");
+  EXPECT_EQ(A0.getName(), "FooBar");
+  EXPECT_EQ(A0.hash(), A1.hash());
+  EXPECT_EQ(std::hash<Feature>{}(A0), A0.hash());
+  EXPECT_NE(A0.hash(), B.hash());
+}
+
 TEST(Feature, outputString) {
   BinaryFeature F("Foo", false, {}, "--foo");
 
@@ -85,6 +85,101 @@ TEST(FeatureModel, cloneConstraint) {
   EXPECT_TRUE((*Clone->getFeature("a")->constraints().begin())->clone());
 }
 
+TEST(FeatureModel, cloneStructure) {
+  FeatureModelBuilder B;
+  B.makeFeature<BinaryFeature>("a", true, std::vector<FeatureSourceRange>(),
+                               "-a");
+  B.addEdge("a", "aa")->makeFeature<BinaryFeature>("aa");
+  B.addEdge("a", "ab")->makeFeature<BinaryFeature>("ab");
+  B.emplaceRelationship(Relationship::RelationshipKind::RK_ALTERNATIVE, "a");
+  B.makeFeature<NumericFeature>(
+      "n", std::vector<int64_t>{1, 2}, false,
+      std::vector<FeatureSourceRange>(), "",
+      std::make_unique<StepFunction>(StepFunction::StepOperation::ADDITION, 1));
+  B.addConstraint(std::make_unique<FeatureModel::BooleanConstraint>(
+      std::make_unique<ExcludesConstraint>(
+          std::make_unique<PrimaryFeatureConstraint>(
+              std::make_unique<BinaryFeature>("aa")),
+          std::make_unique<PrimaryFeatureConstraint>(
+              std::make_unique<BinaryFeature>("n")))));
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  auto Clone = FM->clone();
+  ASSERT_TRUE(Clone);
+
+  std::vector<std::string> Expected;
+  for (const auto *F : *FM) {
+    Expected.push_back(F->getName().str());
+  }
+  std::vector<std::string> Actual;
+  for (const auto *F : *Clone) {
+    Actual.push_back(F->getName().str());
+  }
+  EXPECT_EQ(Expected, Actual);
+
+  auto *A = Clone->getFeature("a");
+  EXPECT_TRUE(A->isOptional());
+  EXPECT_EQ(A->getOutputString(), "-a");
+  auto *R = llvm::dyn_cast<Relationship>(*A->begin());
+  ASSERT_TRUE(R);
+  EXPECT_EQ(R->getKind(), Relationship::RelationshipKind::RK_ALTERNATIVE);
+  EXPECT_EQ(*R->begin(), Clone->getFeature("aa"));
+  EXPECT_EQ(Clone->getFeature("aa")->getParentFeature(), A);
+
+  auto *N = llvm::dyn_cast<NumericFeature>(Clone->getFeature("n"));
+  ASSERT_TRUE(N);
+  ASSERT_TRUE(N->getStepFunction());
+  EXPECT_NE(N->getStepFunction(),
+            llvm::cast<NumericFeature>(FM->getFeature("n"))->getStepFunction());
+
+  auto *AA = Clone->getFeature("aa");
+  ASSERT_EQ(std::distance(AA->excludes().begin(), AA->excludes().end()), 1);
+  auto *E = *AA->excludes().begin();
+  EXPECT_NE(E, *FM->getFeature("aa")->excludes().begin());
+  auto *RHS = llvm::dyn_cast<PrimaryFeatureConstraint>(E->getRightOperand());
+  ASSERT_TRUE(RHS);
+  EXPECT_EQ(RHS->getFeature(), N);
+  EXPECT_EQ(*N->constraints().begin(), RHS);
+  EXPECT_EQ(RHS->getRoot(), E);
+}
+
+TEST(FeatureModel, memoryUsage) {
+  FeatureModelBuilder B;
+  B.makeFeature<BinaryFeature>("a");
+  B.makeFeature<NumericFeature>("n", std::vector<int64_t>{1, 2, 3});
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  auto Usage = FM->memoryUsage();
+  EXPECT_EQ(Usage.BinaryFeatures.Count, 1);
+  EXPECT_EQ(Usage.NumericFeatures.Count, 1);
+  EXPECT_EQ(Usage.RootFeatures.Count, 1);
+  EXPECT_EQ(Usage.UnknownFeatures.Count, 0);
+  EXPECT_GE(Usage.BinaryFeatures.Bytes, sizeof(BinaryFeature));
+  EXPECT_GE(Usage.NumericFeatures.Bytes,
+            sizeof(NumericFeature) + 3 * sizeof(int64_t));
+  EXPECT_EQ(Usage.SourceRanges, 0);
+  EXPECT_EQ(Usage.Constraints, 0);
+  EXPECT_GT(Usage.FeatureMap, 0);
+  EXPECT_GE(Usage.total(), Usage.features() + Usage.FeatureMap);
+
+  auto FT = FeatureModelModifyTransaction::openTransaction(*FM);
+  FT.addLocation(FM->getFeature("a"),
+                 FeatureSourceRange("some/rather/long/path/to/a/file.cpp"));
+  FT.addConstraint(std::make_unique<FeatureModel::BooleanConstraint>(
+      std::make_unique<NotConstraint>(
+          std::make_unique<PrimaryFeatureConstraint>(
+              std::make_unique<BinaryFeature>("a")))));
+  ASSERT_TRUE(FT.commit());
+
+  auto Modified = FM->memoryUsage();
+  EXPECT_GT(Modified.SourceRanges, sizeof(FeatureSourceRange));
+  EXPECT_GE(Modified.Constraints,
+            sizeof(NotConstraint) + sizeof(PrimaryFeatureConstraint));
+  EXPECT_GT(Modified.total(), Usage.total());
+}
+
 TEST(FeatureModel, size) {
   FeatureModelBuilder B;
 
@@ -124,6 +219,109 @@ TEST_F(FeatureModelTest, iter) {
   }
 }
 
+TEST(FeatureModel, iterAfterModification) {
+  FeatureModelBuilder B;
+  B.makeFeature<BinaryFeature>("b");
+  B.makeFeature<BinaryFeature>("c");
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+  ASSERT_EQ(FM->size(), 3);
+
+  auto FT = FeatureModelModifyTransaction::openTransaction(*FM);
+  FT.addFeature(std::make_unique<BinaryFeature>("A"), FM->getFeature("c"));
+  FT.addFeature(std::make_unique<BinaryFeature>("a"));
+  EXPECT_TRUE(FT.commit());
+
+  std::vector<std::string> Names;
+  for (const auto *F : FM->features()) {
+    Names.push_back(F->getName().str());
+  }
+  EXPECT_EQ(Names, (std::vector<std::string>{"root", "a", "b", "c", "A"}));
+}
+
+TEST_F(FeatureModelTest, treeQueries) {
+  auto *Root = FM->getRoot();
+  auto *A = FM->getFeature("a");
+  auto *AA = FM->getFeature("aa");
+  auto *AB = FM->getFeature("ab");
+  auto *BB = FM->getFeature("bb");
+
+  EXPECT_TRUE(Root->isAncestorOf(*BB));
+  EXPECT_TRUE(A->isAncestorOf(*AA));
+  EXPECT_FALSE(AA->isAncestorOf(*A));
+  EXPECT_FALSE(A->isAncestorOf(*A));
+  EXPECT_FALSE(A->isAncestorOf(*BB));
+
+  EXPECT_EQ(Root->getSubtreeSize(), FM->size());
+  EXPECT_EQ(A->getSubtreeSize(), 3);
+  EXPECT_EQ(AA->getSubtreeSize(), 1);
+
+  EXPECT_EQ(AA->getLowestCommonAncestor(*AB), A);
+  EXPECT_EQ(AA->getLowestCommonAncestor(*A), A);
+  EXPECT_EQ(AA->getLowestCommonAncestor(*BB), Root);
+  EXPECT_EQ(AA->getLowestCommonAncestor(*AA), AA);
+
+  EXPECT_TRUE(std::is_sorted(FM->begin(), FM->end(),
+                             [](const Feature *L, const Feature *R) {
+                               return *L < *R;
+                             }));
+}
+
+TEST(FeatureModel, lowestCommonAncestorInDeepTree) {
+  // Two chains of different length below a common stem.
+  FeatureModelBuilder B;
+  std::string Parent = "root";
+  for (int I = 0; I < 20; ++I) {
+    auto Name = "s" + std::to_string(I);
+    B.makeFeature<BinaryFeature>(Name)->addEdge(Parent, Name);
+    Parent = Name;
+  }
+  for (const auto &[Prefix, Length] : {std::pair{"l", 37}, std::pair{"r", 5}}) {
+    Parent = "s19";
+    for (int I = 0; I < Length; ++I) {
+      auto Name = Prefix + std::to_string(I);
+      B.makeFeature<BinaryFeature>(Name)->addEdge(Parent, Name);
+      Parent = Name;
+    }
+  }
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+  auto *Stem = FM->getFeature("s19");
+  auto *Left = FM->getFeature("l36");
+  auto *Right = FM->getFeature("r4");
+
+  EXPECT_EQ(Left->getLowestCommonAncestor(*Right), Stem);
+  EXPECT_EQ(Right->getLowestCommonAncestor(*Left), Stem);
+  EXPECT_EQ(Left->getLowestCommonAncestor(*FM->getFeature("l20")),
+            FM->getFeature("l20"));
+  EXPECT_EQ(FM->getFeature("l20")->getLowestCommonAncestor(*Left),
+            FM->getFeature("l20"));
+  EXPECT_EQ(Left->getLowestCommonAncestor(*FM->getFeature("s3")),
+            FM->getFeature("s3"));
+  EXPECT_EQ(Right->getLowestCommonAncestor(*FM->getRoot()), FM->getRoot());
+}
+
+TEST(FeatureModel, treeQueriesAfterModification) {
+  FeatureModelBuilder B;
+  B.makeFeature<BinaryFeature>("a");
+  B.makeFeature<BinaryFeature>("b");
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+  auto *A = FM->getFeature("a");
+  auto *Bf = FM->getFeature("b");
+  EXPECT_LT(*A, *Bf);
+
+  auto FT = FeatureModelModifyTransaction::openTransaction(*FM);
+  FT.addFeature(std::make_unique<BinaryFeature>("c"), A);
+  EXPECT_TRUE(FT.commit());
+
+  auto *C = FM->getFeature("c");
+  EXPECT_TRUE(A->isAncestorOf(*C));
+  EXPECT_EQ(A->getSubtreeSize(), 2);
+  EXPECT_LT(*C, *Bf);
+  EXPECT_LT(*A, *C);
+}
+
 TEST_F(FeatureModelTest, disjunct) {
   FeatureModelBuilder B;
   B.makeFeature<BinaryFeature>("a");
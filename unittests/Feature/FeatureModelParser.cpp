@@ -1,7 +1,10 @@
 #include "vara/Feature/FeatureModelParser.h"
+#include "vara/Feature/FeatureModelTransaction.h"
+#include "vara/Feature/FeatureModelWriter.h"
 
 #include "Utils/UnittestHelper.h"
 
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/MemoryBuffer.h"
 
 #include "gmock/gmock.h"
@@ -154,6 +157,23 @@ TEST(FeatureModelParser, mixedConstraint) {
             FeatureModel::MixedConstraint::ExprKind::POS);
 }
 
+TEST(FeatureModelParser, constraintsReferToModelFeatures) {
+  auto FM = buildFeatureModel("test_constraints.xml");
+  ASSERT_TRUE(FM);
+
+  auto *Or = llvm::cast<OrConstraint>(
+      FM->booleanConstraints().begin()->constraint()->getRoot());
+  EXPECT_EQ(
+      llvm::cast<PrimaryFeatureConstraint>(Or->getLeftOperand())->getFeature(),
+      FM->getFeature("A"));
+  auto *Equal = llvm::cast<EqualConstraint>(
+      FM->mixedConstraints().begin()->constraint()->getRoot());
+  auto *Mul = llvm::cast<MultiplicationConstraint>(Equal->getLeftOperand());
+  EXPECT_EQ(llvm::cast<PrimaryFeatureConstraint>(Mul->getRightOperand())
+                ->getFeature(),
+            FM->getFeature("B"));
+}
+
 TEST(FeatureModelParser, memberOffset) {
   auto FM = buildFeatureModel("test_member_offset.xml");
   ASSERT_TRUE(FM);
@@ -255,6 +275,71 @@ TEST(FeatureModelParser, detectXMLAlternativesBroken) {
   EXPECT_TRUE(FM->getFeature("a")->hasEdgeTo(*FM->getFeature("ab")));
 }
 
+TEST(FeatureModelParser, detectXMLAlternativesWide) {
+  FeatureModelBuilder B;
+  B.makeFeature<BinaryFeature>("a");
+  B.makeFeature<BinaryFeature>("b");
+  std::vector<std::string> Names;
+  for (int I = 0; I < 40; ++I) {
+    Names.push_back("a" + std::to_string(I));
+    B.makeFeature<BinaryFeature>(Names.back(), false)->addEdge("a",
+                                                               Names.back());
+    B.makeFeature<BinaryFeature>("b" + Names.back(), false)
+        ->addEdge("b", "b" + Names.back());
+  }
+  for (const auto &L : Names) {
+    for (const auto &R : Names) {
+      if (L != R) {
+        B.addConstraint(createBinaryConstraint<ExcludesConstraint>(L, R));
+        // Group b misses a single exclude and must not be detected.
+        if (L != "a0" || R != "a1") {
+          B.addConstraint(
+              createBinaryConstraint<ExcludesConstraint>("b" + L, "b" + R));
+        }
+      }
+    }
+    // Duplicates must not be counted twice.
+    B.addConstraint(createBinaryConstraint<ExcludesConstraint>("ba0", "ba2"));
+  }
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  ASSERT_TRUE(FeatureModelXmlParser::detectXMLAlternatives(*FM));
+
+  EXPECT_TRUE(llvm::isa<Relationship>(*FM->getFeature("a")->begin()));
+  EXPECT_FALSE(llvm::isa<Relationship>(*FM->getFeature("b")->begin()));
+}
+
+TEST(FeatureModelParser, detectXMLAlternativesIgnoresGroupedFeatures) {
+  FeatureModelBuilder B;
+  B.makeFeature<BinaryFeature>("a");
+  B.makeFeature<BinaryFeature>("ga", false)->addEdge("a", "ga");
+  B.makeFeature<BinaryFeature>("gb", false)->addEdge("a", "gb");
+  B.emplaceRelationship(Relationship::RelationshipKind::RK_OR, "a");
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  // Direct children of a, all children exclude each other.
+  auto FT = FeatureModelModifyTransaction::openTransaction(*FM);
+  FT.addFeature(std::make_unique<BinaryFeature>("x", false),
+                FM->getFeature("a"));
+  FT.addFeature(std::make_unique<BinaryFeature>("y", false),
+                FM->getFeature("a"));
+  for (const auto *L : {"ga", "gb", "x", "y"}) {
+    for (const auto *R : {"ga", "gb", "x", "y"}) {
+      if (std::string(L) != R) {
+        FT.addConstraint(createBinaryConstraint<ExcludesConstraint>(L, R));
+      }
+    }
+  }
+  ASSERT_TRUE(FT.commit());
+
+  ASSERT_TRUE(FeatureModelXmlParser::detectXMLAlternatives(*FM));
+
+  EXPECT_TRUE(FM->getFeature("a")->hasEdgeTo(*FM->getFeature("x")));
+  EXPECT_TRUE(FM->getFeature("a")->hasEdgeTo(*FM->getFeature("y")));
+}
+
 TEST(FeatureModelParser, detectXMLAlternativesOptionalBroken) {
   FeatureModelBuilder B;
   B.makeFeature<BinaryFeature>("a");
@@ -310,4 +395,408 @@ TEST(FeatureModelParser, detectXMLAlternativesOutOfOrder) {
   }
 }
 
+//===----------------------------------------------------------------------===//
+//                        XmlStreamParser
+//===----------------------------------------------------------------------===//
+
+std::string readTestResource(llvm::StringRef Path) {
+  auto FS = llvm::MemoryBuffer::getFileAsStream(getTestResource(Path));
+  assert(FS);
+  return FS.get()->getBuffer().str();
+}
+
+class FeatureModelXmlStreamParserTest
+    : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(FeatureModelXmlStreamParserTest, sameAsDomParser) {
+  auto Xml = readTestResource(GetParam());
+  auto Expected = FeatureModelXmlParser(Xml).buildFeatureModel();
+  FeatureModelXmlStreamParser P(Xml);
+  // Inconsistent edges are already detected while streaming.
+  if (!FeatureModelXmlParser(Xml).verifyFeatureModel()) {
+    EXPECT_FALSE(P.verifyFeatureModel());
+  }
+  auto Actual = P.buildFeatureModel();
+
+  ASSERT_EQ(bool(Expected), bool(Actual));
+  if (Expected) {
+    EXPECT_EQ(FeatureModelXmlWriter(*Expected).writeFeatureModel(),
+              FeatureModelXmlWriter(*Actual).writeFeatureModel());
+  }
+}
+
+TEST_P(FeatureModelXmlStreamParserTest, sameFromFile) {
+  auto Expected = FeatureModelXmlStreamParser(readTestResource(GetParam()))
+                      .buildFeatureModel();
+  auto Actual =
+      FeatureModelXmlStreamParser::fromFile(getTestResource(GetParam()))
+          ->buildFeatureModel();
+
+  ASSERT_EQ(bool(Expected), bool(Actual));
+  if (Expected) {
+    EXPECT_EQ(FeatureModelXmlWriter(*Expected).writeFeatureModel(),
+              FeatureModelXmlWriter(*Actual).writeFeatureModel());
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    FeatureModelParser, FeatureModelXmlStreamParserTest,
+    ::testing::Values(
+        "test.xml", "test_children.xml", "test_constraints.xml",
+        "test_dune_bin.xml", "test_dune_num.xml", "test_dune_num_explicit.xml",
+        "test_excludes.xml", "test_hipacc_bin.xml", "test_hipacc_num.xml",
+        "test_hsqldb_num.xml", "test_member_offset.xml",
+        "test_mixed_constraints.xml", "test_msmr.xml", "test_numbers.xml",
+        "test_only_children.xml", "test_only_parents.xml",
+        "test_out_of_order.xml", "test_output_string.xml",
+        "test_revision_range.xml", "test_step_function.xml",
+        "test_three_optional_features.xml", "test_with_whitespaces.xml",
+        "error_mismatch_parent_child.xml", "error_missing_child.xml",
+        "error_missing_exclude.xml", "error_missing_implication.xml",
+        "error_missing_parent.xml", "error_root_root.xml"));
+
+TEST(FeatureModelXmlStreamParser, constraintsReferToModelFeatures) {
+  std::unique_ptr<const FeatureModel> FM =
+      FeatureModelXmlStreamParser(readTestResource("test_constraints.xml"))
+          .buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  auto *Or = llvm::cast<OrConstraint>(
+      FM->booleanConstraints().begin()->constraint()->getRoot());
+  EXPECT_EQ(
+      llvm::cast<PrimaryFeatureConstraint>(Or->getRightOperand())->getFeature(),
+      FM->getFeature("B"));
+}
+
+TEST(FeatureModelXmlStreamParser, rejectUnexpectedElement) {
+  EXPECT_FALSE(FeatureModelXmlStreamParser(
+                   "<vm name=\"a\"><binaryOptions><constraint>a</constraint>"
+                   "</binaryOptions></vm>")
+                   .verifyFeatureModel());
+}
+
+TEST(FeatureModelXmlStreamParser, rejectMalformed) {
+  EXPECT_FALSE(
+      FeatureModelXmlStreamParser("<vm name=\"a\"><binaryOptions></vm>")
+          .buildFeatureModel());
+}
+
+TEST(FeatureModelXmlStreamParser, rejectMissingFile) {
+  auto P = FeatureModelXmlStreamParser::fromFile(
+      getTestResource("does_not_exist.xml"));
+  EXPECT_FALSE(P->verifyFeatureModel());
+  EXPECT_FALSE(P->buildFeatureModel());
+}
+
+TEST(FeatureModelXmlStreamParser, rejectMissingName) {
+  EXPECT_FALSE(FeatureModelXmlStreamParser(
+                   "<vm name=\"a\"><binaryOptions><configurationOption>"
+                   "<optional>True</optional></configurationOption>"
+                   "</binaryOptions></vm>")
+                   .verifyFeatureModel());
+}
+
+//===----------------------------------------------------------------------===//
+//                        Trusted input
+//===----------------------------------------------------------------------===//
+
+TEST(FeatureModelXmlParser, trustedChecksummedInput) {
+  auto FM = FeatureModelXmlParser(readTestResource("test_dune_num.xml"))
+                .buildFeatureModel();
+  ASSERT_TRUE(FM);
+  auto Xml = FeatureModelXmlWriter(*FM, true).writeFeatureModel();
+  ASSERT_TRUE(Xml);
+
+  FeatureModelXmlParser P(*Xml, true);
+  EXPECT_TRUE(P.verifyFeatureModel());
+  auto Trusted = P.buildFeatureModel();
+  ASSERT_TRUE(Trusted);
+  EXPECT_EQ(FeatureModelXmlWriter(*FM).writeFeatureModel(),
+            FeatureModelXmlWriter(*Trusted).writeFeatureModel());
+}
+
+TEST(FeatureModelXmlParser, trustedTamperedInputIsValidated) {
+  auto FM = FeatureModelXmlParser(readTestResource("test_children.xml"))
+                .buildFeatureModel();
+  ASSERT_TRUE(FM);
+  auto Xml = FeatureModelXmlWriter(*FM, true).writeFeatureModel();
+  ASSERT_TRUE(Xml);
+
+  // Breaks the checksum as well as the DTD.
+  std::string Tampered = *Xml;
+  auto Pos = Tampered.find("<binaryOptions>");
+  ASSERT_NE(Pos, std::string::npos);
+  Tampered.insert(Pos, "<unexpected/>");
+
+  EXPECT_FALSE(FeatureModelXmlParser(Tampered, true).verifyFeatureModel());
+  EXPECT_FALSE(FeatureModelXmlParser(Tampered, true).buildFeatureModel());
+}
+
+//===----------------------------------------------------------------------===//
+//                        Diagnostics
+//===----------------------------------------------------------------------===//
+
+TEST(FeatureModelXmlParser, loadWithDiagnostics) {
+  auto Loaded = loadFeatureModel(getTestResource("test_children.xml"), {});
+  ASSERT_TRUE(Loaded);
+  EXPECT_EQ(Loaded.extractValue()->getName(), "Children");
+}
+
+TEST(FeatureModelXmlParser, diagnoseInconsistentModel) {
+  auto Loaded =
+      loadFeatureModel(getTestResource("error_mismatch_parent_child.xml"), {});
+  ASSERT_FALSE(Loaded);
+  auto Diagnostics = Loaded.extractError();
+  ASSERT_EQ(Diagnostics.size(), 1);
+  EXPECT_EQ(Diagnostics[0].Line, 36);
+  EXPECT_EQ(Diagnostics[0].Message,
+            "Ambiguous edge to Error from either 'C' or 'root'.");
+}
+
+TEST(FeatureModelXmlParser, diagnoseDtdViolation) {
+  auto Loaded = FeatureModelXmlParser("<vm name=\"a\">\n<binaryOptions/>\n"
+                                      "<unexpected/>\n</vm>")
+                    .buildVerifiedFeatureModel();
+  ASSERT_FALSE(Loaded);
+  auto Diagnostics = Loaded.extractError();
+  EXPECT_TRUE(std::any_of(Diagnostics.begin(), Diagnostics.end(),
+                          [](const auto &D) { return D.Line == 3; }));
+  EXPECT_EQ(Diagnostics.back().Message, "Failed to validate DTD.");
+}
+
+TEST(FeatureModelXmlParser, diagnoseMalformedXml) {
+  auto Loaded =
+      FeatureModelXmlParser("<vm name=\"a\">\n<binaryOptions>\n</vm>")
+          .buildVerifiedFeatureModel();
+  ASSERT_FALSE(Loaded);
+  auto Diagnostics = Loaded.extractError();
+  EXPECT_GE(Diagnostics.size(), 2);
+  EXPECT_EQ(Diagnostics.front().Line, 3);
+  EXPECT_EQ(Diagnostics.back().Message, "Failed to parse / validate XML.");
+}
+
+TEST(FeatureModelXmlParser, diagnoseNestedParserErrors) {
+  auto Loaded =
+      FeatureModelXmlParser(
+          "<vm name=\"a\">\n<binaryOptions>\n<configurationOption>\n"
+          "<name>root</name>\n</configurationOption>\n</binaryOptions>\n"
+          "<numericOptions>\n<configurationOption>\n<name>A</name>\n"
+          "<parent>root</parent>\n<minValue>abc</minValue>\n"
+          "<maxValue>1</maxValue>\n</configurationOption>\n"
+          "</numericOptions>\n<booleanConstraints>\n"
+          "<constraint>(A |</constraint>\n</booleanConstraints>\n</vm>")
+          .buildVerifiedFeatureModel();
+  ASSERT_FALSE(Loaded);
+  auto Diagnostics = Loaded.extractError();
+  ASSERT_EQ(Diagnostics.size(), 4);
+  EXPECT_EQ(Diagnostics[0].Message,
+            "Failed to parse integer 'abc' in line 11.");
+  EXPECT_EQ(Diagnostics[1].Message,
+            "Syntax error: Unexpected end of unary expression.");
+  EXPECT_EQ(Diagnostics[2].Message,
+            "Syntax error: Missing closing parenthesis.");
+  EXPECT_EQ(Diagnostics[3].Line, 16);
+  EXPECT_EQ(Diagnostics[3].Message, "Invalid constraint.");
+}
+
+TEST(FeatureModelXmlParser, diagnosticsKeepErrorHandler) {
+  unsigned Reported = 0;
+  xmlSetStructuredErrorFunc(&Reported, [](void *Data, auto * /*E*/) {
+    ++*static_cast<unsigned *>(Data);
+  });
+  auto Loaded = FeatureModelXmlParser("<vm name=\"a\">\n</binaryOptions>")
+                    .buildVerifiedFeatureModel();
+  EXPECT_FALSE(Loaded);
+  EXPECT_EQ(Reported, 0);
+
+  xmlFreeDoc(xmlParseDoc(reinterpret_cast<const xmlChar *>("<unterminated")));
+  EXPECT_GT(Reported, 0);
+  xmlSetStructuredErrorFunc(nullptr, nullptr);
+}
+
+TEST(FeatureModelXmlParser, diagnoseMissingFile) {
+  auto Loaded = loadFeatureModel(getTestResource("does_not_exist.xml"), {});
+  ASSERT_FALSE(Loaded);
+  EXPECT_EQ(Loaded.extractError().size(), 1);
+}
+
+TEST(FeatureModelXmlParser, loadManyConcurrently) {
+  std::vector<std::string> Paths;
+  for (int I = 0; I < 8; ++I) {
+    Paths.push_back(getTestResource("test_dune_num.xml"));
+    Paths.push_back(getTestResource("error_missing_parent.xml"));
+    Paths.push_back(getTestResource("does_not_exist.xml"));
+    Paths.push_back(getTestResource("test_msmr.xml"));
+  }
+  auto Expected = FeatureModelXmlWriter(
+                      *loadFeatureModel(getTestResource("test_dune_num.xml")))
+                      .writeFeatureModel();
+
+  auto Results = loadFeatureModels(Paths, 4);
+  ASSERT_EQ(Results.size(), Paths.size());
+  for (size_t I = 0; I < Results.size(); I += 4) {
+    ASSERT_TRUE(Results[I]);
+    EXPECT_EQ(FeatureModelXmlWriter(*Results[I].extractValue())
+                  .writeFeatureModel(),
+              Expected);
+    EXPECT_FALSE(Results[I + 1]);
+    EXPECT_FALSE(Results[I + 2]);
+    ASSERT_TRUE(Results[I + 3]);
+    EXPECT_EQ(Results[I + 3].extractValue()->getName(), "SingleLocalSingle");
+  }
+}
+
+//===----------------------------------------------------------------------===//
+//                        Buffers
+//===----------------------------------------------------------------------===//
+
+TEST(FeatureModelXmlParser, parseUnterminatedBuffer) {
+  auto Xml = readTestResource("test_children.xml");
+  auto Expected = FeatureModelXmlParser(Xml).buildFeatureModel();
+  ASSERT_TRUE(Expected);
+
+  // Trailing garbage outside of the buffer must not be read.
+  std::string Padded = Xml + "<garbage>";
+  auto Buffer = llvm::MemoryBuffer::getMemBuffer(
+      llvm::StringRef(Padded).take_front(Xml.size()), "test_children.xml",
+      /*RequiresNullTerminator=*/false);
+  auto FM = FeatureModelXmlParser(std::move(Buffer)).buildFeatureModel();
+  ASSERT_TRUE(FM);
+  EXPECT_EQ(FeatureModelXmlWriter(*Expected).writeFeatureModel(),
+            FeatureModelXmlWriter(*FM).writeFeatureModel());
+
+  auto StreamBuffer = llvm::MemoryBuffer::getMemBuffer(
+      llvm::StringRef(Padded).take_front(Xml.size()), "test_children.xml",
+      /*RequiresNullTerminator=*/false);
+  EXPECT_TRUE(FeatureModelXmlStreamParser(std::move(StreamBuffer))
+                  .buildFeatureModel());
+}
+
+TEST(FeatureModelXmlParser, loadFromBuffer) {
+  auto FM = loadFeatureModelFromBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy(readTestResource("test.xml")));
+  ASSERT_TRUE(FM);
+  EXPECT_EQ(FM->getName(), "ABC");
+}
+
+//===----------------------------------------------------------------------===//
+//                        BinaryParser
+//===----------------------------------------------------------------------===//
+
+std::string writeBinary(llvm::StringRef Path) {
+  auto FM = FeatureModelXmlParser(readTestResource(Path)).buildFeatureModel();
+  assert(FM);
+  auto Binary = FeatureModelBinaryWriter(*FM).writeFeatureModel();
+  assert(Binary);
+  return *Binary;
+}
+
+class FeatureModelBinaryParserTest
+    : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(FeatureModelBinaryParserTest, roundTrip) {
+  auto Expected =
+      FeatureModelXmlParser(readTestResource(GetParam())).buildFeatureModel();
+  ASSERT_TRUE(Expected);
+  auto Binary = FeatureModelBinaryWriter(*Expected).writeFeatureModel();
+  ASSERT_TRUE(Binary);
+  ASSERT_TRUE(FeatureModelBinaryParser::isBinaryFeatureModel(*Binary));
+  auto Actual = FeatureModelBinaryParser(*Binary).buildFeatureModel();
+  ASSERT_TRUE(Actual);
+
+  EXPECT_EQ(FeatureModelXmlWriter(*Expected).writeFeatureModel(),
+            FeatureModelXmlWriter(*Actual).writeFeatureModel());
+  EXPECT_EQ(Expected->getPath(), Actual->getPath());
+  EXPECT_EQ(Expected->getCommit(), Actual->getCommit());
+
+  // Not all details are part of the xml output, so compare them directly.
+  for (const auto *Ordered : Expected->features()) {
+    auto *F = Expected->getFeature(Ordered->getName());
+    auto *G = Actual->getFeature(Ordered->getName());
+    ASSERT_TRUE(G);
+    EXPECT_EQ(F->getOutputString(), G->getOutputString());
+    EXPECT_EQ(llvm::size(F->constraints()), llvm::size(G->constraints()));
+
+    std::vector<FeatureSourceRange> FLocations(F->getLocations().begin(),
+                                               F->getLocations().end());
+    std::vector<FeatureSourceRange> GLocations(G->getLocations().begin(),
+                                               G->getLocations().end());
+    ASSERT_EQ(FLocations, GLocations);
+    for (size_t I = 0; I < FLocations.size(); ++I) {
+      ASSERT_EQ(FLocations[I].hasRevisionRange(),
+                GLocations[I].hasRevisionRange());
+      if (FLocations[I].hasRevisionRange()) {
+        EXPECT_EQ(FLocations[I].revisionRange()->introducingCommit(),
+                  GLocations[I].revisionRange()->introducingCommit());
+        EXPECT_EQ(FLocations[I].revisionRange()->removingCommit(),
+                  GLocations[I].revisionRange()->removingCommit());
+      }
+    }
+
+    if (auto *N = llvm::dyn_cast<NumericFeature>(F)) {
+      auto *M = llvm::dyn_cast<NumericFeature>(G);
+      ASSERT_TRUE(M);
+      ASSERT_EQ(bool(N->getStepFunction()), bool(M->getStepFunction()));
+      if (N->getStepFunction()) {
+        EXPECT_EQ(N->getStepFunction()->toString(),
+                  M->getStepFunction()->toString());
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    FeatureModelParser, FeatureModelBinaryParserTest,
+    ::testing::Values(
+        "test.xml", "test_children.xml", "test_constraints.xml",
+        "test_dune_bin.xml", "test_dune_num.xml", "test_dune_num_explicit.xml",
+        "test_excludes.xml", "test_hipacc_bin.xml", "test_hipacc_num.xml",
+        "test_hsqldb_num.xml", "test_locations.xml", "test_member_offset.xml",
+        "test_mixed_constraints.xml", "test_msmr.xml", "test_numbers.xml",
+        "test_only_children.xml", "test_only_parents.xml",
+        "test_out_of_order.xml", "test_output_string.xml",
+        "test_revision_range.xml", "test_step_function.xml",
+        "test_three_optional_features.xml", "test_with_whitespaces.xml"));
+
+TEST(FeatureModelBinaryParser, rejectOtherVersion) {
+  auto Binary = writeBinary("test_constraints.xml");
+  Binary[4] = 42;
+
+  auto FM = FeatureModelBinaryParser(Binary).buildVerifiedFeatureModel();
+  ASSERT_FALSE(FM);
+  EXPECT_THAT(FM.extractError().front().Message,
+              testing::HasSubstr("version 42 is not supported"));
+}
+
+TEST(FeatureModelBinaryParser, rejectTruncated) {
+  auto Binary = writeBinary("test_constraints.xml");
+  for (size_t Size : {size_t(0), size_t(4), Binary.size() / 2,
+                      Binary.size() - 1}) {
+    EXPECT_FALSE(FeatureModelBinaryParser(Binary.substr(0, Size))
+                     .buildVerifiedFeatureModel());
+  }
+  EXPECT_FALSE(FeatureModelBinaryParser(Binary + "x").verifyFeatureModel());
+}
+
+TEST(FeatureModelBinaryParser, rejectUnknownConstraintKind) {
+  auto Binary = writeBinary("test_constraints.xml");
+  // The last constraint node precedes the string table, whose size is the
+  // last field of the header, and is the root operator of its constraint.
+  size_t StringTableSize = llvm::support::endian::read32le(Binary.data() + 52);
+  llvm::support::endian::write32le(
+      Binary.data() + Binary.size() - StringTableSize - 12, 200);
+
+  auto FM = FeatureModelBinaryParser(Binary).buildVerifiedFeatureModel();
+  ASSERT_FALSE(FM);
+  EXPECT_THAT(FM.extractError().front().Message,
+              testing::HasSubstr("malformed constraint"));
+}
+
+TEST(FeatureModelBinaryParser, loadFromBuffer) {
+  auto FM = loadFeatureModelFromBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy(writeBinary("test.xml")));
+  ASSERT_TRUE(FM);
+  EXPECT_EQ(FM->getName(), "ABC");
+}
+
 } // namespace vara::feature
@@ -93,4 +93,39 @@ TEST(SxfmParser, wrong_xml_format) {
   EXPECT_FALSE(FM.verifyFeatureModel());
 }
 
+/// Check that deep chains and wide or groups are attached to the right parents
+/// and that constraints refer to features by their identifiers.
+TEST(SxfmParser, deepAndWideTree) {
+  std::string Tree = ":r root (id_root)\n";
+  for (int I = 1; I <= 200; ++I) {
+    Tree += std::string(I, '\t') + ":m d" + std::to_string(I) + " (id_d" +
+            std::to_string(I) + ")\n";
+  }
+  Tree += "\t:g [1,*] grp\n";
+  for (int I = 0; I < 500; ++I) {
+    Tree += "\t\t: w" + std::to_string(I) + " (id_w" + std::to_string(I) +
+            ")\r\n";
+  }
+  auto FM = FeatureModelSxfmParser(
+                "<feature_model name=\"Deep\">\n<feature_tree>\n" + Tree +
+                "</feature_tree>\n<constraints>\nc1: ~id_d200 or id_w499\n"
+                "</constraints>\n</feature_model>\n")
+                .buildFeatureModel();
+  ASSERT_TRUE(FM);
+  EXPECT_EQ(FM->size(), 702);
+
+  EXPECT_EQ(FM->getFeature("d200")->getParentFeature(), FM->getFeature("d199"));
+  EXPECT_EQ(FM->getFeature("d1")->getParentFeature(), FM->getFeature("root"));
+  EXPECT_EQ(FM->getFeature("grp")->getParentFeature(), FM->getFeature("root"));
+  EXPECT_EQ(FM->getFeature("w499")->getParentFeature(), FM->getFeature("grp"));
+  auto Groups = FM->getFeature("grp")->getChildren<Relationship>();
+  ASSERT_EQ(Groups.size(), 1);
+  EXPECT_EQ((*Groups.begin())->getKind(),
+            Relationship::RelationshipKind::RK_OR);
+
+  auto Constraints = FM->getFeature("w499")->constraints();
+  ASSERT_EQ(std::distance(Constraints.begin(), Constraints.end()), 1);
+  EXPECT_EQ((*Constraints.begin())->getRoot()->toString(), "(~d200 | w499)");
+}
+
 } // namespace vara::feature
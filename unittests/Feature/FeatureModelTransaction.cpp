@@ -155,6 +155,40 @@ TEST_F(FeatureModelTransactionCopyTest, addFeatureToModelThenAbort) {
   EXPECT_FALSE(FM->getFeature("ab")); // Change should not be visible
 }
 
+TEST_F(FeatureModelTransactionCopyTest, abortWithoutChange) {
+  auto FT = FeatureModelCopyTransaction::openTransaction(*FM);
+  FT.abort();
+
+  auto E = FT.commit();
+  ASSERT_FALSE(E);
+  EXPECT_EQ(E.getError(), ABORTED);
+}
+
+TEST_F(FeatureModelTransactionCopyTest, commitWithoutChangeCopies) {
+  auto FT = FeatureModelCopyTransaction::openTransaction(*FM);
+  auto E = FT.commit();
+  ASSERT_TRUE(E);
+  auto NewFM = E.extractValue();
+
+  ASSERT_TRUE(NewFM);
+  EXPECT_EQ(NewFM->size(), FM->size());
+  EXPECT_TRUE(NewFM->getFeature("a"));
+  EXPECT_NE(NewFM->getFeature("a"), FM->getFeature("a"));
+}
+
+TEST_F(FeatureModelTransactionCopyTest, changedSourceDoesNotLeak) {
+  auto FT = FeatureModelCopyTransaction::openTransaction(*FM);
+  auto MT = FeatureModelModifyTransaction::openTransaction(*FM);
+  MT.addFeature(std::make_unique<BinaryFeature>("ab"), FM->getFeature("a"));
+  ASSERT_TRUE(MT.commit());
+
+  auto E = FT.commit();
+  ASSERT_TRUE(E);
+  auto NewFM = E.extractValue();
+  EXPECT_TRUE(FM->getFeature("ab"));
+  EXPECT_FALSE(NewFM->getFeature("ab"));
+}
+
 //===----------------------------------------------------------------------===//
 //                    FeatureModelModifyTransaction Tests
 //===----------------------------------------------------------------------===//
@@ -80,4 +80,23 @@ TEST(XmlWriter, test) {
   EXPECT_EQ(ExpectedOutput, ActualOutput);
 }
 
+TEST(XmlWriter, checksum) {
+  auto FS =
+      llvm::MemoryBuffer::getFileAsStream(getTestResource("test_children.xml"));
+  EXPECT_TRUE(FS && "Input file could not be read");
+  auto FM =
+      FeatureModelXmlParser(FS.get()->getBuffer().str()).buildFeatureModel();
+
+  auto Plain = FeatureModelXmlWriter(*FM).writeFeatureModel();
+  auto Checked = FeatureModelXmlWriter(*FM, true).writeFeatureModel();
+  ASSERT_TRUE(Plain.has_value());
+  ASSERT_TRUE(Checked.has_value());
+
+  // The checksum is a trailing comment, the document itself is unchanged.
+  EXPECT_TRUE(llvm::StringRef(*Checked).startswith(*Plain));
+  EXPECT_TRUE(llvm::StringRef(*Checked)
+                  .drop_front(Plain->size())
+                  .startswith("<!-- vara-checksum: "));
+}
+
 } // namespace vara::feature
@@ -1,4 +1,5 @@
 #include "vara/Feature/FeatureModelBuilder.h"
+#include "vara/Feature/FeatureModelTransaction.h"
 
 #include "gtest/gtest.h"
 
@@ -55,4 +56,52 @@ TEST_F(FeatureTreeNodeTest, getChildrenNone) {
   EXPECT_EQ(FM->getFeature("a")->getChildren<Relationship>(42).size(), 0);
 }
 
+TEST_F(FeatureTreeNodeTest, childrenKeepInsertionOrder) {
+  B.addEdge("a", "ac")->makeFeature<BinaryFeature>("ac");
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  auto *A = FM->getFeature("a");
+  std::vector<std::string> Names;
+  for (auto *C : A->children()) {
+    Names.push_back(llvm::cast<Feature>(C)->getName().str());
+  }
+  EXPECT_EQ(Names, (std::vector<std::string>{"aa", "ab", "ac"}));
+  EXPECT_TRUE(A->hasEdgeTo(*FM->getFeature("ab")));
+  EXPECT_FALSE(A->hasEdgeTo(*FM->getFeature("a")));
+}
+
+TEST_F(FeatureTreeNodeTest, edgesMirrorParents) {
+  B.emplaceRelationship(Relationship::RelationshipKind::RK_OR, "a");
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+  auto *A = FM->getFeature("a");
+  auto *AA = FM->getFeature("aa");
+  auto *R = *A->getChildren<Relationship>().begin();
+
+  // Every node reachable from the root is a child of its parent exactly once.
+  size_t Visited = 0;
+  llvm::SmallVector<FeatureTreeNode *, 8> Stack{FM->getRoot()};
+  while (!Stack.empty()) {
+    auto *N = Stack.pop_back_val();
+    ++Visited;
+    for (auto *C : N->children()) {
+      EXPECT_EQ(C->getParent(), N);
+      EXPECT_EQ(std::count(N->begin(), N->end(), C), 1);
+      Stack.push_back(C);
+    }
+  }
+  EXPECT_EQ(Visited, FM->size() + 1);
+
+  // Moving a child updates both sides, adding it again changes nothing.
+  auto T = FeatureModelModifyTransaction::openTransaction(*FM);
+  T.addChild(A, AA);
+  T.addChild(A, AA);
+  ASSERT_TRUE(T.commit());
+  EXPECT_EQ(AA->getParent(), A);
+  EXPECT_EQ(std::count(A->begin(), A->end(), AA), 1);
+  EXPECT_FALSE(R->hasEdgeTo(*AA));
+  EXPECT_EQ(std::distance(R->begin(), R->end()), 1);
+}
+
 } // namespace vara::feature
@@ -0,0 +1,116 @@
+#include "vara/Feature/FlatConstraint.h"
+#include "vara/Feature/ConstraintParser.h"
+#include "vara/Feature/Feature.h"
+
+#include "llvm/ADT/StringMap.h"
+
+#include "gtest/gtest.h"
+
+namespace vara::feature {
+
+static std::unique_ptr<Constraint> parse(llvm::StringRef Str) {
+  auto C = ConstraintParser(Str.str()).buildConstraint();
+  assert(C);
+  return C;
+}
+
+TEST(FlatConstraint, roundTrip) {
+  for (const auto *Str : {"A", "42", "!A", "~A", "(A => (B | !C))",
+                          "((A + 2) * B) >= (~C - 3)",
+                          "((A <=> B) | (C & (D => E)))"}) {
+    auto C = parse(Str);
+    auto Flat = FlatConstraint::fromConstraint(*C);
+
+    EXPECT_TRUE(Flat.isComplete());
+    EXPECT_EQ(Flat.toConstraint()->toString(), C->toString()) << Str;
+  }
+}
+
+TEST(FlatConstraint, postOrder) {
+  auto C = parse("(A & !B) | 3");
+  auto Flat = FlatConstraint::fromConstraint(*C);
+
+  ASSERT_EQ(Flat.size(), 6);
+  EXPECT_EQ(Flat[0].Kind, Constraint::ConstraintKind::CK_FEATURE);
+  EXPECT_EQ(Flat[0].getFeature()->getName(), "A");
+  EXPECT_EQ(Flat[1].getFeature()->getName(), "B");
+  EXPECT_EQ(Flat[2].Kind, Constraint::ConstraintKind::CK_NOT);
+  EXPECT_EQ(Flat[3].Kind, Constraint::ConstraintKind::CK_AND);
+  EXPECT_EQ(Flat[3].LeftOperand, 0);
+  EXPECT_EQ(Flat[4].getValue(), 3);
+  EXPECT_EQ(Flat[5].Kind, Constraint::ConstraintKind::CK_OR);
+  EXPECT_EQ(Flat[5].LeftOperand, 3);
+}
+
+TEST(FlatConstraint, pushOperator) {
+  BinaryFeature A("A");
+  FlatConstraint Flat;
+
+  EXPECT_FALSE(Flat.pushOperator(Constraint::ConstraintKind::CK_NOT));
+  Flat.pushFeature(&A);
+  EXPECT_FALSE(Flat.pushOperator(Constraint::ConstraintKind::CK_AND));
+  EXPECT_FALSE(Flat.pushOperator(Constraint::ConstraintKind::CK_BINARY));
+  EXPECT_FALSE(Flat.pushOperator(Constraint::ConstraintKind::CK_FEATURE));
+  Flat.pushInteger(1);
+  EXPECT_FALSE(Flat.isComplete());
+  EXPECT_TRUE(Flat.pushOperator(Constraint::ConstraintKind::CK_EQUAL));
+  EXPECT_TRUE(Flat.isComplete());
+
+  auto C = Flat.toConstraint();
+  EXPECT_EQ(C->toString(), "(A = 1)");
+}
+
+TEST(FlatConstraint, toConstraintLeaves) {
+  BinaryFeature A("A");
+  BinaryFeature B("B");
+  FlatConstraint Flat;
+  Flat.pushFeature(&A);
+  Flat.pushFeature(&B);
+  Flat.pushOperator(Constraint::ConstraintKind::CK_IMPLIES);
+
+  llvm::SmallVector<PrimaryFeatureConstraint *, 2> Leaves;
+  auto C = Flat.toConstraint(&Leaves);
+  ASSERT_EQ(Leaves.size(), 2);
+  EXPECT_EQ(Leaves[0]->getFeature(), &A);
+  EXPECT_EQ(Leaves[1]->getFeature(), &B);
+}
+
+TEST(FlatConstraint, evaluate) {
+  llvm::StringMap<int64_t> Values{{"A", 1}, {"B", 0}, {"C", 7}};
+  auto ValueOf = [&Values](const Feature &F) {
+    return Values.lookup(F.getName());
+  };
+  auto Evaluate = [&ValueOf](llvm::StringRef Str) {
+    return FlatConstraint::fromConstraint(*parse(Str)).evaluate(ValueOf);
+  };
+
+  EXPECT_EQ(Evaluate("A => B"), 0);
+  EXPECT_EQ(Evaluate("B => A"), 1);
+  EXPECT_EQ(Evaluate("!(A <=> B)"), 1);
+  EXPECT_EQ(Evaluate("(C * 2) - A"), 13);
+  EXPECT_EQ(Evaluate("(C > 5) & (C <= 7)"), 1);
+}
+
+TEST(FlatConstraint, evaluateDivision) {
+  BinaryFeature A("A");
+  FlatConstraint Flat;
+  Flat.pushInteger(-7);
+  Flat.pushFeature(&A);
+  Flat.pushOperator(Constraint::ConstraintKind::CK_DIVISION);
+
+  EXPECT_EQ(Flat.evaluate([](const Feature &) { return 2; }), -3);
+  EXPECT_EQ(Flat.evaluate([](const Feature &) { return 0; }), std::nullopt);
+}
+
+TEST(FlatConstraint, remapFeatures) {
+  auto C = parse("A | (B & A)");
+  auto Flat = FlatConstraint::fromConstraint(*C);
+  BinaryFeature X("X");
+  Flat.remapFeatures([&X](Feature *F) {
+    return F->getName() == "A" ? &X : F;
+  });
+
+  EXPECT_EQ(Flat.toConstraint()->toString(), "(X | (B & X))");
+}
+
+} // namespace vara::feature
@@ -0,0 +1,100 @@
+#include "vara/Feature/FrozenFeatureModel.h"
+#include "vara/Feature/FeatureModelBuilder.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+
+namespace vara::feature {
+
+class FrozenFeatureModelTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    FeatureModelBuilder B;
+    B.makeFeature<BinaryFeature>("a");
+    B.makeFeature<BinaryFeature>("b")->addEdge("a", "b");
+    B.makeFeature<BinaryFeature>("c")->addEdge("a", "c");
+    B.makeFeature<BinaryFeature>("d")->addEdge("c", "d");
+    B.makeFeature<BinaryFeature>("e");
+    B.emplaceRelationship(Relationship::RelationshipKind::RK_ALTERNATIVE, "a");
+    FFM = freeze(B.buildFeatureModel());
+    ASSERT_TRUE(FFM);
+  }
+
+  const Feature &get(llvm::StringRef Name) { return *FFM->getFeature(Name); }
+
+  std::shared_ptr<const FrozenFeatureModel> FFM;
+};
+
+TEST_F(FrozenFeatureModelTest, orderMatchesModel) {
+  std::vector<const Feature *> Expected(FFM->getModel().begin(),
+                                        FFM->getModel().end());
+  std::vector<const Feature *> Actual(FFM->begin(), FFM->end());
+
+  EXPECT_EQ(Expected, Actual);
+  EXPECT_EQ(FFM->size(), 6);
+  EXPECT_EQ(FFM->getIndex(*FFM->getRoot()), 0);
+}
+
+TEST_F(FrozenFeatureModelTest, treeQueries) {
+  EXPECT_EQ(FFM->getParentFeature(get("d")), &get("c"));
+  EXPECT_EQ(FFM->getParentFeature(*FFM->getRoot()), nullptr);
+  EXPECT_EQ(FFM->getChildFeatures(get("a")),
+            llvm::ArrayRef<const Feature *>({&get("b"), &get("c")}));
+  EXPECT_TRUE(FFM->getChildFeatures(get("e")).empty());
+
+  ASSERT_TRUE(FFM->getParentRelationship(get("b")));
+  EXPECT_EQ(FFM->getParentRelationship(get("b"))->getKind(),
+            Relationship::RelationshipKind::RK_ALTERNATIVE);
+  EXPECT_FALSE(FFM->getParentRelationship(get("a")));
+
+  EXPECT_EQ(FFM->getDepth(get("d")), 3);
+  EXPECT_EQ(FFM->getSubtree(get("a")),
+            llvm::ArrayRef<const Feature *>(
+                {&get("a"), &get("b"), &get("c"), &get("d")}));
+  EXPECT_EQ(FFM->getSubtree(*FFM->getRoot()).size(), FFM->size());
+
+  EXPECT_TRUE(FFM->isAncestorOf(get("a"), get("d")));
+  EXPECT_FALSE(FFM->isAncestorOf(get("d"), get("a")));
+  EXPECT_FALSE(FFM->isAncestorOf(get("e"), get("d")));
+
+  EXPECT_EQ(FFM->getLowestCommonAncestor(get("b"), get("d")), &get("a"));
+  EXPECT_EQ(FFM->getLowestCommonAncestor(get("d"), get("e")), FFM->getRoot());
+  EXPECT_EQ(FFM->getLowestCommonAncestor(get("c"), get("d")), &get("c"));
+}
+
+TEST_F(FrozenFeatureModelTest, unknownFeature) {
+  BinaryFeature F("a");
+
+  EXPECT_EQ(FFM->getIndex(F), FrozenFeatureModel::NoIndex);
+  EXPECT_FALSE(FFM->getParentFeature(F));
+  EXPECT_TRUE(FFM->getSubtree(F).empty());
+  EXPECT_FALSE(FFM->getLowestCommonAncestor(F, get("a")));
+}
+
+TEST_F(FrozenFeatureModelTest, concurrentReads) {
+  std::atomic<unsigned> Mismatches{0};
+  std::vector<std::thread> Readers;
+  for (int T = 0; T < 4; ++T) {
+    Readers.emplace_back([this, &Mismatches]() {
+      for (int I = 0; I < 1000; ++I) {
+        for (const auto *F : *FFM) {
+          if (FFM->getFeature(F->getName()) != F ||
+              FFM->getSubtree(*F).front() != F) {
+            ++Mismatches;
+          }
+        }
+      }
+    });
+  }
+  for (auto &Reader : Readers) {
+    Reader.join();
+  }
+
+  EXPECT_EQ(Mismatches, 0);
+}
+
+TEST(FrozenFeatureModel, freezeNothing) { EXPECT_FALSE(freeze(nullptr)); }
+
+} // namespace vara::feature
@@ -0,0 +1,90 @@
+#include "vara/Feature/FeatureModelBuilder.h"
+#include "vara/Sampling/ConfigurationDistance.h"
+
+#include "gtest/gtest.h"
+
+namespace vara::sampling {
+
+static std::unique_ptr<feature::Configuration>
+createConfig(llvm::StringRef A, llvm::StringRef B, llvm::StringRef N) {
+  auto Config = std::make_unique<feature::Configuration>();
+  Config->setConfigurationOption("a", A);
+  Config->setConfigurationOption("b", B);
+  Config->setConfigurationOption("n", N);
+  return Config;
+}
+
+TEST(ConfigurationDistance, hammingDistance) {
+  std::vector<uint64_t> LHS{0b1011, 0};
+  std::vector<uint64_t> RHS{0b0001, uint64_t(1) << 63};
+  EXPECT_EQ(hammingDistance(LHS, RHS), 3);
+  EXPECT_EQ(hammingDistance(LHS, LHS), 0);
+}
+
+TEST(ConfigurationDistance, encodingFromFeatureModel) {
+  feature::FeatureModelBuilder B;
+  B.makeFeature<feature::BinaryFeature>("a");
+  B.makeFeature<feature::BinaryFeature>("b");
+  B.makeFeature<feature::NumericFeature>(
+      "n", std::vector<int64_t>{0, 5, 10});
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  ConfigurationEncoding Encoding(*FM);
+  EXPECT_EQ(Encoding.getNumBinaryOptions(), 2);
+  EXPECT_EQ(Encoding.getNumNumericOptions(), 1);
+
+  auto Packed = Encoding.pack(*createConfig("true", "false", "5"));
+  EXPECT_EQ(llvm::countPopulation(Packed.Bits[0]), 1);
+  EXPECT_DOUBLE_EQ(Packed.Numerics[0], 0.5);
+
+  auto Other = Encoding.pack(*createConfig("false", "false", "10"));
+  EXPECT_DOUBLE_EQ(distance(Packed, Other), 1.5);
+}
+
+TEST(ConfigurationDistance, nearestNeighbours) {
+  std::vector<std::unique_ptr<feature::Configuration>> Configs;
+  Configs.push_back(createConfig("true", "true", "0"));
+  Configs.push_back(createConfig("true", "false", "0"));
+  Configs.push_back(createConfig("false", "false", "8"));
+  Configs.push_back(createConfig("true", "true", "4"));
+
+  NearestNeighbourIndex Index(
+      ConfigurationEncoding::fromConfigurations(Configs));
+  for (const auto &Config : Configs) {
+    Index.insert(*Config);
+  }
+  EXPECT_EQ(Index.size(), 4);
+  EXPECT_DOUBLE_EQ(Index.distance(0, 3), 0.5);
+
+  auto Neighbours = Index.nearest(*createConfig("true", "true", "1"), 2);
+  ASSERT_EQ(Neighbours.size(), 2);
+  EXPECT_EQ(Neighbours[0].Index, 0);
+  EXPECT_DOUBLE_EQ(Neighbours[0].Distance, 0.125);
+  EXPECT_EQ(Neighbours[1].Index, 3);
+  EXPECT_DOUBLE_EQ(Neighbours[1].Distance, 0.375);
+
+  EXPECT_EQ(Index.nearest(*Configs[0], 10).size(), 4);
+}
+
+TEST(ConfigurationDistance, selectDiverse) {
+  std::vector<std::unique_ptr<feature::Configuration>> Configs;
+  Configs.push_back(createConfig("true", "true", "0"));
+  Configs.push_back(createConfig("true", "true", "1"));
+  Configs.push_back(createConfig("false", "false", "8"));
+  Configs.push_back(createConfig("true", "true", "0"));
+
+  NearestNeighbourIndex Index(
+      ConfigurationEncoding::fromConfigurations(Configs));
+  for (const auto &Config : Configs) {
+    Index.insert(*Config);
+  }
+
+  auto Selected = Index.selectDiverse(2);
+  ASSERT_EQ(Selected.size(), 2);
+  EXPECT_EQ(Selected[0], 0);
+  EXPECT_EQ(Selected[1], 2);
+  EXPECT_EQ(Index.selectDiverse(10).size(), 4);
+}
+
+} // namespace vara::sampling
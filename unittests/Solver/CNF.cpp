@@ -0,0 +1,167 @@
+#include "vara/Solver/CNF.h"
+
+#include "vara/Feature/ConstraintParser.h"
+#include "vara/Feature/FeatureModelBuilder.h"
+#include "vara/Solver/ConfigurationFactory.h"
+#include "vara/Solver/SolverFactory.h"
+
+#include "Utils/UnittestHelper.h"
+
+#include "gtest/gtest.h"
+
+#include <optional>
+
+namespace vara::solver {
+
+/// \returns the formula of \p FM or \c nullptr if it cannot be compiled
+static std::unique_ptr<CNF> compile(const feature::FeatureModel &FM) {
+  auto Formula = CNF::compile(FM);
+  if (!Formula) {
+    return nullptr;
+  }
+  return Formula.extractValue();
+}
+
+/// \returns the number of solutions of \p Formula or \c std::nullopt if no
+/// solver could be set up
+static std::optional<uint64_t> countConfigurations(const CNF &Formula) {
+  auto S = SolverFactory::initializeSolver(Formula, SolverType::Z3);
+  if (!S) {
+    return std::nullopt;
+  }
+  uint64_t Count = 0;
+  for (auto Config : ConfigurationIterable(S.extractValue())) {
+    if (Config) {
+      ++Count;
+    }
+  }
+  return Count;
+}
+
+static std::string writeDimacs(const CNF &Formula) {
+  std::string Dimacs;
+  llvm::raw_string_ostream OS(Dimacs);
+  Formula.writeDimacs(OS);
+  return OS.str();
+}
+
+TEST(CNF, compileTreeAndGroups) {
+  feature::FeatureModelBuilder B;
+  B.makeRoot("root");
+  B.makeFeature<feature::BinaryFeature>("Foo", true)->addEdge("root", "Foo");
+  B.makeFeature<feature::BinaryFeature>("A", false)->addEdge("root", "A");
+  B.makeFeature<feature::BinaryFeature>("A1", true)->addEdge("A", "A1");
+  B.makeFeature<feature::BinaryFeature>("A2", true)->addEdge("A", "A2");
+  B.makeFeature<feature::BinaryFeature>("A3", true)->addEdge("A", "A3");
+  B.emplaceRelationship(feature::Relationship::RelationshipKind::RK_OR, "A");
+  // Large enough for the linear at-most-one encoding.
+  B.makeFeature<feature::BinaryFeature>("B", true)->addEdge("root", "B");
+  for (int I = 0; I < 8; ++I) {
+    std::string Name = "B" + std::to_string(I);
+    B.makeFeature<feature::BinaryFeature>(Name, true)->addEdge("B", Name);
+  }
+  B.emplaceRelationship(
+      feature::Relationship::RelationshipKind::RK_ALTERNATIVE, "B");
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  auto Formula = compile(*FM);
+  ASSERT_TRUE(Formula);
+  EXPECT_EQ(Formula->getName(1), "root");
+  EXPECT_GT(Formula->getNumVariables(), FM->size());
+  auto Count = countConfigurations(*Formula);
+  ASSERT_TRUE(Count);
+  EXPECT_EQ(*Count, 2 * 7 * 9);
+}
+
+TEST(CNF, tseitinKeepsNumberOfConfigurations) {
+  feature::FeatureModelBuilder B;
+  B.makeRoot("root");
+  for (const auto *Name : {"a", "b", "c", "d", "e"}) {
+    B.makeFeature<feature::BinaryFeature>(Name, true)->addEdge("root", Name);
+  }
+  B.addConstraint(std::make_unique<feature::FeatureModel::BooleanConstraint>(
+      feature::ConstraintParser("(a | b) => !(c <=> (d & a))")
+          .buildConstraint()));
+  B.addConstraint(std::make_unique<feature::FeatureModel::BooleanConstraint>(
+      std::make_unique<feature::XorConstraint>(
+          std::make_unique<feature::PrimaryFeatureConstraint>(
+              std::make_unique<feature::BinaryFeature>("e")),
+          std::make_unique<feature::OrConstraint>(
+              std::make_unique<feature::PrimaryFeatureConstraint>(
+                  std::make_unique<feature::BinaryFeature>("a")),
+              std::make_unique<feature::PrimaryFeatureConstraint>(
+                  std::make_unique<feature::BinaryFeature>("b"))))));
+  auto FM = B.buildFeatureModel();
+  ASSERT_TRUE(FM);
+
+  auto Expected = ConfigurationFactory::getNumConfigs(*FM);
+  ASSERT_TRUE(Expected);
+  auto Formula = compile(*FM);
+  ASSERT_TRUE(Formula);
+  auto Count = countConfigurations(*Formula);
+  ASSERT_TRUE(Count);
+  EXPECT_EQ(*Count, Expected.extractValue());
+}
+
+TEST(CNF, dimacsRoundTrip) {
+  auto FM = feature::loadFeatureModel(getTestResource("test_dune_bin.xml"));
+  ASSERT_TRUE(FM);
+  auto Formula = compile(*FM);
+  ASSERT_TRUE(Formula);
+  auto Dimacs = writeDimacs(*Formula);
+
+  auto Parsed = CNF::parseDimacs(Dimacs);
+  ASSERT_TRUE(Parsed);
+  auto Loaded = Parsed.extractValue();
+  ASSERT_EQ(Formula->getNumVariables(), Loaded->getNumVariables());
+  ASSERT_EQ(Formula->getNumClauses(), Loaded->getNumClauses());
+  for (unsigned V = 1; V <= Formula->getNumVariables(); ++V) {
+    EXPECT_EQ(Formula->getName(V), Loaded->getName(V));
+  }
+  for (size_t I = 0; I < Formula->getNumClauses(); ++I) {
+    EXPECT_EQ(Formula->getClause(I), Loaded->getClause(I));
+  }
+  EXPECT_EQ(Dimacs, writeDimacs(*Loaded));
+  auto Count = countConfigurations(*Loaded);
+  ASSERT_TRUE(Count);
+  EXPECT_EQ(*Count, 2304);
+}
+
+TEST(CNF, parseDimacs) {
+  auto Parsed = CNF::parseDimacs("c a comment\n"
+                                 "c 2 feature with spaces\r\n"
+                                 "p cnf 3 2\n"
+                                 "1 -2\n"
+                                 "  3 0 -1\n"
+                                 "0\n"
+                                 "%\n"
+                                 "garbage\n");
+  ASSERT_TRUE(Parsed);
+  auto Formula = Parsed.extractValue();
+  EXPECT_EQ(Formula->getNumVariables(), 3);
+  EXPECT_EQ(Formula->getVariable("feature with spaces"), 2);
+  EXPECT_TRUE(Formula->getName(1).empty());
+  ASSERT_EQ(Formula->getNumClauses(), 2);
+  EXPECT_EQ(Formula->getClause(0), llvm::ArrayRef<CNF::Literal>({1, -2, 3}));
+  EXPECT_EQ(Formula->getClause(1), llvm::ArrayRef<CNF::Literal>({-1}));
+}
+
+TEST(CNF, parseDimacsRejectsMalformed) {
+  for (const auto *Dimacs : {
+           "1 0\n",                       // missing problem line
+           "p cnf 1 1\np cnf 1 1\n1 0\n", // second problem line
+           "p sat 1 1\n1 0\n",            // unsupported format
+           "p cnf 1 1\n2 0\n",            // unknown variable
+           "p cnf 1 1\n1\n",              // unterminated clause
+           "p cnf 1 2\n1 0\n",            // missing clause
+           "p cnf 1 1\n1 x 0\n",          // no literal
+           "c 1 a\nc 1 b\np cnf 1 0\n",   // variable named twice
+           "c 1 a\nc 2 a\np cnf 2 0\n",   // name used twice
+           "c 3 a\np cnf 2 0\n",          // name of unknown variable
+       }) {
+    EXPECT_FALSE(CNF::parseDimacs(Dimacs)) << Dimacs;
+  }
+}
+
+} // namespace vara::solver
@@ -133,6 +133,38 @@ TEST(Z3Solver, AddImpliesConstraint) {
   EXPECT_EQ(std::distance(I.begin(), I.end()), 6);
 }
 
+TEST(Z3Solver, SkipDuplicateConstraints) {
+  std::unique_ptr<Z3Solver> S = Z3Solver::create();
+  vara::feature::FeatureModelBuilder B;
+  B.makeRoot("root");
+  B.makeFeature<feature::BinaryFeature>("a", true)->addEdge("root", "a");
+  B.makeFeature<feature::BinaryFeature>("b", true)->addEdge("root", "b");
+  auto FM = B.buildFeatureModel();
+  S->addFeature(*FM->getFeature("root"));
+  S->addFeature(*FM->getFeature("a"));
+  S->addFeature(*FM->getFeature("b"));
+  for (int I = 0; I < 3; ++I) {
+    auto C = std::make_unique<feature::ImpliesConstraint>(
+        std::make_unique<feature::PrimaryFeatureConstraint>(
+            std::make_unique<feature::Feature>("a")),
+        std::make_unique<feature::PrimaryFeatureConstraint>(
+            std::make_unique<feature::Feature>("b")));
+    EXPECT_TRUE(S->addConstraint(*C));
+  }
+  auto Stats = S->getConstraintStatistics();
+  EXPECT_EQ(Stats.NumConstraints, 3);
+  EXPECT_EQ(Stats.NumDuplicateConstraints, 2);
+  EXPECT_EQ(Stats.NumUniqueNodes, 3);
+
+  unsigned Count = 0;
+  for (auto Config : ConfigurationIterable(std::move(S))) {
+    if (Config) {
+      ++Count;
+    }
+  }
+  EXPECT_EQ(Count, 3);
+}
+
 TEST(Z3Solver, AddAlternative) {
   std::unique_ptr<Z3Solver> S = Z3Solver::create();
   vara::feature::FeatureModelBuilder B;